@@ -0,0 +1,509 @@
+/* approxCount.c
+*
+* Created by Ke Liao
+*
+* This module estimates how many footpaths are in a rectangle without
+* finding them, counting each footpath once however many of its points are
+* in it, as a range query does. Each point counts the footpaths stored
+* there. A footpath stored at both its ends is a pair, kept by the lowest
+* node with both ends under it, and each node's count is its points' less
+* the pairs under it: the footpaths with a point under the node. The points
+* are kept flat in the order of the leaves, so the points under any node
+* are a run of them, & each node keeps their bounding box.
+*
+* Nodes whose points are all inside the rectangle count in full & those
+* with none inside are dropped. Nodes partly inside are split, biggest
+* first, until what they could add is within the tolerance of the total
+* (0 gives the exact count); the pairs of a node split are checked & those
+* with both ends inside counted once. The rest are estimated: by the part
+* of their bounding box the rectangle covers, assuming the points are
+* spread evenly, or from a sample of their points. Each estimate's variance
+* gives a 95% confidence interval, which is never wider than the nodes left
+* could be.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "nodeTable.h"
+#include "approxCount.h"
+#include "usefulConsts.h"
+
+#define INITIAL_SIZE 64
+#define Z_95 1.96                 // normal quantile of a 95% interval
+#define SAMPLE_SEED 88172645463325252ull
+
+// What's under a node: a run of the flat points, the footpaths with a
+// point there(weight) & stored at them(refs), their box & the node's pairs
+typedef struct {
+    int first, num_points;
+    double weight, refs;
+    double left, bot, right, top;
+    int pairs;        // first pair kept by the node, or UNDEFINED
+} node_stats_t;
+
+struct approx_counter{
+    quadtree_t *qtree;
+    node_table_t *stats;
+    int num_points;
+    double *lons, *lats, *weights;
+
+    // Flat points of each pair's ends, in lists by the node keeping them
+    int num_pairs, pairs_size;
+    int *pair_ends, *next_pair;
+};
+
+// Partly covered nodes, the largest share on top
+typedef struct {
+    node_stats_t **nodes;
+    quadtree_node_t **tree_nodes;
+    int num_nodes, size;
+} split_heap_t;
+
+static node_stats_t *stats_build(approx_counter_t *counter,
+                                 quadtree_node_t *node, int *record_point);
+static void pair_place(approx_counter_t *counter, int pair);
+static int pairs_inside(approx_counter_t *counter, node_stats_t *stats,
+                        double left, double bot, double right, double top);
+static double node_count(approx_counter_t *counter, quadtree_node_t *node,
+                         double left, double bot, double right, double top);
+static int point_inside(approx_counter_t *counter, int idx, double left,
+                        double bot, double right, double top);
+static int stats_classify(node_stats_t *stats, double left, double bot,
+                          double right, double top);
+static void heap_push(split_heap_t *heap, node_stats_t *stats,
+                      quadtree_node_t *node);
+static quadtree_node_t *heap_pop(split_heap_t *heap);
+static double uniform_estimate(node_stats_t *stats, double left, double bot,
+                               double right, double top, double *variance);
+static double sample_estimate(approx_counter_t *counter, node_stats_t *stats,
+                              quadtree_node_t *node, double left, double bot,
+                              double right, double top, int num_samples,
+                              uint64_t *seed, double *variance);
+static double cover_fraction(double low, double high, double query_low,
+                             double query_high);
+
+
+/* Collect the points & the stats of every node of the tree */
+approx_counter_t *approx_counter_create(quadtree_t *qtree){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+    approx_counter_t *counter = malloc(sizeof(*counter));
+    assert(counter);
+    counter->qtree = qtree;
+
+    // First flat point each record is stored at
+    int num_records = record_table_size(qtree->records);
+    int *record_point = malloc(sizeof(int) * (num_records + 1));
+    assert(record_point);
+    for (int i = 0; i < num_records; i++){
+        record_point[i] = UNDEFINED;
+    }
+
+    counter->lons = malloc(sizeof(double) * (2 * num_records + 1));
+    counter->lats = malloc(sizeof(double) * (2 * num_records + 1));
+    counter->weights = malloc(sizeof(double) * (2 * num_records + 1));
+    assert(counter->lons && counter->lats && counter->weights);
+    counter->num_points = 0;
+    counter->num_pairs = 0;
+    counter->pairs_size = INITIAL_SIZE;
+    counter->pair_ends = malloc(sizeof(int) * 2 * counter->pairs_size);
+    counter->next_pair = malloc(sizeof(int) * counter->pairs_size);
+    assert(counter->pair_ends && counter->next_pair);
+    counter->stats = node_table_create(qtree->root, sizeof(node_stats_t));
+    stats_build(counter, qtree->root, record_point);
+    free(record_point);
+
+    for (int pair = 0; pair < counter->num_pairs; pair++){
+        pair_place(counter, pair);
+    }
+    return counter;
+}
+
+
+/* Add the node's points to the flat points & work out its stats, pairing
+each record stored at two points. The pairs' nodes are left to pair_place */
+static node_stats_t *stats_build(approx_counter_t *counter,
+                                 quadtree_node_t *node, int *record_point){
+    node_stats_t stats = {counter->num_points, 0, 0, 0,
+                          INFINITY, INFINITY, -INFINITY, -INFINITY,
+                          UNDEFINED};
+    if (is_leaf_node(node)){
+        if (node->dt_point != NULL){
+            point_t *loc = get_dt_point_loc(node->dt_point);
+            record_id_t *records = get_record_list(node->dt_point);
+            int num_records = get_num_stored(node->dt_point);
+            int idx = counter->num_points++;
+
+            // The point's records are distinct footpaths
+            for (int i = 0; i < num_records; i++){
+                if (record_point[records[i]] == UNDEFINED){
+                    record_point[records[i]] = idx;
+                    continue;
+                }
+                if (counter->num_pairs == counter->pairs_size){
+                    counter->pairs_size *= 2;
+                    counter->pair_ends = realloc(counter->pair_ends,
+                        sizeof(int) * 2 * counter->pairs_size);
+                    counter->next_pair = realloc(counter->next_pair,
+                        sizeof(int) * counter->pairs_size);
+                    assert(counter->pair_ends && counter->next_pair);
+                }
+                int pair = counter->num_pairs++;
+                counter->pair_ends[2 * pair] = record_point[records[i]];
+                counter->pair_ends[2 * pair + 1] = idx;
+            }
+
+            counter->lons[idx] = get_lon(loc);
+            counter->lats[idx] = get_lat(loc);
+            counter->weights[idx] = num_records;
+            stats.num_points = 1;
+            stats.weight = stats.refs = num_records;
+            stats.left = stats.right = counter->lons[idx];
+            stats.bot = stats.top = counter->lats[idx];
+        }
+    }else{
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            node_stats_t *child_stats = stats_build(counter, child,
+                                                    record_point);
+            stats.num_points += child_stats->num_points;
+            stats.weight += child_stats->weight;
+            stats.refs += child_stats->refs;
+            stats.left = fmin(stats.left, child_stats->left);
+            stats.bot = fmin(stats.bot, child_stats->bot);
+            stats.right = fmax(stats.right, child_stats->right);
+            stats.top = fmax(stats.top, child_stats->top);
+        }
+    }
+    node_stats_t *slot = node_table_get(counter->stats, node);
+    *slot = stats;
+    return slot;
+}
+
+
+/* Give the pair to the lowest node with both its ends under it, taking it
+off the weight of that node & those above */
+static void pair_place(approx_counter_t *counter, int pair){
+    int first_end = counter->pair_ends[2 * pair];
+    int second_end = counter->pair_ends[2 * pair + 1];
+    quadtree_node_t *node = counter->qtree->root;
+    while (TRUE){
+        node_stats_t *stats = node_table_get(counter->stats, node);
+        stats->weight--;
+
+        // Child with both ends under it, if any
+        quadtree_node_t *below = NULL;
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            node_stats_t *child_stats = node_table_get(counter->stats, child);
+            int end = child_stats->first + child_stats->num_points;
+            if (first_end >= child_stats->first && first_end < end){
+                if (second_end < end){
+                    below = child;
+                }
+                break;
+            }
+        }
+        if (below == NULL){
+            counter->next_pair[pair] = stats->pairs;
+            stats->pairs = pair;
+            return;
+        }
+        node = below;
+    }
+}
+
+
+/* Number of the node's pairs with both ends in the query */
+static int pairs_inside(approx_counter_t *counter, node_stats_t *stats,
+                        double left, double bot, double right, double top){
+    int num_inside = 0;
+    for (int pair = stats->pairs; pair != UNDEFINED;
+            pair = counter->next_pair[pair]){
+        if (point_inside(counter, counter->pair_ends[2 * pair], left, bot,
+                         right, top) &&
+                point_inside(counter, counter->pair_ends[2 * pair + 1],
+                             left, bot, right, top)){
+            num_inside++;
+        }
+    }
+    return num_inside;
+}
+
+
+/* Output to f the estimated number of footpaths in the query with its 95%
+confidence interval, & the nodes visited & points sampled to summary.
+Nodes partly in the query are split until what they could add is at most
+tolerance of the total; those left are estimated from num_samples of their
+points each, or by their area if num_samples is 0 */
+void approx_range_count(approx_counter_t *counter, rectangle_t *query,
+                        double tolerance, int num_samples, FILE *f,
+                        FILE *summary){
+    double left = get_lon(get_bottomleft(query));
+    double bot = get_lat(get_bottomleft(query));
+    double right = get_lon(get_topright(query));
+    double top = get_lat(get_topright(query));
+
+    split_heap_t heap;
+    heap.size = INITIAL_SIZE;
+    heap.num_nodes = 0;
+    heap.nodes = malloc(sizeof(node_stats_t*) * heap.size);
+    heap.tree_nodes = malloc(sizeof(quadtree_node_t*) * heap.size);
+    assert(heap.nodes && heap.tree_nodes);
+
+    double exact = 0, pending = 0;
+    int num_visited = 1;
+    quadtree_node_t *root = counter->qtree->root;
+    node_stats_t *root_stats = node_table_get(counter->stats, root);
+    int relation = stats_classify(root_stats, left, bot, right, top);
+    if (relation == TRUE){
+        exact += root_stats->weight;
+    }else if (relation == UNDEFINED){
+        heap_push(&heap, root_stats, root);
+        pending += root_stats->weight;
+    }
+
+    // Split the biggest partly covered node until the rest are small enough
+    while (heap.num_nodes > 0 && pending > tolerance * (exact + pending)){
+        pending -= heap.nodes[0]->weight;
+        exact -= pairs_inside(counter, heap.nodes[0], left, bot, right, top);
+        quadtree_node_t *node = heap_pop(&heap);
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            num_visited++;
+            node_stats_t *stats = node_table_get(counter->stats, child);
+            relation = stats_classify(stats, left, bot, right, top);
+            if (relation == TRUE){
+                exact += stats->weight;
+            }else if (relation == UNDEFINED){
+                heap_push(&heap, stats, child);
+                pending += stats->weight;
+            }
+        }
+    }
+
+    // Estimate the nodes left
+    double estimate = exact, variance = 0, most = exact;
+    int num_sampled = 0;
+    uint64_t seed = SAMPLE_SEED;
+    for (int i = 0; i < heap.num_nodes; i++){
+        node_stats_t *stats = heap.nodes[i];
+        double node_variance = 0;
+        if (num_samples > 0){
+            estimate += sample_estimate(counter, stats, heap.tree_nodes[i],
+                                        left, bot, right, top, num_samples,
+                                        &seed, &node_variance);
+            num_sampled += num_samples < stats->num_points ?
+                           num_samples : stats->num_points;
+        }else{
+            estimate += uniform_estimate(stats, left, bot, right, top,
+                                         &node_variance);
+        }
+        variance += node_variance;
+        most += stats->weight;
+    }
+    double low = fmax(exact, estimate - Z_95 * sqrt(variance));
+    double high = fmin(most, estimate + Z_95 * sqrt(variance));
+
+    fprintf(f, "--> estimate: %.1f || low: %.1f || high: %.1f\n", estimate,
+            low, high);
+    fprintf(summary, " %d nodes visited, %d points sampled", num_visited,
+            num_sampled);
+    free(heap.nodes);
+    free(heap.tree_nodes);
+}
+
+
+/* TRUE if the points of the node are all in the query, FALSE if none are &
+UNDEFINED if some may be. The query takes longitudes in (left, right] &
+latitudes in [bot, top), as in_rectangle */
+static int stats_classify(node_stats_t *stats, double left, double bot,
+                          double right, double top){
+    if (stats->num_points == 0 || stats->right <= left ||
+            stats->left > right || stats->top < bot || stats->bot >= top){
+        return FALSE;
+    }
+    if (stats->left > left && stats->right <= right && stats->bot >= bot &&
+            stats->top < top){
+        return TRUE;
+    }
+    return UNDEFINED;
+}
+
+
+/* Share of the node in the query if its points are spread evenly over their
+bounding box, & the variance of that if each point is in independently */
+static double uniform_estimate(node_stats_t *stats, double left, double bot,
+                               double right, double top, double *variance){
+    double fraction = cover_fraction(stats->left, stats->right, left, right) *
+                      cover_fraction(stats->bot, stats->top, bot, top);
+    double point_weight = stats->weight / stats->num_points;
+    *variance = stats->num_points * fraction * (1 - fraction) *
+                point_weight * point_weight;
+    return stats->weight * fraction;
+}
+
+
+/* Part of [low, high] inside [query_low, query_high](for a single value,
+1 if it's inside) */
+static double cover_fraction(double low, double high, double query_low,
+                             double query_high){
+    if (high == low){
+        return low >= query_low && low <= query_high;
+    }
+    double covered = fmin(high, query_high) - fmax(low, query_low);
+    return fmax(covered, 0) / (high - low);
+}
+
+
+/* Share of the node in the query from num_samples of its points(taken with
+replacement), scaled from the footpaths stored at them to those with a
+point in the node, & the variance of that. Nodes with no more points than
+that are counted exactly */
+static double sample_estimate(approx_counter_t *counter, node_stats_t *stats,
+                              quadtree_node_t *node, double left, double bot,
+                              double right, double top, int num_samples,
+                              uint64_t *seed, double *variance){
+    int n = stats->num_points;
+    *variance = 0;
+    if (num_samples >= n){
+        return node_count(counter, node, left, bot, right, top);
+    }
+
+    double sum = 0, sum_squares = 0;
+    for (int s = 0; s < num_samples; s++){
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 7;
+        *seed ^= *seed << 17;
+        int i = stats->first + (int)(*seed % (uint64_t)n);
+        double value = 0;
+        if (point_inside(counter, i, left, bot, right, top)){
+            value = (double)n * counter->weights[i] * stats->weight /
+                    stats->refs;
+        }
+        sum += value;
+        sum_squares += value * value;
+    }
+    double mean = sum / num_samples;
+    if (num_samples > 1){
+        double spread = (sum_squares - num_samples * mean * mean) /
+                        (num_samples - 1);
+        *variance = fmax(spread, 0) / num_samples;
+    }
+    return mean;
+}
+
+
+/* Number of footpaths with a point under the node in the query */
+static double node_count(approx_counter_t *counter, quadtree_node_t *node,
+                         double left, double bot, double right, double top){
+    node_stats_t *stats = node_table_get(counter->stats, node);
+    if (is_leaf_node(node)){
+        if (stats->num_points == 0 ||
+                !point_inside(counter, stats->first, left, bot, right, top)){
+            return 0;
+        }
+        return stats->weight;
+    }
+    double count = -pairs_inside(counter, stats, left, bot, right, top);
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL){
+            count += node_count(counter, child, left, bot, right, top);
+        }
+    }
+    return count;
+}
+
+
+/* TRUE if the flat point is in the query, taking longitudes in
+(left, right] & latitudes in [bot, top) as in_rectangle */
+static int point_inside(approx_counter_t *counter, int idx, double left,
+                        double bot, double right, double top){
+    return counter->lons[idx] > left && counter->lons[idx] <= right &&
+           counter->lats[idx] >= bot && counter->lats[idx] < top;
+}
+
+
+/* Add a partly covered node to the heap */
+static void heap_push(split_heap_t *heap, node_stats_t *stats,
+                      quadtree_node_t *node){
+    if (heap->num_nodes == heap->size){
+        heap->size *= 2;
+        heap->nodes = realloc(heap->nodes,
+                              sizeof(node_stats_t*) * heap->size);
+        heap->tree_nodes = realloc(heap->tree_nodes,
+                                   sizeof(quadtree_node_t*) * heap->size);
+        assert(heap->nodes && heap->tree_nodes);
+    }
+    int idx = heap->num_nodes++;
+    while (idx > 0 && heap->nodes[(idx - 1) / 2]->weight < stats->weight){
+        heap->nodes[idx] = heap->nodes[(idx - 1) / 2];
+        heap->tree_nodes[idx] = heap->tree_nodes[(idx - 1) / 2];
+        idx = (idx - 1) / 2;
+    }
+    heap->nodes[idx] = stats;
+    heap->tree_nodes[idx] = node;
+}
+
+
+/* Take the node with the largest share off the heap */
+static quadtree_node_t *heap_pop(split_heap_t *heap){
+    quadtree_node_t *top = heap->tree_nodes[0];
+    int last = --heap->num_nodes;
+    node_stats_t *moved = heap->nodes[last];
+    quadtree_node_t *moved_node = heap->tree_nodes[last];
+    int idx = 0;
+    while (TRUE){
+        int child = 2 * idx + 1;
+        if (child >= last){
+            break;
+        }
+        if (child + 1 < last &&
+                heap->nodes[child + 1]->weight > heap->nodes[child]->weight){
+            child++;
+        }
+        if (heap->nodes[child]->weight <= moved->weight){
+            break;
+        }
+        heap->nodes[idx] = heap->nodes[child];
+        heap->tree_nodes[idx] = heap->tree_nodes[child];
+        idx = child;
+    }
+    heap->nodes[idx] = moved;
+    heap->tree_nodes[idx] = moved_node;
+    return top;
+}
+
+
+/* Free the points & stats(the tree is left alone)*/
+void approx_counter_free(approx_counter_t *counter){
+    node_table_free(counter->stats);
+    free(counter->lons);
+    free(counter->lats);
+    free(counter->weights);
+    free(counter->pair_ends);
+    free(counter->next_pair);
+    free(counter);
+}
@@ -0,0 +1,14 @@
+#ifndef _APPROXCOUNT_H_
+#define _APPROXCOUNT_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+typedef struct approx_counter approx_counter_t;
+
+approx_counter_t *approx_counter_create(quadtree_t *qtree);
+void approx_range_count(approx_counter_t *counter, rectangle_t *query,
+                        double tolerance, int num_samples, FILE *f,
+                        FILE *summary);
+void approx_counter_free(approx_counter_t *counter);
+#endif
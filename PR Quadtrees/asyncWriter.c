@@ -0,0 +1,325 @@
+/* asyncWriter.c
+*
+* Created by Ke Liao
+*
+* This module moves writing the output off the thread answering the
+* queries. A stream opened on the writer looks like any other FILE, but
+* what's written to it is copied into a large buffer; a full buffer is
+* queued & a thread of the writer's own writes it to the real file while
+* the next buffer fills. Buffers are written in the order they're queued.
+*
+* The writer has a fixed number of buffers shared by its streams, so the
+* memory used is bounded: when every buffer is full or being written, a
+* stream waits for one to be written before taking more output.
+*
+* Closing a stream queues what's left & waits for all of it to be written.
+* Once a write to a stream's file fails, the stream drops its output, its
+* writes fail & closing it returns EOF. Streams & writers still open when
+* the program exits are closed then, so an exit() part way through doesn't
+* lose what's buffered.
+*
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "asyncWriter.h"
+#include "usefulConsts.h"
+
+typedef struct async_stream async_stream_t;
+
+// Buffer, with the stream it's filled from
+typedef struct {
+    char *data;
+    size_t len;
+    async_stream_t *stream;
+} write_buffer_t;
+
+struct async_stream{
+    async_writer_t *writer;
+    FILE *file;       // stream opened on the writer
+    FILE *sink;
+    int close_sink;   // TRUE to close the sink when the stream is closed
+    int current;      // buffer being filled, or UNDEFINED
+    int num_queued;   // buffers queued & not yet written
+    int failed;       // TRUE once a write to the sink fails
+    async_stream_t *next;
+};
+
+struct async_writer{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t buffer_queued, buffer_written;
+    int shutdown;
+
+    size_t buffer_size;
+    int num_buffers;
+    write_buffer_t *buffers;
+    int *free_buffers;        // stack of buffers not in use
+    int num_free;
+    int *queue;               // ring of full buffers waiting to be written
+    int queue_head, queue_len;
+
+    async_stream_t *streams;  // streams not yet closed
+    async_writer_t *next;
+};
+
+// Writers not yet freed, closed at exit
+static async_writer_t *open_writers = NULL;
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t exit_registered = PTHREAD_ONCE_INIT;
+
+static ssize_t stream_write(void *cookie, const char *buf, size_t size);
+static int stream_close(void *cookie);
+static void buffer_queue(async_stream_t *stream);
+static void *writer_run(void *arg);
+static void exit_register(void);
+static void writers_close_all(void);
+
+
+/* Create a writer with num_buffers buffers of buffer_size bytes & start its
+thread */
+async_writer_t *async_writer_create(int num_buffers, size_t buffer_size){
+    async_writer_t *writer = malloc(sizeof(*writer));
+    assert(writer != NULL);
+    writer->buffer_size = buffer_size;
+    writer->num_buffers = num_buffers;
+    writer->buffers = malloc(sizeof(write_buffer_t) * num_buffers);
+    writer->free_buffers = malloc(sizeof(int) * num_buffers);
+    writer->queue = malloc(sizeof(int) * num_buffers);
+    assert(writer->buffers != NULL && writer->free_buffers != NULL);
+    assert(writer->queue != NULL);
+    for (int i = 0; i < num_buffers; i++){
+        writer->buffers[i].data = malloc(buffer_size);
+        assert(writer->buffers[i].data != NULL);
+        writer->buffers[i].len = 0;
+        writer->buffers[i].stream = NULL;
+        writer->free_buffers[i] = i;
+    }
+    writer->num_free = num_buffers;
+    writer->queue_head = 0;
+    writer->queue_len = 0;
+    writer->shutdown = FALSE;
+    writer->streams = NULL;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->buffer_queued, NULL);
+    pthread_cond_init(&writer->buffer_written, NULL);
+    int created = pthread_create(&writer->thread, NULL, writer_run, writer);
+    assert(created == 0);
+
+    pthread_once(&exit_registered, exit_register);
+    pthread_mutex_lock(&open_lock);
+    writer->next = open_writers;
+    open_writers = writer;
+    pthread_mutex_unlock(&open_lock);
+    return writer;
+}
+
+
+/* Open a stream whose output goes to sink through the writer. The sink is
+closed with the stream if close_sink is TRUE */
+FILE *async_writer_open(async_writer_t *writer, FILE *sink, int close_sink){
+    async_stream_t *stream = malloc(sizeof(*stream));
+    assert(stream != NULL);
+    stream->writer = writer;
+    stream->sink = sink;
+    stream->close_sink = close_sink;
+    stream->current = UNDEFINED;
+    stream->num_queued = 0;
+    stream->failed = FALSE;
+
+    cookie_io_functions_t functions = {NULL, stream_write, NULL, stream_close};
+    FILE *f = fopencookie(stream, "w", functions);
+    assert(f != NULL);
+    stream->file = f;
+    pthread_mutex_lock(&open_lock);
+    stream->next = writer->streams;
+    writer->streams = stream;
+    pthread_mutex_unlock(&open_lock);
+    return f;
+}
+
+
+/* Copy the output into the stream's buffers, queueing each that fills.
+Fails once a write to the sink has failed */
+static ssize_t stream_write(void *cookie, const char *buf, size_t size){
+    async_stream_t *stream = cookie;
+    async_writer_t *writer = stream->writer;
+    size_t done = 0;
+    while (done < size){
+        if (stream->current == UNDEFINED){
+            pthread_mutex_lock(&writer->lock);
+            while (writer->num_free == 0 && !stream->failed){
+                pthread_cond_wait(&writer->buffer_written, &writer->lock);
+            }
+            if (stream->failed){
+                pthread_mutex_unlock(&writer->lock);
+                return -1;
+            }
+            stream->current = writer->free_buffers[--writer->num_free];
+            pthread_mutex_unlock(&writer->lock);
+            writer->buffers[stream->current].len = 0;
+            writer->buffers[stream->current].stream = stream;
+        }
+
+        write_buffer_t *buffer = &writer->buffers[stream->current];
+        size_t len = writer->buffer_size - buffer->len;
+        if (len > size - done){
+            len = size - done;
+        }
+        memcpy(buffer->data + buffer->len, buf + done, len);
+        buffer->len += len;
+        done += len;
+        if (buffer->len == writer->buffer_size){
+            buffer_queue(stream);
+        }
+    }
+    return size;
+}
+
+
+/* Queue the stream's buffer to be written */
+static void buffer_queue(async_stream_t *stream){
+    async_writer_t *writer = stream->writer;
+    pthread_mutex_lock(&writer->lock);
+    int tail = (writer->queue_head + writer->queue_len) % writer->num_buffers;
+    writer->queue[tail] = stream->current;
+    writer->queue_len++;
+    stream->num_queued++;
+    pthread_cond_signal(&writer->buffer_queued);
+    pthread_mutex_unlock(&writer->lock);
+    stream->current = UNDEFINED;
+}
+
+
+/* Queue the rest of the stream's output & wait until it's all written.
+Returns EOF if any of it couldn't be written */
+static int stream_close(void *cookie){
+    async_stream_t *stream = cookie;
+    async_writer_t *writer = stream->writer;
+    pthread_mutex_lock(&open_lock);
+    async_stream_t **link = &writer->streams;
+    while (*link != stream){
+        link = &(*link)->next;
+    }
+    *link = stream->next;
+    pthread_mutex_unlock(&open_lock);
+
+    if (stream->current != UNDEFINED){
+        if (writer->buffers[stream->current].len > 0){
+            buffer_queue(stream);
+        }else{
+            pthread_mutex_lock(&writer->lock);
+            writer->free_buffers[writer->num_free++] = stream->current;
+            pthread_cond_broadcast(&writer->buffer_written);
+            pthread_mutex_unlock(&writer->lock);
+        }
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (stream->num_queued > 0){
+        pthread_cond_wait(&writer->buffer_written, &writer->lock);
+    }
+    int failed = stream->failed;
+    pthread_mutex_unlock(&writer->lock);
+
+    if (fflush(stream->sink) != 0){
+        failed = TRUE;
+    }
+    if (stream->close_sink && fclose(stream->sink) != 0){
+        failed = TRUE;
+    }
+    free(stream);
+    return failed ? EOF : 0;
+}
+
+
+/* Thread body: write the queued buffers in order until the writer is freed
+& nothing is left */
+static void *writer_run(void *arg){
+    async_writer_t *writer = arg;
+    pthread_mutex_lock(&writer->lock);
+    while (TRUE){
+        while (writer->queue_len == 0 && !writer->shutdown){
+            pthread_cond_wait(&writer->buffer_queued, &writer->lock);
+        }
+        if (writer->queue_len == 0){
+            break;
+        }
+        int next = writer->queue[writer->queue_head];
+        writer->queue_head = (writer->queue_head + 1) % writer->num_buffers;
+        writer->queue_len--;
+        pthread_mutex_unlock(&writer->lock);
+
+        write_buffer_t *buffer = &writer->buffers[next];
+        async_stream_t *stream = buffer->stream;
+        pthread_mutex_lock(&writer->lock);
+        int failed = stream->failed;
+        pthread_mutex_unlock(&writer->lock);
+        if (!failed){
+            failed = fwrite(buffer->data, 1, buffer->len, stream->sink)
+                     != buffer->len;
+        }
+
+        pthread_mutex_lock(&writer->lock);
+        stream->failed = failed;
+        stream->num_queued--;
+        writer->free_buffers[writer->num_free++] = next;
+        pthread_cond_broadcast(&writer->buffer_written);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+
+/* Stop the thread once the queued buffers are written & free the writer.
+Its streams should be closed first */
+void async_writer_free(async_writer_t *writer){
+    pthread_mutex_lock(&open_lock);
+    async_writer_t **link = &open_writers;
+    while (*link != writer){
+        link = &(*link)->next;
+    }
+    *link = writer->next;
+    pthread_mutex_unlock(&open_lock);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->shutdown = TRUE;
+    pthread_cond_signal(&writer->buffer_queued);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->buffer_queued);
+    pthread_cond_destroy(&writer->buffer_written);
+    for (int i = 0; i < writer->num_buffers; i++){
+        free(writer->buffers[i].data);
+    }
+    free(writer->buffers);
+    free(writer->free_buffers);
+    free(writer->queue);
+    free(writer);
+}
+
+
+/* Close the streams & free the writers left open when the program exits */
+static void exit_register(void){
+    atexit(writers_close_all);
+}
+
+
+/* Runs at exit, before stdio flushes its own streams */
+static void writers_close_all(void){
+    while (open_writers != NULL){
+        async_writer_t *writer = open_writers;
+        while (writer->streams != NULL){
+            if (fclose(writer->streams->file) != 0){
+                fprintf(stderr, "Can't write the output\n");
+            }
+        }
+        async_writer_free(writer);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef _ASYNCWRITER_H_
+#define _ASYNCWRITER_H_
+#include <stdio.h>
+
+typedef struct async_writer async_writer_t;
+
+async_writer_t *async_writer_create(int num_buffers, size_t buffer_size);
+FILE *async_writer_open(async_writer_t *writer, FILE *sink, int close_sink);
+void async_writer_free(async_writer_t *writer);
+#endif
@@ -0,0 +1,418 @@
+/* attributeIndex.c
+*
+* Created by Ke Liao
+*
+* This module answers queries on the text & id columns of the footpaths
+* (clue_sa, asset_type, segside, streetid & street_group), alone or with a
+* rectangle, e.g. the footpaths in a rectangle with clue_sa Carlton and
+* asset_type Road Footway. Each column has an inverted index: its distinct
+* values, sorted, each with the sorted list(postings) of the footpaths
+* having it. Footpaths are numbered by their rank in footpath id order, so
+* postings & results all come out in the order the output is sorted by.
+*
+* The postings of a query's values are intersected shortest first. Each
+* element of the shorter list is looked for in the longer one by galloping
+* (doubling steps from where the last one was found, then a binary search),
+* so a short list costs little against a long one.
+*
+* With a rectangle, the side expected to be smaller goes first: the
+* planner's histogram estimates the footpaths in the rectangle. If the
+* footpaths matching the values are fewer, each is checked against the
+* rectangle by its points; otherwise the tree is searched & the two lists
+* intersected.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "queryPlanner.h"
+#include "attributeIndex.h"
+#include "usefulConsts.h"
+
+#define NUM_COLUMNS 5
+#define INT_KEY_LEN 16     // enough for any int written out
+
+// Columns that can be queried, by text or by id
+typedef struct {
+    const char *name;
+    char *(*get_text)(footpath_t *record);
+    int (*get_int)(footpath_t *record);
+} column_t;
+
+static const column_t columns[NUM_COLUMNS] = {
+    {"clue_sa", get_clue_sa, NULL},
+    {"asset_type", get_asset_type, NULL},
+    {"segside", get_segside, NULL},
+    {"streetid", NULL, get_streetid},
+    {"street_group", NULL, get_street_group}
+};
+
+// Inverted index of a column: postings[first[i]..] are for values[i]
+typedef struct {
+    int num_values;
+    char **values;
+    int *first;
+    int *num_postings;
+    uint32_t *postings;
+} column_index_t;
+
+struct attribute_index{
+    quadtree_t *qtree;
+    record_table_t *table;
+    query_planner_t *planner;
+    int num_records;
+    record_id_t *rank_records;   // record at each rank
+    uint32_t *record_ranks;      // rank of each record
+    column_index_t columns[NUM_COLUMNS];
+};
+
+// Footpath id of a record, to be sorted into ranks
+typedef struct {
+    int footpath_id;
+    record_id_t record;
+} rank_entry_t;
+
+// Value of a column for the footpath at a rank, to be sorted
+typedef struct {
+    const char *value;
+    uint32_t rank;
+} column_entry_t;
+
+static int rank_cmp(const void *a, const void *b);
+static int entry_cmp(const void *a, const void *b);
+static int uint_cmp(const void *a, const void *b);
+static void column_build(attribute_index_t *index, int column);
+static int postings_find(column_index_t *column, const char *value);
+static int postings_intersect(uint32_t *small, int num_small,
+                              const uint32_t *large, int num_large);
+static int rank_in_area(attribute_index_t *index, uint32_t rank,
+                        rectangle_t *query);
+
+
+/* Number the records by footpath id & build the index of each column */
+attribute_index_t *attribute_index_create(quadtree_t *qtree){
+    attribute_index_t *index = malloc(sizeof(*index));
+    assert(index);
+    index->qtree = qtree;
+    index->table = get_records(qtree);
+    index->planner = planner_create(qtree);
+    index->num_records = record_table_size(index->table);
+
+    int num_records = index->num_records;
+    index->rank_records = malloc(sizeof(record_id_t) * (num_records + 1));
+    index->record_ranks = malloc(sizeof(uint32_t) * (num_records + 1));
+    assert(index->rank_records && index->record_ranks);
+    rank_entry_t *entries = malloc(sizeof(*entries) * (num_records + 1));
+    assert(entries);
+    for (record_id_t record = 0; record < num_records; record++){
+        entries[record].footpath_id = record_table_footpath_id(index->table,
+                                                               record);
+        entries[record].record = record;
+    }
+    qsort(entries, num_records, sizeof(*entries), rank_cmp);
+    for (uint32_t rank = 0; rank < num_records; rank++){
+        index->rank_records[rank] = entries[rank].record;
+        index->record_ranks[entries[rank].record] = rank;
+    }
+    free(entries);
+
+    for (int column = 0; column < NUM_COLUMNS; column++){
+        column_build(index, column);
+    }
+    return index;
+}
+
+
+/* Index of the column called name, or UNDEFINED if it can't be queried */
+int attribute_column(const char *name){
+    for (int i = 0; i < NUM_COLUMNS; i++){
+        if (strcmp(columns[i].name, name) == 0){
+            return i;
+        }
+    }
+    return UNDEFINED;
+}
+
+
+/* Sort the values of the column with the ranks of the footpaths having
+them & group them into postings */
+static void column_build(attribute_index_t *index, int column){
+    int num_records = index->num_records;
+    column_entry_t *entries = malloc(sizeof(*entries) * (num_records + 1));
+    char (*keys)[INT_KEY_LEN] = malloc(INT_KEY_LEN * (num_records + 1));
+    footpath_t *buffer = record_buffer_create();
+    assert(entries && keys);
+    for (uint32_t rank = 0; rank < num_records; rank++){
+        footpath_t *footpath = record_table_get(index->table,
+                                                index->rank_records[rank],
+                                                buffer);
+        if (columns[column].get_text != NULL){
+            entries[rank].value = columns[column].get_text(footpath);
+        }else{
+            snprintf(keys[rank], INT_KEY_LEN, "%d",
+                     columns[column].get_int(footpath));
+            entries[rank].value = keys[rank];
+        }
+        entries[rank].rank = rank;
+    }
+    record_buffer_free(buffer);
+    qsort(entries, num_records, sizeof(*entries), entry_cmp);
+
+    column_index_t *col = &index->columns[column];
+    col->postings = malloc(sizeof(uint32_t) * (num_records + 1));
+    col->values = malloc(sizeof(char*) * (num_records + 1));
+    col->first = malloc(sizeof(int) * (num_records + 1));
+    col->num_postings = malloc(sizeof(int) * (num_records + 1));
+    assert(col->postings && col->values && col->first && col->num_postings);
+    col->num_values = 0;
+    for (int i = 0; i < num_records; i++){
+        if (i == 0 || strcmp(entries[i].value, entries[i - 1].value) != 0){
+            int value = col->num_values++;
+            col->values[value] = malloc(strlen(entries[i].value) + 1);
+            assert(col->values[value]);
+            strcpy(col->values[value], entries[i].value);
+            col->first[value] = i;
+            col->num_postings[value] = 0;
+        }
+        col->postings[i] = entries[i].rank;
+        col->num_postings[col->num_values - 1]++;
+    }
+    free(entries);
+    free(keys);
+}
+
+
+/* Output to f the footpaths with a point in the query(NULL for anywhere)
+whose columns all have the values given, sorted by footpath id, & to
+summary the number found & which side was searched first */
+void attribute_ranged_query(attribute_index_t *index, rectangle_t *query,
+                            int *column_ids, char **values,
+                            int num_predicates, FILE *f, FILE *summary){
+
+    // Postings of each value, shortest first
+    column_index_t *cols[num_predicates + 1];
+    int found[num_predicates + 1];
+    int num_found = 0;
+    int empty = num_predicates == 0;
+    for (int i = 0; i < num_predicates && !empty; i++){
+        column_index_t *col = &index->columns[column_ids[i]];
+        int value = postings_find(col, values[i]);
+        if (value == UNDEFINED){
+            empty = TRUE;
+            break;
+        }
+        int idx = num_found++;
+        while (idx > 0 && cols[idx - 1]->num_postings[found[idx - 1]] >
+                col->num_postings[value]){
+            cols[idx] = cols[idx - 1];
+            found[idx] = found[idx - 1];
+            idx--;
+        }
+        cols[idx] = col;
+        found[idx] = value;
+    }
+    rectangle_t *area = get_root_rectangle(index->qtree);
+    if (query != NULL && rectangle_overlap(query, area) == FALSE){
+        empty = TRUE;
+    }
+
+    uint32_t *ranks = NULL;
+    int num_ranks = 0;
+    const char *plan = NULL;
+    if (!empty){
+        num_ranks = cols[0]->num_postings[found[0]];
+        ranks = malloc(sizeof(uint32_t) * (num_ranks + 1));
+        assert(ranks);
+        memcpy(ranks, cols[0]->postings + cols[0]->first[found[0]],
+               sizeof(uint32_t) * num_ranks);
+        for (int i = 1; i < num_predicates && num_ranks > 0; i++){
+            num_ranks = postings_intersect(ranks, num_ranks,
+                cols[i]->postings + cols[i]->first[found[i]],
+                cols[i]->num_postings[found[i]]);
+        }
+    }
+
+    if (!empty && query != NULL &&
+            num_ranks <= planner_estimate(index->planner, query)){
+        // Fewer footpaths with the values: check each against the query
+        int num_kept = 0;
+        for (int i = 0; i < num_ranks; i++){
+            if (rank_in_area(index, ranks[i], query)){
+                ranks[num_kept++] = ranks[i];
+            }
+        }
+        num_ranks = num_kept;
+        plan = "attributes";
+    }else if (!empty && query != NULL){
+        // Fewer in the query: search the tree & intersect
+        matched_records_t *matches = record_struct_create(index->table);
+        range_query(get_root(index->qtree), query, matches, NULL);
+        int num_matches = matched_record_count(matches);
+        uint32_t *spatial = malloc(sizeof(uint32_t) * (num_matches + 1));
+        assert(spatial);
+        int sorted = TRUE;
+        for (int i = 0; i < num_matches; i++){
+            spatial[i] = index->record_ranks[matched_record_id(matches, i)];
+            sorted = sorted && (i == 0 || spatial[i - 1] < spatial[i]);
+        }
+        if (!sorted){
+            // Footpaths sharing an id may be kept in either order
+            qsort(spatial, num_matches, sizeof(uint32_t), uint_cmp);
+        }
+        if (num_matches < num_ranks){
+            num_ranks = postings_intersect(spatial, num_matches, ranks,
+                                           num_ranks);
+            free(ranks);
+            ranks = spatial;
+        }else{
+            num_ranks = postings_intersect(ranks, num_ranks, spatial,
+                                           num_matches);
+            free(spatial);
+        }
+        matched_record_struct_free(matches);
+        plan = "spatial";
+    }
+
+    matched_records_t *results = record_struct_create(index->table);
+    for (int i = 0; i < num_ranks; i++){
+        matched_record_append(results, index->rank_records[ranks[i]]);
+    }
+    match_record_output(results, f);
+    fprintf(summary, " %d footpaths", num_ranks);
+    if (plan != NULL){
+        fprintf(summary, ", %s first", plan);
+    }
+    matched_record_struct_free(results);
+    free(ranks);
+}
+
+
+/* Find the value in the column's sorted values, UNDEFINED if not there */
+static int postings_find(column_index_t *column, const char *value){
+    int low = 0, high = column->num_values - 1;
+    while (low <= high){
+        int mid = low + (high - low) / 2;
+        int cmp = strcmp(column->values[mid], value);
+        if (cmp == 0){
+            return mid;
+        }else if (cmp < 0){
+            low = mid + 1;
+        }else{
+            high = mid - 1;
+        }
+    }
+    return UNDEFINED;
+}
+
+
+/* Keep in small(sorted) only the ranks also in large(sorted), returning
+how many are left. Each is found by galloping on from the last found */
+static int postings_intersect(uint32_t *small, int num_small,
+                              const uint32_t *large, int num_large){
+    int num_kept = 0;
+    int low = 0;
+    for (int i = 0; i < num_small && low < num_large; i++){
+        uint32_t rank = small[i];
+
+        // Double the step until past the rank, then binary search
+        int step = 1, high = low;
+        while (high < num_large && large[high] < rank){
+            low = high + 1;
+            high += step;
+            step *= 2;
+        }
+        if (high > num_large){
+            high = num_large;
+        }
+        while (low < high){
+            int mid = low + (high - low) / 2;
+            if (large[mid] < rank){
+                low = mid + 1;
+            }else{
+                high = mid;
+            }
+        }
+        if (low < num_large && large[low] == rank){
+            small[num_kept++] = rank;
+            low++;
+        }
+    }
+    return num_kept;
+}
+
+
+/* TRUE if the footpath at the rank has a point in the query(and in the
+area of the tree, as the tree search would find) */
+static int rank_in_area(attribute_index_t *index, uint32_t rank,
+                        rectangle_t *query){
+    footpath_t *buffer = record_buffer_create();
+    footpath_t *footpath = record_table_get(index->table,
+                                            index->rank_records[rank], buffer);
+    rectangle_t *area = get_root_rectangle(index->qtree);
+    point_t *ends[2] = {get_start_point(footpath), get_end_point(footpath)};
+    record_buffer_free(buffer);
+    int inside = FALSE;
+    for (int i = 0; i < 2; i++){
+        if (in_rectangle(area, ends[i]) && in_rectangle(query, ends[i])){
+            inside = TRUE;
+        }
+        point_free(ends[i]);
+    }
+    return inside;
+}
+
+
+/* Compare rank entries by footpath id, then by record id */
+static int rank_cmp(const void *a, const void *b){
+    const rank_entry_t *entry1 = a, *entry2 = b;
+    if (entry1->footpath_id != entry2->footpath_id){
+        return entry1->footpath_id < entry2->footpath_id ? -1 : 1;
+    }
+    return (entry1->record > entry2->record) -
+           (entry1->record < entry2->record);
+}
+
+
+/* Compare column entries by value, then by rank */
+static int entry_cmp(const void *a, const void *b){
+    const column_entry_t *entry1 = a, *entry2 = b;
+    int cmp = strcmp(entry1->value, entry2->value);
+    if (cmp != 0){
+        return cmp;
+    }
+    return (entry1->rank > entry2->rank) - (entry1->rank < entry2->rank);
+}
+
+
+/* Compare ranks */
+static int uint_cmp(const void *a, const void *b){
+    uint32_t rank1 = *(const uint32_t*)a, rank2 = *(const uint32_t*)b;
+    return (rank1 > rank2) - (rank1 < rank2);
+}
+
+
+/* Free the index(the tree & records are left alone)*/
+void attribute_index_free(attribute_index_t *index){
+    for (int column = 0; column < NUM_COLUMNS; column++){
+        column_index_t *col = &index->columns[column];
+        for (int i = 0; i < col->num_values; i++){
+            free(col->values[i]);
+        }
+        free(col->values);
+        free(col->first);
+        free(col->num_postings);
+        free(col->postings);
+    }
+    planner_free(index->planner);
+    free(index->rank_records);
+    free(index->record_ranks);
+    free(index);
+}
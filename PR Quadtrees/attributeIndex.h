@@ -0,0 +1,15 @@
+#ifndef _ATTRIBUTEINDEX_H_
+#define _ATTRIBUTEINDEX_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+typedef struct attribute_index attribute_index_t;
+
+attribute_index_t *attribute_index_create(quadtree_t *qtree);
+int attribute_column(const char *name);
+void attribute_ranged_query(attribute_index_t *index, rectangle_t *query,
+                            int *column_ids, char **values,
+                            int num_predicates, FILE *f, FILE *summary);
+void attribute_index_free(attribute_index_t *index);
+#endif
@@ -0,0 +1,117 @@
+/* batchRangeQuery.c
+*
+* Created by Ke Liao
+*
+* This module answers a batch of rectangle queries in a single walk of the 
+* tree. Each node is visited once for all the queries still overlapping it,
+* rather than once per query, so nearby queries share the work of the upper
+* levels. The records and directions of each query come out exactly as if
+* the query was run on its own with tree_ranged_query.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "compressedQuadTree.h"
+#include "batchRangeQuery.h"
+#include "usefulConsts.h"
+
+// What is shared by every node of one batch walk
+typedef struct batch{
+    rectangle_t **queries;
+    matched_records_t **matches;
+    FILE **traces;
+} batch_t;
+
+
+static void batch_query(batch_t *batch, quadtree_node_t *node, int *active,
+                        int num_active);
+
+
+/* Search the tree for every query at once, storing the matched records of
+queries[i] in matches[i] and printing its directions to traces[i] */
+void tree_batch_ranged_query(quadtree_t *quadtree, rectangle_t **queries,
+                             int num_queries, matched_records_t **matches,
+                             FILE **traces){
+    batch_t batch = {queries, matches, traces};
+
+    // Queries not within scope covered by the tree are done already
+    int *active = malloc(sizeof(int) * (num_queries + 1));
+    assert(active != NULL);
+    int num_active = 0;
+    for (int i = 0; i < num_queries; i++){
+        if (rectangle_overlap(queries[i], quadtree->root->rectangle)){
+            active[num_active++] = i;
+        }
+    }
+    if (num_active > 0){
+        batch_query(&batch, quadtree->root, active, num_active);
+    }
+    free(active);
+}
+
+
+/* Check the node for the records of the active queries(indexes into the 
+batch), moving on to the children with the queries that overlap each */
+static void batch_query(batch_t *batch, quadtree_node_t *node, int *active,
+                        int num_active){
+    
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL){
+            return;
+        }
+        point_t *dt_point_loc = get_dt_point_loc(node->dt_point);
+        record_id_t *node_records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+        for (int i = 0; i < num_active; i++){
+            int query = active[i];
+            if (in_rectangle(batch->queries[query], dt_point_loc)){
+                for (int j = 0; j < num_records; j++){
+                    matched_record_insert(batch->matches[query], 
+                                          node_records[j]);
+                }
+            }
+        }
+        return;
+    }
+
+    // Start fetching the children while the first is tested
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        __builtin_prefetch(get_child(node, quad));
+    }
+
+    // Explore branches that overlap, in the order SW, NW, NE, SE
+    int *child_active = malloc(sizeof(int) * num_active);
+    assert(child_active != NULL);
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+        for (int child_quad = SW_QUADRANT; child_quad <= SE_QUADRANT;
+                child_quad++){
+            __builtin_prefetch(get_child(child, child_quad));
+        }
+        
+        int num_child_active = 0;
+        for (int i = 0; i < num_active; i++){
+            int query = active[i];
+            if (rectangle_overlap(batch->queries[query], child->rectangle)){
+                child_path_print(child, quad, batch->traces[query]);
+                child_active[num_child_active++] = query;
+            }else if (child->skipped > 0){
+                skipped_levels_print(node, quad, batch->queries[query], NULL,
+                                     batch->traces[query]);
+            }
+        }
+        if (num_child_active > 0){
+            batch_query(batch, child, child_active, num_child_active);
+        }
+    }
+    free(child_active);
+}
@@ -0,0 +1,9 @@
+#ifndef _BATCHRANGEQUERY_H_
+#define _BATCHRANGEQUERY_H_
+#include <stdio.h>
+#include "quadTree.h"
+
+void tree_batch_ranged_query(quadtree_t *quadtree, rectangle_t **queries,
+                             int num_queries, matched_records_t **matches,
+                             FILE **traces);
+#endif
@@ -0,0 +1,195 @@
+/* bufferPool.c
+*
+* Created by Ke Liao
+*
+* This module caches the pages of a file in a fixed number of frames, so
+* only as much of the file as the memory cap allows is held at once. When
+* every frame is taken the page to drop is chosen by CLOCK: the frames are
+* passed over in a circle, each recently used page gets its reference bit
+* cleared & a second chance, and the first page found without it is
+* replaced.
+*
+* Page hits, reads & evictions are counted for the statistics.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include "bufferPool.h"
+#include "usefulConsts.h"
+
+#define NO_FRAME -1
+#define NO_PAGE UINT32_MAX
+
+struct buffer_pool{
+    int fd;
+    uint32_t num_pages;     // pages in the file
+    int *page_frames;       // frame holding each page, or NO_FRAME
+
+    int num_frames;
+    char *frames;           // num_frames pages of memory
+    uint32_t *frame_pages;  // page held by each frame, or NO_PAGE
+    char *referenced;       // CLOCK reference bit of each frame
+    int hand;
+
+    long hits;
+    long reads;
+    long evictions;
+};
+
+static int frame_claim(buffer_pool_t *pool);
+
+
+/* Create a pool over the num_pages pages of the file using at most capacity
+bytes for the frames(at least one frame)*/
+buffer_pool_t *buffer_pool_create(int fd, uint32_t num_pages,
+                                  size_t capacity){
+    buffer_pool_t *pool = malloc(sizeof(*pool));
+    assert(pool);
+    pool->fd = fd;
+    pool->num_pages = num_pages;
+    pool->page_frames = malloc(sizeof(int) * (num_pages + 1));
+    assert(pool->page_frames);
+    for (uint32_t page = 0; page < num_pages; page++){
+        pool->page_frames[page] = NO_FRAME;
+    }
+
+    // No use keeping more frames than the file has pages
+    size_t num_frames = capacity / DISK_PAGE_SIZE;
+    if (num_frames > num_pages){
+        num_frames = num_pages;
+    }
+    if (num_frames < 1){
+        num_frames = 1;
+    }
+    pool->num_frames = num_frames;
+    pool->frames = malloc((size_t)DISK_PAGE_SIZE * num_frames);
+    pool->frame_pages = malloc(sizeof(uint32_t) * num_frames);
+    pool->referenced = calloc(num_frames, sizeof(char));
+    assert(pool->frames && pool->frame_pages && pool->referenced);
+    for (int frame = 0; frame < pool->num_frames; frame++){
+        pool->frame_pages[frame] = NO_PAGE;
+    }
+    pool->hand = 0;
+
+    pool->hits = 0;
+    pool->reads = 0;
+    pool->evictions = 0;
+    return pool;
+}
+
+
+/* Get the contents of the page, reading it into a frame if it isn't held.
+Stays valid until the next page is got */
+char *buffer_pool_get(buffer_pool_t *pool, uint32_t page){
+    assert(page < pool->num_pages);
+    int frame = pool->page_frames[page];
+    if (frame != NO_FRAME){
+        pool->hits++;
+        pool->referenced[frame] = TRUE;
+        return pool->frames + (size_t)frame * DISK_PAGE_SIZE;
+    }
+
+    frame = frame_claim(pool);
+    char *contents = pool->frames + (size_t)frame * DISK_PAGE_SIZE;
+    if (!file_read_at(pool->fd, contents, DISK_PAGE_SIZE,
+                      (uint64_t)page * DISK_PAGE_SIZE)){
+        fprintf(stderr, "Can't read page %u of the page file\n", page);
+        exit(EXIT_FAILURE);
+    }
+    pool->reads++;
+    pool->frame_pages[frame] = page;
+    pool->page_frames[page] = frame;
+    pool->referenced[frame] = TRUE;
+    return contents;
+}
+
+
+/* Find a frame to read a page into, evicting the first page the clock hand
+reaches that wasn't used since it last passed */
+static int frame_claim(buffer_pool_t *pool){
+    while (TRUE){
+        int frame = pool->hand;
+        pool->hand = (pool->hand + 1) % pool->num_frames;
+
+        uint32_t page = pool->frame_pages[frame];
+        if (page == NO_PAGE){
+            return frame;
+        }
+        if (pool->referenced[frame]){
+            pool->referenced[frame] = FALSE;   // second chance
+            continue;
+        }
+        pool->page_frames[page] = NO_FRAME;
+        pool->frame_pages[frame] = NO_PAGE;
+        pool->evictions++;
+        return frame;
+    }
+}
+
+
+/* Read len bytes from the offset of the file into dest, going on after
+interrupted or short reads. Returns FALSE if the file ends first or can't be
+read */
+int file_read_at(int fd, void *dest, size_t len, uint64_t offset){
+    char *out = dest;
+    while (len > 0){
+        ssize_t got = pread(fd, out, len, (off_t)offset);
+        if (got < 0 && errno == EINTR){
+            continue;
+        }
+        if (got <= 0){
+            return FALSE;
+        }
+        out += got;
+        offset += got;
+        len -= got;
+    }
+    return TRUE;
+}
+
+
+/* Copy len bytes from the offset of the file to dest, through the pages
+they lie on */
+void buffer_pool_read(buffer_pool_t *pool, uint64_t offset, void *dest,
+                      size_t len){
+    char *out = dest;
+    while (len > 0){
+        uint32_t page = offset / DISK_PAGE_SIZE;
+        size_t in_page = offset % DISK_PAGE_SIZE;
+        size_t chunk = DISK_PAGE_SIZE - in_page;
+        if (chunk > len){
+            chunk = len;
+        }
+        memcpy(out, buffer_pool_get(pool, page) + in_page, chunk);
+        out += chunk;
+        offset += chunk;
+        len -= chunk;
+    }
+}
+
+
+/* Print the page statistics of the pool to f */
+void buffer_pool_stats_print(buffer_pool_t *pool, FILE *f){
+    long requests = pool->hits + pool->reads;
+    fprintf(f, "buffer pool: %d frames of %d bytes, %u pages in file\n",
+            pool->num_frames, DISK_PAGE_SIZE, pool->num_pages);
+    fprintf(f, "page requests: %ld, hits: %ld(%.1f%%), reads: %ld, "
+            "evictions: %ld, bytes read: %ld\n", requests, pool->hits,
+            requests ? 100.0 * pool->hits / requests : 0.0, pool->reads,
+            pool->evictions, pool->reads * DISK_PAGE_SIZE);
+}
+
+
+/* Free the pool(the file is left open)*/
+void buffer_pool_free(buffer_pool_t *pool){
+    free(pool->page_frames);
+    free(pool->frames);
+    free(pool->frame_pages);
+    free(pool->referenced);
+    free(pool);
+}
@@ -0,0 +1,18 @@
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+#include <stdio.h>
+#include <stdint.h>
+
+#define DISK_PAGE_SIZE 4096
+
+typedef struct buffer_pool buffer_pool_t;
+
+buffer_pool_t *buffer_pool_create(int fd, uint32_t num_pages,
+                                  size_t capacity);
+char *buffer_pool_get(buffer_pool_t *pool, uint32_t page);
+void buffer_pool_read(buffer_pool_t *pool, uint64_t offset, void *dest,
+                      size_t len);
+int file_read_at(int fd, void *dest, size_t len, uint64_t offset);
+void buffer_pool_stats_print(buffer_pool_t *pool, FILE *f);
+void buffer_pool_free(buffer_pool_t *pool);
+#endif
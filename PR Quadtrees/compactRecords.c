@@ -0,0 +1,419 @@
+/* compactRecords.c
+*
+* Created by Ke Liao
+*
+* This module keeps footpath records packed into bytes, for datasets too
+* large to hold as structs. Each record is packed as it is read & only
+* unpacked when it is got from the table(e.g. to be output):
+*   text fields     each distinct string is kept once & records hold its
+*                   number in the table of strings
+*   coordinates     each distinct point is kept once(the ends of
+*                   footpaths meeting at a junction are the same point) &
+*                   records hold the start's number & the gap to the end's
+*   id fields       mcc_id, statusid etc. as the difference from the first
+*                   record's value(frame of reference)
+*   decimal fields  deltaz, distance etc. in hundredths, unless that
+*                   doesn't give back the same double, then as is
+* Numbers are written as varints(7 bits a byte, small ones in 1 or 2
+* bytes), differences zigzag encoded so small negatives stay small. The
+* footpath id is kept unpacked as it's compared so often.
+*
+* Records are unpacked into a struct the caller passes in, which holds it
+* until the struct is reused. Its strings belong to the table & must not be
+* freed.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include "footpathData.h"
+#include "footpathInternal.h"
+#include "compactRecords.h"
+#include "usefulConsts.h"
+
+#define INITIAL_SIZE 64
+#define MAX_PACKED 160        // most bytes a record can pack into
+#define NUM_TEXTS 4
+#define NUM_INTS 5
+#define NUM_DECIMALS 5
+#define DECIMAL_SCALE 100     // decimals are packed in hundredths
+#define MAX_SCALED 1e15       // larger decimals are kept as is
+#define EMPTY_SLOT UINT32_MAX
+
+struct compact_records{
+    int num_records, max_records;
+    int *footpath_ids;
+    uint32_t *offsets;        // where each record's bytes start
+    uint8_t *bytes;
+    size_t num_bytes, max_bytes;
+
+    // Distinct strings, with a hash table of their numbers
+    char **texts;
+    uint32_t num_texts, max_texts;
+    uint32_t *text_slots;
+    uint32_t num_text_slots;
+
+    // Distinct points as latitude & longitude, with a hash table likewise
+    double *points;
+    uint32_t num_points, max_points;
+    uint32_t *point_slots;
+    uint32_t num_point_slots;
+
+    int int_bases[NUM_INTS];  // first record's id fields
+};
+
+static uint32_t text_intern(compact_records_t *compact, const char *text);
+static uint32_t point_intern(compact_records_t *compact, double lat,
+                             double lon);
+static uint64_t text_hash(const char *text);
+static uint64_t point_hash(double lat, double lon);
+static uint32_t *slots_grow(uint32_t *slots, uint32_t *num_slots,
+                            uint32_t num_used, uint64_t (*hash)(void *,
+                            uint32_t), void *owner);
+static uint64_t text_slot_hash(void *owner, uint32_t id);
+static uint64_t point_slot_hash(void *owner, uint32_t id);
+static void varint_put(compact_records_t *compact, uint64_t value);
+static uint64_t varint_get(const uint8_t **bytes);
+static uint64_t zigzag(int64_t value);
+static int64_t unzigzag(uint64_t value);
+
+
+/* Create an empty store */
+compact_records_t *compact_records_create(){
+    compact_records_t *compact = malloc(sizeof(*compact));
+    assert(compact != NULL);
+    compact->num_records = 0;
+    compact->max_records = INITIAL_SIZE;
+    compact->footpath_ids = malloc(sizeof(int) * compact->max_records);
+    compact->offsets = malloc(sizeof(uint32_t) * compact->max_records);
+    compact->num_bytes = 0;
+    compact->max_bytes = INITIAL_SIZE * MAX_PACKED;
+    compact->bytes = malloc(compact->max_bytes);
+    assert(compact->footpath_ids && compact->offsets && compact->bytes);
+
+    compact->num_texts = compact->num_points = 0;
+    compact->max_texts = compact->max_points = INITIAL_SIZE;
+    compact->texts = malloc(sizeof(char*) * compact->max_texts);
+    compact->points = malloc(sizeof(double) * 2 * compact->max_points);
+    compact->num_text_slots = compact->num_point_slots = 2 * INITIAL_SIZE;
+    compact->text_slots = malloc(sizeof(uint32_t) * 2 * INITIAL_SIZE);
+    compact->point_slots = malloc(sizeof(uint32_t) * 2 * INITIAL_SIZE);
+    assert(compact->texts && compact->points);
+    assert(compact->text_slots && compact->point_slots);
+    for (int i = 0; i < 2 * INITIAL_SIZE; i++){
+        compact->text_slots[i] = compact->point_slots[i] = EMPTY_SLOT;
+    }
+    return compact;
+}
+
+
+/* Pack the record into the store, returning its id. The record itself
+(and its strings) is left to the caller */
+uint32_t compact_records_add(compact_records_t *compact, footpath_t *record){
+    if (compact->num_records == compact->max_records){
+        compact->max_records *= 2;
+        compact->footpath_ids = realloc(compact->footpath_ids,
+                                        sizeof(int) * compact->max_records);
+        compact->offsets = realloc(compact->offsets,
+                                   sizeof(uint32_t) * compact->max_records);
+        assert(compact->footpath_ids && compact->offsets);
+    }
+    if (compact->num_bytes + MAX_PACKED > compact->max_bytes){
+        compact->max_bytes *= 2;
+        compact->bytes = realloc(compact->bytes, compact->max_bytes);
+        assert(compact->bytes);
+    }
+    assert(compact->num_bytes + MAX_PACKED < UINT32_MAX);
+
+    uint32_t id = compact->num_records++;
+    compact->footpath_ids[id] = record->footpath_id;
+    compact->offsets[id] = compact->num_bytes;
+
+    int ints[NUM_INTS] = {record->mcc_id, record->mccid_int,
+                          record->statusid, record->streetid,
+                          record->street_group};
+    if (id == 0){
+        memcpy(compact->int_bases, ints, sizeof(ints));
+    }
+
+    // Flags of the decimals kept as is go first
+    size_t flags = compact->num_bytes++;
+    compact->bytes[flags] = 0;
+
+    char *texts[NUM_TEXTS] = {record->address, record->clue_sa,
+                              record->asset_type, record->segside};
+    for (int i = 0; i < NUM_TEXTS; i++){
+        varint_put(compact, text_intern(compact, texts[i]));
+    }
+    for (int i = 0; i < NUM_INTS; i++){
+        varint_put(compact, zigzag((int64_t)ints[i] -
+                                   compact->int_bases[i]));
+    }
+
+    double decimals[NUM_DECIMALS] = {record->deltaz, record->distance,
+                                     record->grade1in, record->rlmax,
+                                     record->rlmin};
+    for (int i = 0; i < NUM_DECIMALS; i++){
+        double value = decimals[i];
+        if (fabs(value) < MAX_SCALED){
+            long long scaled = llround(value * DECIMAL_SCALE);
+            double unpacked = (double)scaled / DECIMAL_SCALE;
+            if (memcmp(&unpacked, &value, sizeof(double)) == 0){
+                varint_put(compact, zigzag(scaled));
+                continue;
+            }
+        }
+        compact->bytes[flags] |= 1 << i;
+        memcpy(compact->bytes + compact->num_bytes, &value, sizeof(double));
+        compact->num_bytes += sizeof(double);
+    }
+
+    uint32_t start = point_intern(compact, record->start_lat,
+                                  record->start_lon);
+    uint32_t end = point_intern(compact, record->end_lat, record->end_lon);
+    varint_put(compact, start);
+    varint_put(compact, zigzag((int64_t)end - start));
+    return id;
+}
+
+
+/* Unpack the record with the id into the record passed in, returning it */
+footpath_t *compact_records_get(compact_records_t *compact, uint32_t id,
+                                footpath_t *record){
+    assert(id < (uint32_t)compact->num_records && record != NULL);
+
+    const uint8_t *bytes = compact->bytes + compact->offsets[id];
+    uint8_t flags = *bytes++;
+    record->footpath_id = compact->footpath_ids[id];
+
+    char **texts[NUM_TEXTS] = {&record->address, &record->clue_sa,
+                               &record->asset_type, &record->segside};
+    for (int i = 0; i < NUM_TEXTS; i++){
+        *texts[i] = compact->texts[varint_get(&bytes)];
+    }
+    int *ints[NUM_INTS] = {&record->mcc_id, &record->mccid_int,
+                           &record->statusid, &record->streetid,
+                           &record->street_group};
+    for (int i = 0; i < NUM_INTS; i++){
+        *ints[i] = (int)(compact->int_bases[i] +
+                         unzigzag(varint_get(&bytes)));
+    }
+    double *decimals[NUM_DECIMALS] = {&record->deltaz, &record->distance,
+                                      &record->grade1in, &record->rlmax,
+                                      &record->rlmin};
+    for (int i = 0; i < NUM_DECIMALS; i++){
+        if (flags & (1 << i)){
+            memcpy(decimals[i], bytes, sizeof(double));
+            bytes += sizeof(double);
+        }else{
+            *decimals[i] = (double)unzigzag(varint_get(&bytes)) /
+                           DECIMAL_SCALE;
+        }
+    }
+
+    uint32_t start = varint_get(&bytes);
+    uint32_t end = start + unzigzag(varint_get(&bytes));
+    record->start_lat = compact->points[2 * start];
+    record->start_lon = compact->points[2 * start + 1];
+    record->end_lat = compact->points[2 * end];
+    record->end_lon = compact->points[2 * end + 1];
+    return record;
+}
+
+
+/* Get the footpath id of the record with the id without unpacking it */
+int compact_records_footpath_id(compact_records_t *compact, uint32_t id){
+    assert(id < (uint32_t)compact->num_records);
+    return compact->footpath_ids[id];
+}
+
+
+/* Get the number of records in the store */
+int compact_records_size(compact_records_t *compact){
+    return compact->num_records;
+}
+
+
+/* Number of the string in the table of strings, adding a copy if new */
+static uint32_t text_intern(compact_records_t *compact, const char *text){
+    uint32_t mask = compact->num_text_slots - 1;
+    uint32_t slot = text_hash(text) & mask;
+    while (compact->text_slots[slot] != EMPTY_SLOT){
+        uint32_t id = compact->text_slots[slot];
+        if (strcmp(compact->texts[id], text) == 0){
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (compact->num_texts == compact->max_texts){
+        compact->max_texts *= 2;
+        compact->texts = realloc(compact->texts,
+                                 sizeof(char*) * compact->max_texts);
+        assert(compact->texts);
+    }
+    uint32_t id = compact->num_texts++;
+    compact->texts[id] = malloc(strlen(text) + 1);
+    assert(compact->texts[id]);
+    strcpy(compact->texts[id], text);
+    compact->text_slots[slot] = id;
+
+    // Keep the hash table at most half full
+    if (2 * compact->num_texts > compact->num_text_slots){
+        compact->text_slots = slots_grow(compact->text_slots,
+            &compact->num_text_slots, compact->num_texts, text_slot_hash,
+            compact);
+    }
+    return id;
+}
+
+
+/* Number of the point in the table of points, adding it if new */
+static uint32_t point_intern(compact_records_t *compact, double lat,
+                             double lon){
+    uint32_t mask = compact->num_point_slots - 1;
+    uint32_t slot = point_hash(lat, lon) & mask;
+    while (compact->point_slots[slot] != EMPTY_SLOT){
+        uint32_t id = compact->point_slots[slot];
+        if (memcmp(&compact->points[2 * id], &lat, sizeof(double)) == 0 &&
+                memcmp(&compact->points[2 * id + 1], &lon,
+                       sizeof(double)) == 0){
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (compact->num_points == compact->max_points){
+        compact->max_points *= 2;
+        compact->points = realloc(compact->points,
+                                  sizeof(double) * 2 * compact->max_points);
+        assert(compact->points);
+    }
+    uint32_t id = compact->num_points++;
+    compact->points[2 * id] = lat;
+    compact->points[2 * id + 1] = lon;
+    compact->point_slots[slot] = id;
+
+    if (2 * compact->num_points > compact->num_point_slots){
+        compact->point_slots = slots_grow(compact->point_slots,
+            &compact->num_point_slots, compact->num_points, point_slot_hash,
+            compact);
+    }
+    return id;
+}
+
+
+/* Double a hash table of numbers, placing them again */
+static uint32_t *slots_grow(uint32_t *slots, uint32_t *num_slots,
+                            uint32_t num_used, uint64_t (*hash)(void *,
+                            uint32_t), void *owner){
+    free(slots);
+    *num_slots *= 2;
+    slots = malloc(sizeof(uint32_t) * *num_slots);
+    assert(slots);
+    for (uint32_t i = 0; i < *num_slots; i++){
+        slots[i] = EMPTY_SLOT;
+    }
+    uint32_t mask = *num_slots - 1;
+    for (uint32_t id = 0; id < num_used; id++){
+        uint32_t slot = hash(owner, id) & mask;
+        while (slots[slot] != EMPTY_SLOT){
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+    return slots;
+}
+
+
+/* FNV-1a hash of a string */
+static uint64_t text_hash(const char *text){
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char *c = (const unsigned char*)text; *c; c++){
+        hash = (hash ^ *c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+
+/* Hash of the bits of a point's coordinates */
+static uint64_t point_hash(double lat, double lon){
+    uint64_t lat_bits, lon_bits;
+    memcpy(&lat_bits, &lat, sizeof(double));
+    memcpy(&lon_bits, &lon, sizeof(double));
+    uint64_t hash = (lat_bits ^ (lon_bits * 0x9E3779B97F4A7C15ull)) *
+                    0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 31);
+}
+
+
+/* Hash of a string already in the table */
+static uint64_t text_slot_hash(void *owner, uint32_t id){
+    compact_records_t *compact = owner;
+    return text_hash(compact->texts[id]);
+}
+
+
+/* Hash of a point already in the table */
+static uint64_t point_slot_hash(void *owner, uint32_t id){
+    compact_records_t *compact = owner;
+    return point_hash(compact->points[2 * id], compact->points[2 * id + 1]);
+}
+
+
+/* Write a number 7 bits a byte, low bits first, the top bit set on all but
+the last byte */
+static void varint_put(compact_records_t *compact, uint64_t value){
+    while (value >= 0x80){
+        compact->bytes[compact->num_bytes++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    compact->bytes[compact->num_bytes++] = (uint8_t)value;
+}
+
+
+/* Read a number written by varint_put, moving past it */
+static uint64_t varint_get(const uint8_t **bytes){
+    uint64_t value = 0;
+    int shift = 0;
+    while (**bytes & 0x80){
+        value |= (uint64_t)(**bytes & 0x7F) << shift;
+        shift += 7;
+        (*bytes)++;
+    }
+    value |= (uint64_t)**bytes << shift;
+    (*bytes)++;
+    return value;
+}
+
+
+/* Map signed numbers to unsigned so small negatives stay small */
+static uint64_t zigzag(int64_t value){
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+/* Undo zigzag */
+static int64_t unzigzag(uint64_t value){
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+/* Free the store along with its strings */
+void compact_records_free(compact_records_t *compact){
+    for (uint32_t i = 0; i < compact->num_texts; i++){
+        free(compact->texts[i]);
+    }
+    free(compact->texts);
+    free(compact->text_slots);
+    free(compact->points);
+    free(compact->point_slots);
+    free(compact->footpath_ids);
+    free(compact->offsets);
+    free(compact->bytes);
+    free(compact);
+}
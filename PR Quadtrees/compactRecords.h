@@ -0,0 +1,16 @@
+#ifndef _COMPACTRECORDS_H_
+#define _COMPACTRECORDS_H_
+#include <stdint.h>
+#include "footpathData.h"
+
+typedef struct compact_records compact_records_t;
+
+compact_records_t *compact_records_create();
+uint32_t compact_records_add(compact_records_t *compact,
+                             footpath_t *record);
+footpath_t *compact_records_get(compact_records_t *compact, uint32_t id,
+                                footpath_t *record);
+int compact_records_footpath_id(compact_records_t *compact, uint32_t id);
+int compact_records_size(compact_records_t *compact);
+void compact_records_free(compact_records_t *compact);
+#endif
@@ -0,0 +1,376 @@
+/* compressedInput.c
+*
+* Created by Ke Liao
+*
+* This module opens a dataset that may be compressed(gzip, or zstd when
+* built with make ZSTD=1), told apart by the first bytes of the file. A
+* plain file is opened as usual. A compressed one is given as a stream that
+* looks like any other FILE, but is fed by a thread of its own which
+* decompresses the file a chunk at a time into large buffers, so the file
+* is parsed while the rest is still being decompressed & no decompressed
+* copy is written to disk.
+*
+* The stream has a fixed number of buffers, so the memory used is bounded:
+* when every buffer is full, the thread waits for the parser to finish one.
+* Buffers are read in the order they're filled.
+*
+* A compressed file which is cut short or corrupt ends the program. The
+* stream must only be read from one thread.
+*
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "compressedInput.h"
+#include "usefulConsts.h"
+
+#define INPUT_BUFFERS 4         // decompressed buffers waiting to be parsed
+#define INPUT_BUFFER_KB 256
+#define CHUNK_KB 64             // compressed bytes read at a time
+#define KB 1024
+#define MAGIC_LEN 4
+
+// Formats told apart by their first bytes
+#define PLAIN_FORMAT 0
+#define GZIP_FORMAT 1
+#define ZSTD_FORMAT 2
+
+static const unsigned char GZIP_MAGIC[] = {0x1f, 0x8b};
+static const unsigned char ZSTD_MAGIC[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+// Buffer of decompressed bytes
+typedef struct {
+    char *data;
+    size_t len;
+} read_buffer_t;
+
+typedef struct compressed_input compressed_input_t;
+
+// Decompresses into a buffer until it's full or the file ends
+typedef size_t (*fill_func_t)(compressed_input_t *input, char *out,
+                              size_t size);
+
+struct compressed_input{
+    FILE *source;
+    const char *path;
+    int format;
+    fill_func_t fill;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t buffer_filled, buffer_freed;
+    int stop;        // TRUE once the stream is closed
+    int finished;    // TRUE once the thread has queued all of the file
+
+    size_t buffer_size;
+    read_buffer_t buffers[INPUT_BUFFERS];
+    int free_buffers[INPUT_BUFFERS];  // stack of buffers not in use
+    int num_free;
+    int queue[INPUT_BUFFERS];         // ring of full buffers to be parsed
+    int queue_head, queue_len;
+    int current;     // buffer being parsed, or UNDEFINED
+    size_t pos;      // bytes of it parsed
+
+    // Compressed bytes read from the file but not yet decompressed
+    unsigned char *chunk;
+    int source_done;  // TRUE once the whole file is read
+    int frame_done;   // TRUE when the input so far ends on a whole frame
+    z_stream gzip;
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zstd_in;
+#endif
+};
+
+static int format_detect(FILE *source);
+static ssize_t stream_read(void *cookie, char *buf, size_t size);
+static int stream_close(void *cookie);
+static void *decompress_run(void *arg);
+static size_t gzip_fill(compressed_input_t *input, char *out, size_t size);
+#ifdef HAVE_ZSTD
+static size_t zstd_fill(compressed_input_t *input, char *out, size_t size);
+#endif
+static void input_corrupt(compressed_input_t *input);
+
+
+/* Open the dataset at path for reading, decompressing it on a thread of
+its own if compressed. Returns NULL if it can't be opened */
+FILE *compressed_input_open(const char *path){
+    FILE *source = fopen(path, "r");
+    if (source == NULL){
+        return NULL;
+    }
+    int format = format_detect(source);
+    if (format == PLAIN_FORMAT){
+        return source;
+    }
+#ifndef HAVE_ZSTD
+    if (format == ZSTD_FORMAT){
+        fprintf(stderr, "%s is zstd compressed, build with make ZSTD=1 to "
+                "read it\n", path);
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    compressed_input_t *input = malloc(sizeof(*input));
+    assert(input != NULL);
+    input->source = source;
+    input->path = path;
+    input->format = format;
+    input->stop = input->finished = FALSE;
+    input->buffer_size = (size_t)INPUT_BUFFER_KB * KB;
+    for (int i = 0; i < INPUT_BUFFERS; i++){
+        input->buffers[i].data = malloc(input->buffer_size);
+        assert(input->buffers[i].data != NULL);
+        input->buffers[i].len = 0;
+        input->free_buffers[i] = i;
+    }
+    input->num_free = INPUT_BUFFERS;
+    input->queue_head = input->queue_len = 0;
+    input->current = UNDEFINED;
+    input->pos = 0;
+    input->chunk = malloc(CHUNK_KB * KB);
+    assert(input->chunk != NULL);
+    input->source_done = input->frame_done = FALSE;
+
+    if (format == GZIP_FORMAT){
+        memset(&input->gzip, 0, sizeof(input->gzip));
+
+        // 15 + 16 for the largest window with a gzip header
+        int result = inflateInit2(&input->gzip, 15 + 16);
+        assert(result == Z_OK);
+        input->fill = gzip_fill;
+    }
+#ifdef HAVE_ZSTD
+    if (format == ZSTD_FORMAT){
+        input->zstd = ZSTD_createDStream();
+        assert(input->zstd != NULL);
+        ZSTD_initDStream(input->zstd);
+        input->zstd_in.src = input->chunk;
+        input->zstd_in.size = input->zstd_in.pos = 0;
+        input->fill = zstd_fill;
+    }
+#endif
+
+    pthread_mutex_init(&input->lock, NULL);
+    pthread_cond_init(&input->buffer_filled, NULL);
+    pthread_cond_init(&input->buffer_freed, NULL);
+    int created = pthread_create(&input->thread, NULL, decompress_run, input);
+    assert(created == 0);
+
+    cookie_io_functions_t functions = {stream_read, NULL, NULL, stream_close};
+    FILE *f = fopencookie(input, "r", functions);
+    assert(f != NULL);
+
+    /* The stream is only parsed on one thread, so skip locking it for every
+    character read(which otherwise costs more than the decompressing) */
+    __fsetlocking(f, FSETLOCKING_BYCALLER);
+    return f;
+}
+
+
+/* Tell the format of the file from its first bytes, leaving it at its
+start */
+static int format_detect(FILE *source){
+    unsigned char magic[MAGIC_LEN];
+    size_t len = fread(magic, 1, MAGIC_LEN, source);
+    rewind(source);
+    if (len >= sizeof(GZIP_MAGIC) &&
+            memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0){
+        return GZIP_FORMAT;
+    }
+    if (len >= sizeof(ZSTD_MAGIC) &&
+            memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0){
+        return ZSTD_FORMAT;
+    }
+    return PLAIN_FORMAT;
+}
+
+
+/* Copy what's left of the buffer being parsed, waiting for the thread to
+fill the next if there's none. Returns 0 at the end of the file */
+static ssize_t stream_read(void *cookie, char *buf, size_t size){
+    compressed_input_t *input = cookie;
+    if (input->current == UNDEFINED){
+        pthread_mutex_lock(&input->lock);
+        while (input->queue_len == 0 && !input->finished){
+            pthread_cond_wait(&input->buffer_filled, &input->lock);
+        }
+        if (input->queue_len == 0){
+            pthread_mutex_unlock(&input->lock);
+            return 0;
+        }
+        input->current = input->queue[input->queue_head];
+        input->queue_head = (input->queue_head + 1) % INPUT_BUFFERS;
+        input->queue_len--;
+        pthread_mutex_unlock(&input->lock);
+        input->pos = 0;
+    }
+
+    read_buffer_t *buffer = &input->buffers[input->current];
+    size_t len = buffer->len - input->pos;
+    if (len > size){
+        len = size;
+    }
+    memcpy(buf, buffer->data + input->pos, len);
+    input->pos += len;
+
+    // Give the buffer back once it's all parsed
+    if (input->pos == buffer->len){
+        pthread_mutex_lock(&input->lock);
+        input->free_buffers[input->num_free++] = input->current;
+        pthread_cond_signal(&input->buffer_freed);
+        pthread_mutex_unlock(&input->lock);
+        input->current = UNDEFINED;
+    }
+    return len;
+}
+
+
+/* Stop the thread(whether or not the whole file was read) & free the
+stream */
+static int stream_close(void *cookie){
+    compressed_input_t *input = cookie;
+    pthread_mutex_lock(&input->lock);
+    input->stop = TRUE;
+    pthread_cond_signal(&input->buffer_freed);
+    pthread_mutex_unlock(&input->lock);
+    pthread_join(input->thread, NULL);
+
+    if (input->format == GZIP_FORMAT){
+        inflateEnd(&input->gzip);
+    }
+#ifdef HAVE_ZSTD
+    if (input->format == ZSTD_FORMAT){
+        ZSTD_freeDStream(input->zstd);
+    }
+#endif
+    pthread_mutex_destroy(&input->lock);
+    pthread_cond_destroy(&input->buffer_filled);
+    pthread_cond_destroy(&input->buffer_freed);
+    for (int i = 0; i < INPUT_BUFFERS; i++){
+        free(input->buffers[i].data);
+    }
+    free(input->chunk);
+    int result = fclose(input->source);
+    free(input);
+    return result;
+}
+
+
+/* Thread body: decompress the file into free buffers & queue them in order
+until the file ends or the stream is closed */
+static void *decompress_run(void *arg){
+    compressed_input_t *input = arg;
+    pthread_mutex_lock(&input->lock);
+    while (TRUE){
+        while (input->num_free == 0 && !input->stop){
+            pthread_cond_wait(&input->buffer_freed, &input->lock);
+        }
+        if (input->stop){
+            break;
+        }
+        int next = input->free_buffers[--input->num_free];
+        pthread_mutex_unlock(&input->lock);
+
+        read_buffer_t *buffer = &input->buffers[next];
+        buffer->len = input->fill(input, buffer->data, input->buffer_size);
+
+        pthread_mutex_lock(&input->lock);
+        if (buffer->len == 0){
+            input->free_buffers[input->num_free++] = next;
+            break;
+        }
+        int tail = (input->queue_head + input->queue_len) % INPUT_BUFFERS;
+        input->queue[tail] = next;
+        input->queue_len++;
+        pthread_cond_signal(&input->buffer_filled);
+    }
+    input->finished = TRUE;
+    pthread_cond_signal(&input->buffer_filled);
+    pthread_mutex_unlock(&input->lock);
+    return NULL;
+}
+
+
+/* Decompress gzip data into out until it's full or the file ends,
+returning the bytes written. Files of several gzip members joined together
+are read as one */
+static size_t gzip_fill(compressed_input_t *input, char *out, size_t size){
+    z_stream *gzip = &input->gzip;
+    gzip->next_out = (unsigned char*)out;
+    gzip->avail_out = size;
+    while (gzip->avail_out > 0){
+        if (gzip->avail_in == 0 && !input->source_done){
+            gzip->next_in = input->chunk;
+            gzip->avail_in = fread(input->chunk, 1, CHUNK_KB * KB,
+                                   input->source);
+            input->source_done = gzip->avail_in == 0;
+        }
+        if (gzip->avail_in == 0){
+            if (!input->frame_done){
+                input_corrupt(input);
+            }
+            break;
+        }
+
+        input->frame_done = FALSE;
+        int result = inflate(gzip, Z_NO_FLUSH);
+        if (result == Z_STREAM_END){
+            input->frame_done = TRUE;
+            inflateReset(gzip);
+        }else if (result != Z_OK && result != Z_BUF_ERROR){
+            input_corrupt(input);
+        }
+    }
+    return size - gzip->avail_out;
+}
+
+
+#ifdef HAVE_ZSTD
+/* Decompress zstd data into out until it's full or the file ends,
+returning the bytes written */
+static size_t zstd_fill(compressed_input_t *input, char *out, size_t size){
+    ZSTD_outBuffer zstd_out = {out, size, 0};
+    ZSTD_inBuffer *zstd_in = &input->zstd_in;
+    while (zstd_out.pos < zstd_out.size){
+        if (zstd_in->pos == zstd_in->size && !input->source_done){
+            zstd_in->size = fread(input->chunk, 1, CHUNK_KB * KB,
+                                  input->source);
+            zstd_in->pos = 0;
+            input->source_done = zstd_in->size == 0;
+        }
+        if (zstd_in->pos == zstd_in->size && input->frame_done){
+            break;
+        }
+
+        // Decompress even with no input left, to empty the decoder
+        size_t result = ZSTD_decompressStream(input->zstd, &zstd_out,
+                                              zstd_in);
+        if (ZSTD_isError(result)){
+            input_corrupt(input);
+        }
+        input->frame_done = result == 0;
+        if (input->source_done && zstd_in->pos == zstd_in->size &&
+                !input->frame_done && zstd_out.pos < zstd_out.size){
+            input_corrupt(input);
+        }
+    }
+    return zstd_out.pos;
+}
+#endif
+
+
+/* End the program over a compressed file which can't be read */
+static void input_corrupt(compressed_input_t *input){
+    fprintf(stderr, "%s is corrupt or cut short\n", input->path);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,6 @@
+#ifndef _COMPRESSEDINPUT_H_
+#define _COMPRESSEDINPUT_H_
+#include <stdio.h>
+
+FILE *compressed_input_open(const char *path);
+#endif
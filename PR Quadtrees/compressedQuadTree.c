@@ -0,0 +1,277 @@
+/* compressedQuadTree.c
+*
+* Created by Ke Liao
+*
+* This module contains functions for the construction of path compressed 
+* quad trees. Where two points are very close, a normal PR quad tree has a 
+* long chain of internal nodes each with a single child before the points 
+* are split into different quadrants. A compressed tree leaves those chains
+* out: a node remembers the quadrants of the levels skipped between it and 
+* its parent instead, so the number of nodes depends only on the number of 
+* points. The rectangles of the nodes are the same as in the normal tree. 
+* This module also prints the directions through the skipped levels, so the 
+* searches output exactly what they would on the normal tree.
+*
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "compressedQuadTree.h"
+#include "usefulConsts.h"
+
+
+static void node_insert(quadtree_node_t *node, record_table_t *table,
+                        record_id_t record, point_t *point, int is_root);
+static void leaf_create(quadtree_node_t *node, int quad, record_table_t *table,
+                        record_id_t record, point_t *point);
+static void leaf_split(quadtree_node_t *leaf, record_table_t *table,
+                       record_id_t record, point_t *point, int is_root);
+static void edge_split(quadtree_node_t *node, int quad, record_table_t *table,
+                       record_id_t record, point_t *point);
+static int area_reaches(rectangle_t *cell, rectangle_t *query,
+                        query_shape_t *shape);
+
+
+/* Create a new compressed quad Tree over a defined bot_left & top_right 
+points*/
+quadtree_t *tree_create_compressed(record_table_t *records, point_t *bot_left,
+                                   point_t *top_right){
+    quadtree_t *new_tree = tree_create(records, bot_left, top_right);
+    new_tree->compressed = TRUE;
+    return new_tree;
+}
+
+
+/* Insert record to the compressed tree by the point attached */
+void compressed_insert(quadtree_t *qtree, record_id_t record, point_t *point){
+    
+    // don't insert if not within the tree
+    if (!in_rectangle(qtree->root->rectangle, point)){
+        return;
+    }
+    node_insert(qtree->root, qtree->records, record, point, TRUE);
+}
+
+
+/* Print the direction into the child of quadrant quad along with the 
+directions of the levels it skips to trace(nothing if trace is NULL) */
+void child_path_print(quadtree_node_t *child, int quad, FILE *trace){
+    if (trace == NULL){
+        return;
+    }
+    fprintf(trace, " %s", quadrant_names[quad]);
+    for (int i = 0; i < child->skipped; i++){
+        fprintf(trace, " %s", quadrant_names[(int)child->skip_path[i]]);
+    }
+}
+
+
+/* For a compressed child of quadrant quad which the query rectangle(or the 
+shape if query is NULL) doesn't reach, print the directions of the skipped 
+levels that it does reach to trace, as the search would on the normal tree.
+Nothing is done if trace is NULL */
+void skipped_levels_print(quadtree_node_t *node, int quad, rectangle_t *query,
+                          query_shape_t *shape, FILE *trace){
+    if (trace == NULL){
+        return;
+    }
+    quadtree_node_t *child = get_child(node, quad);
+    rectangle_t *cell = quadrant_assign(node->rectangle, quad);
+    int direction = quad;
+    int level = 0;
+    while (area_reaches(cell, query, shape) && level <= child->skipped){
+        fprintf(trace, " %s", quadrant_names[direction]);
+        if (level == child->skipped){
+            break;
+        }
+        direction = child->skip_path[level];
+        rectangle_t *next_cell = quadrant_assign(cell, direction);
+        rectangle_free(cell);
+        cell = next_cell;
+        level++;
+    }
+    rectangle_free(cell);
+}
+
+
+/* Follow the point query through the levels skipped by the compressed child
+of quadrant quad, printing the directions to trace. Returns TRUE if the query
+reaches the child, FALSE if it leaves the path(where the normal tree has no 
+node) */
+int skipped_levels_query(quadtree_node_t *node, int quad, point_t *query,
+                         FILE *trace){
+    quadtree_node_t *child = get_child(node, quad);
+    
+    // Quick case: the point is inside the child so takes the whole path
+    if (in_rectangle(child->rectangle, query)){
+        for (int i = 0; i < child->skipped; i++){
+            fprintf(trace, " %s", quadrant_names[(int)child->skip_path[i]]);
+        }
+        return TRUE;
+    }
+
+    rectangle_t *cell = quadrant_assign(node->rectangle, quad);
+    for (int i = 0; i < child->skipped; i++){
+        int query_quadrant = determine_quadrant(cell, query);
+        fprintf(trace, " %s", quadrant_names[query_quadrant]);
+        if (query_quadrant != child->skip_path[i]){
+            break;
+        }
+        rectangle_t *next_cell = quadrant_assign(cell, query_quadrant);
+        rectangle_free(cell);
+        cell = next_cell;
+    }
+    rectangle_free(cell);
+    return FALSE;
+}
+
+
+/* Insert record to the appropriate branch below the node, recursively based
+on the point attached */
+static void node_insert(quadtree_node_t *node, record_table_t *table,
+                        record_id_t record, point_t *point, int is_root){
+    
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL){
+            
+            // Only the root of an empty tree is a leaf without a data point
+            node->dt_point = data_point_create(point);
+            record_dt_point_add(node->dt_point, table, record);
+            return;
+        }
+
+        // Add record to the point if record contain the same point
+        point_t *node_point_loc = get_dt_point_loc(node->dt_point);
+        if (point_cmp(node_point_loc, point) == EQUALS){
+            record_dt_point_add(node->dt_point, table, record);
+            point_free(point);  // No longer needed 
+            return;
+        }
+        leaf_split(node, table, record, point, is_root);
+        return;
+    }
+
+    int quad = determine_quadrant(node->rectangle, point);
+    quadtree_node_t *child = get_child(node, quad);
+    if (child == NULL){
+        leaf_create(node, quad, table, record, point);
+    }else if (child->skipped > 0 && !in_rectangle(child->rectangle, point)){
+        edge_split(node, quad, table, record, point);
+    }else{
+        node_insert(child, table, record, point, FALSE);
+    }
+}
+
+
+/* Create a leaf holding the point as the child of quadrant quad */
+static void leaf_create(quadtree_node_t *node, int quad, record_table_t *table,
+                        record_id_t record, point_t *point){
+    rectangle_t *new_quadrant = quadrant_assign(node->rectangle, quad);
+    quadtree_node_t *leaf = tree_node_create(new_quadrant);
+    leaf->dt_point = data_point_create(point);
+    record_dt_point_add(leaf->dt_point, table, record);
+    set_child(node, quad, leaf);
+}
+
+
+/* Turn the leaf into an internal node at the first level where its data 
+point and the new point fall in different quadrants, skipping the levels 
+before that */
+static void leaf_split(quadtree_node_t *leaf, record_table_t *table,
+                       record_id_t record, point_t *point, int is_root){
+    data_point_t *dt_point = leaf->dt_point;
+    point_t *node_point_loc = get_dt_point_loc(dt_point);
+    int old_quad = determine_quadrant(leaf->rectangle, node_point_loc);
+    int new_quad = determine_quadrant(leaf->rectangle, point);
+
+    // Root has to stay over the whole area, so it gets a single child
+    if (is_root && old_quad == new_quad){
+        rectangle_t *new_quadrant = quadrant_assign(leaf->rectangle, old_quad);
+        quadtree_node_t *child = tree_node_create(new_quadrant);
+        child->dt_point = dt_point;
+        leaf->dt_point = NULL;
+        set_child(leaf, old_quad, child);
+        leaf_split(child, table, record, point, FALSE);
+        return;
+    }
+
+    // Move down to where the two points separate
+    while (old_quad == new_quad){
+        leaf->skip_path = realloc(leaf->skip_path, leaf->skipped + 1);
+        assert(leaf->skip_path != NULL);
+        leaf->skip_path[leaf->skipped++] = old_quad;
+        rectangle_t *next_cell = quadrant_assign(leaf->rectangle, old_quad);
+        rectangle_free(leaf->rectangle);
+        leaf->rectangle = next_cell;
+        old_quad = determine_quadrant(leaf->rectangle, node_point_loc);
+        new_quad = determine_quadrant(leaf->rectangle, point);
+    }
+
+    rectangle_t *new_quadrant = quadrant_assign(leaf->rectangle, old_quad);
+    quadtree_node_t *old_leaf = tree_node_create(new_quadrant);
+    old_leaf->dt_point = dt_point;
+    set_child(leaf, old_quad, old_leaf);
+    leaf->dt_point = NULL;  // This node is now an internal node
+    leaf_create(leaf, new_quad, table, record, point);
+}
+
+
+/* The point leaves the path skipped by the child of quadrant quad: add an
+internal node where it leaves, with the old child and a new leaf below it */
+static void edge_split(quadtree_node_t *node, int quad, record_table_t *table,
+                       record_id_t record, point_t *point){
+    quadtree_node_t *child = get_child(node, quad);
+    rectangle_t *cell = quadrant_assign(node->rectangle, quad);
+    int level = 0;
+    int point_quad = determine_quadrant(cell, point);
+    while (point_quad == child->skip_path[level]){
+        rectangle_t *next_cell = quadrant_assign(cell, point_quad);
+        rectangle_free(cell);
+        cell = next_cell;
+        level++;
+        assert(level < child->skipped);
+        point_quad = determine_quadrant(cell, point);
+    }
+
+    // New node takes the levels skipped before the split
+    quadtree_node_t *split_node = tree_node_create(cell);
+    if (level > 0){
+        split_node->skip_path = malloc(level);
+        assert(split_node->skip_path != NULL);
+        memcpy(split_node->skip_path, child->skip_path, level);
+        split_node->skipped = level;
+    }
+
+    // Old child keeps the levels after the split
+    int child_quad = child->skip_path[level];
+    int remaining = child->skipped - level - 1;
+    memmove(child->skip_path, child->skip_path + level + 1, remaining);
+    child->skipped = remaining;
+    if (remaining == 0){
+        free(child->skip_path);
+        child->skip_path = NULL;
+    }
+
+    set_child(split_node, child_quad, child);
+    leaf_create(split_node, point_quad, table, record, point);
+    set_child(node, quad, split_node);
+}
+
+
+/* Check if the query rectangle(or shape if query is NULL) reaches the cell*/
+static int area_reaches(rectangle_t *cell, rectangle_t *query,
+                        query_shape_t *shape){
+    if (query != NULL){
+        return rectangle_overlap(query, cell);
+    }
+    return shape_rectangle_relation(shape, cell) != SHAPE_DISJOINT;
+}
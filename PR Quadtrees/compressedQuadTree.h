@@ -0,0 +1,14 @@
+#ifndef _COMPRESSEDQUADTREE_H_
+#define _COMPRESSEDQUADTREE_H_
+#include "quadTree.h"
+#include "queryShape.h"
+
+quadtree_t *tree_create_compressed(record_table_t *records, point_t *bot_left,
+                                   point_t *top_right);
+void compressed_insert(quadtree_t *qtree, record_id_t record, point_t *point);
+void child_path_print(quadtree_node_t *child, int quad, FILE *trace);
+void skipped_levels_print(quadtree_node_t *node, int quad, rectangle_t *query,
+                          query_shape_t *shape, FILE *trace);
+int skipped_levels_query(quadtree_node_t *node, int quad, point_t *query,
+                         FILE *trace);
+#endif
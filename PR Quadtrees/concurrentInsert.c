@@ -0,0 +1,190 @@
+/* concurrentInsert.c
+*
+* Created by Ke Liao
+*
+* This module lets several threads add records to the same quad tree at the
+* same time, without a lock over the whole tree. Child pointers are only 
+* ever set once, with a compare and swap, and a node never goes back to 
+* being a leaf once it has children, so threads walk down internal nodes 
+* without locking. Only a leaf's data point is guarded, by a spin lock on 
+* that leaf, while a record is added to it or it is split. The records 
+* must already be in the record table, which isn't safe to add to from 
+* several threads.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "concurrentInsert.h"
+#include "usefulConsts.h"
+
+// A thread adding every num_threads-th record of the table
+typedef struct producer{
+    quadtree_t *qtree;
+    int first;
+    int step;
+} producer_t;
+
+
+static quadtree_node_t **child_slot(quadtree_node_t *node, int quad);
+static int has_children(quadtree_node_t *node);
+static quadtree_node_t *child_install(quadtree_node_t *node, int quad,
+                                      quadtree_node_t *child);
+static void *producer_run(void *arg);
+
+
+/* Add a record to the tree, safe to call from several threads at once */
+void concurrent_add_record(quadtree_t *qtree, record_id_t record){
+    assert(!qtree->compressed && !qtree->lazy);
+    footpath_t *buffer = record_buffer_create();
+    footpath_t *footpath = record_table_get(qtree->records, record, buffer);
+    point_t *start_point = get_start_point(footpath);
+    point_t *end_point = get_end_point(footpath);
+    record_buffer_free(buffer);
+    concurrent_insert(qtree->root, qtree->records, record, start_point);
+    concurrent_insert(qtree->root, qtree->records, record, end_point);
+}
+
+
+/* Insert the record by point into the subtree of node, the same way as 
+insert_record but safe with other threads inserting */
+void concurrent_insert(quadtree_node_t *node, record_table_t *table,
+                       record_id_t record, point_t *point){
+    if (!in_rectangle(node->rectangle, point)){
+        point_free(point);
+        return;
+    }
+
+    while (TRUE){
+        if (!has_children(node)){
+            while (__atomic_test_and_set(&node->lock, __ATOMIC_ACQUIRE)){}
+
+            // Another thread may have split the leaf before the lock
+            if (has_children(node)){
+                __atomic_clear(&node->lock, __ATOMIC_RELEASE);
+                continue;
+            }
+
+            if (node->dt_point == NULL){
+                data_point_t *dt_point = data_point_create(point);
+                record_dt_point_add(dt_point, table, record);
+                node->dt_point = dt_point;
+                __atomic_clear(&node->lock, __ATOMIC_RELEASE);
+                return;
+            }
+            point_t *node_point_loc = get_dt_point_loc(node->dt_point);
+            if (point_cmp(node_point_loc, point) == EQUALS){
+                record_dt_point_add(node->dt_point, table, record);
+                __atomic_clear(&node->lock, __ATOMIC_RELEASE);
+                point_free(point);  // No longer needed
+                return;
+            }
+
+            /* Split: the leaf below gets the data point before it's 
+            published, so other threads see either the old leaf or the 
+            finished split */
+            int quad = determine_quadrant(node->rectangle, node_point_loc);
+            quadtree_node_t *child = tree_node_create(
+                quadrant_assign(node->rectangle, quad));
+            child->dt_point = node->dt_point;
+            node->dt_point = NULL;  // This node is now an internal node
+            child_install(node, quad, child);
+            __atomic_clear(&node->lock, __ATOMIC_RELEASE);
+        }
+
+        // Move down to the point's quadrant, creating it if needed
+        int quad = determine_quadrant(node->rectangle, point);
+        quadtree_node_t *child = __atomic_load_n(child_slot(node, quad),
+                                                 __ATOMIC_ACQUIRE);
+        if (child == NULL){
+            child = tree_node_create(quadrant_assign(node->rectangle, quad));
+            child = child_install(node, quad, child);
+        }
+        node = child;
+    }
+}
+
+
+/* Add every record in the tree's record table using num_threads threads,
+each adding its own share of the records */
+void tree_build_concurrent(quadtree_t *qtree, int num_threads){
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    producer_t *producers = malloc(sizeof(producer_t) * num_threads);
+    assert(threads != NULL && producers != NULL);
+
+    for (int i = 0; i < num_threads; i++){
+        producers[i].qtree = qtree;
+        producers[i].first = i;
+        producers[i].step = num_threads;
+        int created = pthread_create(&threads[i], NULL, producer_run,
+                                     &producers[i]);
+        assert(created == 0);
+    }
+    for (int i = 0; i < num_threads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(producers);
+}
+
+
+/* Thread body: add this producer's records */
+static void *producer_run(void *arg){
+    producer_t *producer = arg;
+    int num_records = record_table_size(producer->qtree->records);
+    for (int record = producer->first; record < num_records;
+            record += producer->step){
+        concurrent_add_record(producer->qtree, record);
+    }
+    return NULL;
+}
+
+
+/* Address of the node's child pointer for quadrant quad */
+static quadtree_node_t **child_slot(quadtree_node_t *node, int quad){
+    if (quad == SW_QUADRANT){
+        return &node->SW;
+    }else if (quad == NW_QUADRANT){
+        return &node->NW;
+    }else if (quad == NE_QUADRANT){
+        return &node->NE;
+    }
+    return &node->SE;
+}
+
+
+/* Check whether any child of the node has been published */
+static int has_children(quadtree_node_t *node){
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        if (__atomic_load_n(child_slot(node, quad), __ATOMIC_ACQUIRE) 
+                != NULL){
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/* Set the node's child for quad unless another thread got there first. 
+Returns the child that ends up in place */
+static quadtree_node_t *child_install(quadtree_node_t *node, int quad,
+                                      quadtree_node_t *child){
+    quadtree_node_t *expected = NULL;
+    if (__atomic_compare_exchange_n(child_slot(node, quad), &expected, child,
+            FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+        return child;
+    }
+
+    // Lost the race, use the other thread's node
+    rectangle_free(child->rectangle);
+    free(child);
+    return expected;
+}
@@ -0,0 +1,9 @@
+#ifndef _CONCURRENTINSERT_H_
+#define _CONCURRENTINSERT_H_
+#include "quadTree.h"
+
+void concurrent_add_record(quadtree_t *qtree, record_id_t record);
+void concurrent_insert(quadtree_node_t *node, record_table_t *table,
+                       record_id_t record, point_t *point);
+void tree_build_concurrent(quadtree_t *qtree, int num_threads);
+#endif
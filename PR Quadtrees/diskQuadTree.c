@@ -0,0 +1,869 @@
+/* diskQuadTree.c
+*
+* Created by Ke Liao
+*
+* This module keeps a quad tree & its footpath records in a file of fixed
+* size pages, so it can be searched without holding it in memory. Every
+* page is read through a buffer pool capped at a given size.
+*
+* Layout of the file:
+*   page 0      header: where each part starts & the tree's area
+*   text part   each record as it is output, once for each leaf it is in &
+*               in the order the leaves are laid out, so records near each
+*               other share pages
+*   list part   for each leaf, the footpath id & place in the text part of
+*               each of its records, sorted by footpath id
+*   node pages  the nodes in depth first order(SW, NW, NE, SE), a whole
+*               number to a page, so a node is near its first child
+* The text & list parts are byte streams starting on a page boundary.
+*
+* Node rectangles aren't stored: they are split from the area on the way
+* down like when the tree was built, so they come out the same.
+*
+* The file is built from the data file without the tree or the records in
+* memory. Each point of a record gets a key of the quadrants it falls in
+* down to KEY_DEPTH levels, which orders the points like a depth first walk
+* of the tree. The points are sorted in runs of RUN_ENTRIES that are spilled
+* to a temporary file & merged, and the tree is laid out from the merged
+* points: the level at which a point's key splits from its neighbours' is
+* the depth of its leaf, so only the nodes on the path to the last leaf are
+* held. The records' text is spilled as it is read & copied into place.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "bufferPool.h"
+#include "diskQuadTree.h"
+#include "usefulConsts.h"
+
+#define DISK_MAGIC "PRQTREE2"
+#define MAGIC_LEN 8
+#define NO_CHILD 0    // node 0 is the root, so never a child
+#define NODES_PER_PAGE (DISK_PAGE_SIZE / sizeof(disk_node_t))
+#define INITIAL_SIZE 64
+#define KEY_DEPTH 64          // levels of quadrants in a point's key
+#define DIGITS_PER_WORD 32
+#define NO_SPLIT -1           // depth of the split with no neighbour
+#define RUN_ENTRIES 65536     // points sorted in memory at once
+#define MERGE_ENTRIES 256     // points read ahead from each run
+#define COPY_SIZE 65536
+#define NUM_ENDS 2
+
+typedef struct {
+    char magic[MAGIC_LEN];
+    uint32_t num_pages;
+    uint32_t num_nodes;
+    uint32_t node_page;     // first node page
+    uint32_t pad;
+    uint64_t list_offset;   // byte offsets of the list & text parts
+    uint64_t text_offset;
+    long double left, bot, right, top;
+} disk_header_t;
+
+typedef struct {
+    uint32_t children[4];   // node number of each quadrant, or NO_CHILD
+    double lon, lat;        // point of a leaf
+    uint64_t list_start;    // first list entry of a leaf
+    uint32_t num_entries;   // 0 for internal nodes & the empty root
+    uint32_t is_leaf;
+} disk_node_t;
+
+typedef struct {
+    int32_t footpath_id;
+    uint32_t text_len;
+    uint64_t text_offset;   // from the start of the text part
+} disk_entry_t;
+
+struct disk_tree{
+    int fd;
+    disk_header_t header;
+    buffer_pool_t *pool;
+};
+
+// Sides of a node's rectangle while the keys are worked out
+typedef struct {
+    long double left, bot, right, top;
+} bounds_t;
+
+// A point of a record on its way to the page file
+typedef struct {
+    uint64_t key[2];        // quadrants from the root down, 2 bits each
+    double lon, lat;
+    int32_t footpath_id;
+    uint32_t text_len;
+    uint64_t text_offset;   // in the spilled text, which is in input order
+} build_point_t;
+
+// Points of a sorted run not yet merged
+typedef struct {
+    uint64_t next, end;     // points of the run left in the run file
+    build_point_t *points;  // read ahead
+    int num_points, pos;
+} run_cursor_t;
+
+// Internal node on the path to the last leaf, waiting for more children
+typedef struct {
+    uint32_t number;
+    disk_node_t node;
+} open_node_t;
+
+// Files & state of a page file being built
+typedef struct {
+    bounds_t area;
+    FILE *page_file;
+    FILE *text_spill;       // text of the records as they were read
+    FILE *run_file;         // sorted runs of points
+    FILE *list_file;        // list part until it is copied into place
+    FILE *node_file;        // nodes by number, written as they are done
+    uint32_t num_nodes;
+    uint64_t num_entries;
+    uint64_t text_len;
+    open_node_t path[KEY_DEPTH];
+    int path_len;
+    char *text;             // text of the record being copied
+    uint32_t text_size;
+} disk_build_t;
+
+static FILE *temp_file_open(void);
+static uint64_t points_spill(disk_build_t *build, FILE *data_file);
+static void point_key_set(build_point_t *point, bounds_t *area);
+static int key_digit(const uint64_t *key, int depth);
+static int key_split_depth(const uint64_t *key1, const uint64_t *key2);
+static int build_point_cmp(const void *a, const void *b);
+static void run_write(disk_build_t *build, build_point_t *run, int run_len);
+static void runs_merge(disk_build_t *build, uint64_t num_points);
+static int cursor_fill(disk_build_t *build, run_cursor_t *cursor);
+static void cursor_sift_down(run_cursor_t *cursors, int *heap, int heap_len,
+                             int idx);
+static void entry_add(disk_build_t *build, build_point_t *point);
+static void leaf_place(disk_build_t *build, build_point_t *point,
+                       int split_prev, int split_next, uint64_t list_start);
+static uint32_t node_number_take(disk_build_t *build, const uint64_t *key);
+static void path_pop(disk_build_t *build);
+static void node_write(disk_build_t *build, uint32_t number,
+                       disk_node_t *node);
+static void nodes_copy(disk_build_t *build);
+static void part_copy(FILE *from, FILE *to, uint64_t len);
+static void part_write(FILE *file, const void *part, uint64_t len);
+static void part_pad(FILE *file, uint64_t len);
+static void build_write(FILE *file, const void *data, size_t len);
+static void disk_node_read(disk_tree_t *tree, uint32_t number,
+                           disk_node_t *node);
+static void disk_range_search(disk_tree_t *tree, disk_node_t *node,
+                              rectangle_t *rect, rectangle_t *query,
+                              disk_entry_t **found, uint64_t *num_found,
+                              uint64_t *found_size, FILE *trace);
+static void entries_output(disk_tree_t *tree, disk_entry_t *entries,
+                           uint64_t num_entries, FILE *f);
+static int entry_cmp(const void *a, const void *b);
+
+
+/* Write the page file of a tree over bot_left & top_right holding the
+records left in the data file(past its header)*/
+void disk_tree_build(FILE *data_file, point_t *bot_left, point_t *top_right,
+                     const char *file_name){
+    disk_build_t build;
+    memset(&build, 0, sizeof(build));
+    build.area.left = get_lon(bot_left);
+    build.area.bot = get_lat(bot_left);
+    build.area.right = get_lon(top_right);
+    build.area.top = get_lat(top_right);
+    build.text_spill = temp_file_open();
+    build.run_file = temp_file_open();
+    build.list_file = temp_file_open();
+    build.node_file = temp_file_open();
+    build.page_file = fopen(file_name, "wb");
+    if (build.page_file == NULL){
+        fprintf(stderr, "Can't write page file: %s\n", file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    // Page 0 is kept for the header until the other parts are placed
+    disk_header_t header;
+    memset(&header, 0, sizeof(header));
+    part_write(build.page_file, &header, sizeof(header));
+
+    uint64_t num_points = points_spill(&build, data_file);
+    runs_merge(&build, num_points);
+    part_pad(build.page_file, build.text_len);
+
+    /* Header & where each part went */
+    memcpy(header.magic, DISK_MAGIC, MAGIC_LEN);
+    header.num_nodes = build.num_nodes;
+    uint64_t text_pages = (build.text_len + DISK_PAGE_SIZE - 1) /
+                          DISK_PAGE_SIZE;
+    uint64_t list_len = sizeof(disk_entry_t) * build.num_entries;
+    uint64_t list_pages = (list_len + DISK_PAGE_SIZE - 1) / DISK_PAGE_SIZE;
+    uint32_t node_pages = (build.num_nodes + NODES_PER_PAGE - 1) /
+                          NODES_PER_PAGE;
+    header.text_offset = DISK_PAGE_SIZE;
+    header.list_offset = header.text_offset + text_pages * DISK_PAGE_SIZE;
+    header.node_page = 1 + text_pages + list_pages;
+    header.num_pages = header.node_page + node_pages;
+    header.left = build.area.left;
+    header.bot = build.area.bot;
+    header.right = build.area.right;
+    header.top = build.area.top;
+
+    part_copy(build.list_file, build.page_file, list_len);
+    nodes_copy(&build);
+    fseek(build.page_file, 0, SEEK_SET);
+    build_write(build.page_file, &header, sizeof(header));
+    if (fclose(build.page_file) != 0){
+        fprintf(stderr, "Can't write page file: %s\n", file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    fclose(build.text_spill);
+    fclose(build.run_file);
+    fclose(build.list_file);
+    fclose(build.node_file);
+    free(build.text);
+}
+
+
+/* Open a temporary file, deleted when it is closed */
+static FILE *temp_file_open(void){
+    FILE *file = tmpfile();
+    if (file == NULL){
+        fprintf(stderr, "Can't open a temporary file for the page file\n");
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+
+/* Read the records, spilling their text & writing their points inside the
+area to the run file in sorted runs. Returns the number of points */
+static uint64_t points_spill(disk_build_t *build, FILE *data_file){
+    build_point_t *run = malloc(sizeof(build_point_t) * RUN_ENTRIES);
+    assert(run);
+    int run_len = 0;
+    uint64_t num_points = 0;
+
+    footpath_t *footpath;
+    while ((footpath = footpath_read(data_file)) != NULL){
+        long text_offset = ftell(build->text_spill);
+        data_print(footpath, build->text_spill);
+        uint32_t text_len = ftell(build->text_spill) - text_offset;
+
+        point_t *ends[NUM_ENDS] = {get_start_point(footpath),
+                                   get_end_point(footpath)};
+        for (int end = 0; end < NUM_ENDS; end++){
+            long double lon = get_lon(ends[end]), lat = get_lat(ends[end]);
+            point_free(ends[end]);
+
+            // Same bounds as in_rectangle, as the tree leaves these out
+            if (lon <= build->area.left || lon > build->area.right ||
+                    lat >= build->area.top || lat < build->area.bot){
+                continue;
+            }
+            if (run_len == RUN_ENTRIES){
+                run_write(build, run, run_len);
+                run_len = 0;
+            }
+            build_point_t *point = &run[run_len++];
+            point->lon = lon;
+            point->lat = lat;
+            point->footpath_id = get_footpath_id(footpath);
+            point->text_len = text_len;
+            point->text_offset = text_offset;
+            point_key_set(point, &build->area);
+            num_points++;
+        }
+        data_free(footpath);
+    }
+    run_write(build, run, run_len);
+    free(run);
+
+    if (fflush(build->text_spill) != 0 || fflush(build->run_file) != 0){
+        fprintf(stderr, "Can't write the temporary files of the page file\n");
+        exit(EXIT_FAILURE);
+    }
+    return num_points;
+}
+
+
+/* Set the key of the point from the quadrants it falls in, splitting the
+area the way determine_quadrant & quadrant_assign do */
+static void point_key_set(build_point_t *point, bounds_t *area){
+    bounds_t rect = *area;
+    long double lon = point->lon, lat = point->lat;
+    point->key[0] = point->key[1] = 0;
+    for (int depth = 0; depth < KEY_DEPTH; depth++){
+        double longitude_ave = (rect.left + rect.right)/2;
+        double latitude_ave = (rect.top + rect.bot)/2;
+        int quad;
+        if (lon <= longitude_ave){
+            quad = lat < latitude_ave ? SW_QUADRANT : NW_QUADRANT;
+            rect.right = longitude_ave;
+        }else{
+            quad = lat >= latitude_ave ? NE_QUADRANT : SE_QUADRANT;
+            rect.left = longitude_ave;
+        }
+        if (lat < latitude_ave){
+            rect.top = latitude_ave;
+        }else{
+            rect.bot = latitude_ave;
+        }
+        int shift = 2 * (DIGITS_PER_WORD - 1 - depth % DIGITS_PER_WORD);
+        point->key[depth / DIGITS_PER_WORD] |= (uint64_t)quad << shift;
+    }
+}
+
+
+/* Quadrant at the depth of the key */
+static int key_digit(const uint64_t *key, int depth){
+    int shift = 2 * (DIGITS_PER_WORD - 1 - depth % DIGITS_PER_WORD);
+    return (key[depth / DIGITS_PER_WORD] >> shift) & 3;
+}
+
+
+/* Depth of the node the two keys go to different quadrants of, or
+KEY_DEPTH if they don't */
+static int key_split_depth(const uint64_t *key1, const uint64_t *key2){
+    for (int depth = 0; depth < KEY_DEPTH; depth++){
+        if (key_digit(key1, depth) != key_digit(key2, depth)){
+            return depth;
+        }
+    }
+    return KEY_DEPTH;
+}
+
+
+/* Order points by key, then location, then footpath id & the order they
+were read in */
+static int build_point_cmp(const void *a, const void *b){
+    const build_point_t *point1 = a, *point2 = b;
+    for (int word = 0; word < 2; word++){
+        if (point1->key[word] != point2->key[word]){
+            return point1->key[word] < point2->key[word] ? SMALLER_THAN :
+                                                           GREATER_THAN;
+        }
+    }
+    if (point1->lon != point2->lon){
+        return point1->lon < point2->lon ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (point1->lat != point2->lat){
+        return point1->lat < point2->lat ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (point1->footpath_id != point2->footpath_id){
+        return point1->footpath_id < point2->footpath_id ? SMALLER_THAN :
+                                                           GREATER_THAN;
+    }
+    if (point1->text_offset != point2->text_offset){
+        return point1->text_offset < point2->text_offset ? SMALLER_THAN :
+                                                           GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Sort the run & add it to the end of the run file */
+static void run_write(disk_build_t *build, build_point_t *run, int run_len){
+    qsort(run, run_len, sizeof(build_point_t), build_point_cmp);
+    build_write(build->run_file, run, sizeof(build_point_t) * run_len);
+}
+
+
+/* Merge the sorted runs, laying out the leaves & the text of their records
+as the points come out in order */
+static void runs_merge(disk_build_t *build, uint64_t num_points){
+    int num_runs = (num_points + RUN_ENTRIES - 1) / RUN_ENTRIES;
+    run_cursor_t *cursors = malloc(sizeof(run_cursor_t) * (num_runs + 1));
+    int *heap = malloc(sizeof(int) * (num_runs + 1));
+    assert(cursors && heap);
+    int heap_len = 0;
+    for (int run = 0; run < num_runs; run++){
+        run_cursor_t *cursor = &cursors[run];
+        cursor->next = (uint64_t)run * RUN_ENTRIES;
+        cursor->end = cursor->next + RUN_ENTRIES;
+        if (cursor->end > num_points){
+            cursor->end = num_points;
+        }
+        cursor->points = malloc(sizeof(build_point_t) * MERGE_ENTRIES);
+        assert(cursor->points);
+        cursor_fill(build, cursor);
+        heap[heap_len++] = run;
+    }
+    for (int idx = heap_len / 2 - 1; idx >= 0; idx--){
+        cursor_sift_down(cursors, heap, heap_len, idx);
+    }
+
+    /* Points of a leaf come out together, sorted by footpath id */
+    build_point_t leaf;
+    int have_leaf = FALSE;
+    int split_prev = NO_SPLIT;
+    uint64_t list_start = 0;
+    int32_t last_id = 0;
+    while (heap_len > 0){
+        run_cursor_t *cursor = &cursors[heap[0]];
+        build_point_t point = cursor->points[cursor->pos++];
+        if (cursor->pos == cursor->num_points && !cursor_fill(build, cursor)){
+            heap[0] = heap[--heap_len];
+        }
+        cursor_sift_down(cursors, heap, heap_len, 0);
+
+        if (have_leaf && point.lon == leaf.lon && point.lat == leaf.lat){
+            // A footpath is kept once at a point, like in the tree
+            if (point.footpath_id != last_id){
+                entry_add(build, &point);
+                last_id = point.footpath_id;
+            }
+            continue;
+        }
+
+        if (have_leaf){
+            int split = key_split_depth(leaf.key, point.key);
+            if (split == KEY_DEPTH){
+                fprintf(stderr, "Points too close for the page file: "
+                        "%.17g %.17g\n", point.lon, point.lat);
+                exit(EXIT_FAILURE);
+            }
+            leaf_place(build, &leaf, split_prev, split, list_start);
+            split_prev = split;
+        }
+        leaf = point;
+        have_leaf = TRUE;
+        list_start = build->num_entries;
+        last_id = point.footpath_id;
+        entry_add(build, &point);
+    }
+
+    if (have_leaf){
+        leaf_place(build, &leaf, split_prev, NO_SPLIT, list_start);
+    }else{
+        // No points, the root is an empty leaf
+        disk_node_t root;
+        memset(&root, 0, sizeof(root));
+        root.is_leaf = TRUE;
+        node_write(build, build->num_nodes++, &root);
+    }
+    while (build->path_len > 0){
+        path_pop(build);
+    }
+
+    for (int run = 0; run < num_runs; run++){
+        free(cursors[run].points);
+    }
+    free(cursors);
+    free(heap);
+}
+
+
+/* Read the next points of the run ahead. Returns FALSE if the run is used
+up */
+static int cursor_fill(disk_build_t *build, run_cursor_t *cursor){
+    uint64_t count = cursor->end - cursor->next;
+    if (count == 0){
+        return FALSE;
+    }
+    if (count > MERGE_ENTRIES){
+        count = MERGE_ENTRIES;
+    }
+    if (!file_read_at(fileno(build->run_file), cursor->points,
+                      sizeof(build_point_t) * count,
+                      sizeof(build_point_t) * cursor->next)){
+        fprintf(stderr, "Can't read the temporary files of the page file\n");
+        exit(EXIT_FAILURE);
+    }
+    cursor->next += count;
+    cursor->num_points = count;
+    cursor->pos = 0;
+    return TRUE;
+}
+
+
+/* Move the cursor at idx down the heap until its next point is no greater
+than those of its children */
+static void cursor_sift_down(run_cursor_t *cursors, int *heap, int heap_len,
+                             int idx){
+    while (TRUE){
+        int smallest = idx;
+        for (int child = 2 * idx + 1; child <= 2 * idx + 2; child++){
+            if (child >= heap_len){
+                break;
+            }
+            run_cursor_t *cursor1 = &cursors[heap[child]];
+            run_cursor_t *cursor2 = &cursors[heap[smallest]];
+            if (build_point_cmp(cursor1->points + cursor1->pos,
+                    cursor2->points + cursor2->pos) == SMALLER_THAN){
+                smallest = child;
+            }
+        }
+        if (smallest == idx){
+            return;
+        }
+        int tmp = heap[idx];
+        heap[idx] = heap[smallest];
+        heap[smallest] = tmp;
+        idx = smallest;
+    }
+}
+
+
+/* Add the point's record to the list of the current leaf, copying its text
+into the text part */
+static void entry_add(disk_build_t *build, build_point_t *point){
+    if (point->text_len > build->text_size){
+        build->text_size = point->text_len;
+        build->text = realloc(build->text, build->text_size);
+        assert(build->text);
+    }
+    if (!file_read_at(fileno(build->text_spill), build->text,
+                      point->text_len, point->text_offset)){
+        fprintf(stderr, "Can't read the temporary files of the page file\n");
+        exit(EXIT_FAILURE);
+    }
+    build_write(build->page_file, build->text, point->text_len);
+
+    disk_entry_t entry;
+    entry.footpath_id = point->footpath_id;
+    entry.text_len = point->text_len;
+    entry.text_offset = build->text_len;
+    build_write(build->list_file, &entry, sizeof(entry));
+    build->text_len += point->text_len;
+    build->num_entries++;
+}
+
+
+/* Lay out the leaf of the point, whose key split from the previous & next
+leaves' at the given depths. Its entries start at list_start */
+static void leaf_place(disk_build_t *build, build_point_t *point,
+                       int split_prev, int split_next, uint64_t list_start){
+    int depth = (split_prev > split_next ? split_prev : split_next) + 1;
+
+    // Nodes below the split from the previous leaf have all their children
+    while (build->path_len > split_prev + 1){
+        path_pop(build);
+    }
+
+    // Internal nodes down to the leaf, numbered before their children
+    while (build->path_len < depth){
+        uint32_t number = node_number_take(build, point->key);
+        open_node_t *open = &build->path[build->path_len++];
+        open->number = number;
+        memset(&open->node, 0, sizeof(open->node));
+    }
+
+    disk_node_t leaf;
+    memset(&leaf, 0, sizeof(leaf));
+    leaf.is_leaf = TRUE;
+    leaf.lon = point->lon;
+    leaf.lat = point->lat;
+    leaf.list_start = list_start;
+    leaf.num_entries = build->num_entries - list_start;
+    node_write(build, node_number_take(build, point->key), &leaf);
+}
+
+
+/* Number the next node, making it the child of the last node on the path
+in the quadrant of the key */
+static uint32_t node_number_take(disk_build_t *build, const uint64_t *key){
+    uint32_t number = build->num_nodes++;
+    if (build->path_len > 0){
+        open_node_t *parent = &build->path[build->path_len - 1];
+        parent->node.children[key_digit(key, build->path_len - 1)] = number;
+    }
+    return number;
+}
+
+
+/* Write out the last node on the path */
+static void path_pop(disk_build_t *build){
+    build->path_len--;
+    open_node_t *open = &build->path[build->path_len];
+    node_write(build, open->number, &open->node);
+}
+
+
+/* Write the node to its place in the node file */
+static void node_write(disk_build_t *build, uint32_t number,
+                       disk_node_t *node){
+    fseek(build->node_file, (long)number * sizeof(disk_node_t), SEEK_SET);
+    build_write(build->node_file, node, sizeof(disk_node_t));
+}
+
+
+/* Copy the nodes into the node pages, a whole number to a page */
+static void nodes_copy(disk_build_t *build){
+    if (fflush(build->node_file) != 0){
+        fprintf(stderr, "Can't write the temporary files of the page file\n");
+        exit(EXIT_FAILURE);
+    }
+    disk_node_t page[NODES_PER_PAGE];
+    for (uint32_t first = 0; first < build->num_nodes;
+            first += NODES_PER_PAGE){
+        uint32_t count = build->num_nodes - first;
+        if (count > NODES_PER_PAGE){
+            count = NODES_PER_PAGE;
+        }
+        if (!file_read_at(fileno(build->node_file), page,
+                          sizeof(disk_node_t) * count,
+                          (uint64_t)first * sizeof(disk_node_t))){
+            fprintf(stderr, "Can't read the temporary files of the page "
+                    "file\n");
+            exit(EXIT_FAILURE);
+        }
+        part_write(build->page_file, page, sizeof(disk_node_t) * count);
+    }
+}
+
+
+/* Copy the len bytes written to the temporary file into a part of the
+page file */
+static void part_copy(FILE *from, FILE *to, uint64_t len){
+    char buffer[COPY_SIZE];
+    rewind(from);
+    for (uint64_t copied = 0; copied < len; ){
+        size_t chunk = len - copied < COPY_SIZE ? len - copied : COPY_SIZE;
+        if (fread(buffer, 1, chunk, from) != chunk){
+            fprintf(stderr, "Can't read the temporary files of the page "
+                    "file\n");
+            exit(EXIT_FAILURE);
+        }
+        build_write(to, buffer, chunk);
+        copied += chunk;
+    }
+    part_pad(to, len);
+}
+
+
+/* Write the part & pad it to the end of its last page */
+static void part_write(FILE *file, const void *part, uint64_t len){
+    build_write(file, part, len);
+    part_pad(file, len);
+}
+
+
+/* Pad a part of len bytes to the end of its last page */
+static void part_pad(FILE *file, uint64_t len){
+    static const char zeros[DISK_PAGE_SIZE];
+    uint64_t used = len % DISK_PAGE_SIZE;
+    if (used > 0){
+        build_write(file, zeros, DISK_PAGE_SIZE - used);
+    }
+}
+
+
+/* Write len bytes of data to the file, exiting if it can't be written */
+static void build_write(FILE *file, const void *data, size_t len){
+    if (len > 0 && fwrite(data, 1, len, file) != len){
+        fprintf(stderr, "Can't write page file\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/* Open the page file, reading it through a pool of at most pool_capacity
+bytes */
+disk_tree_t *disk_tree_open(const char *file_name, size_t pool_capacity){
+    disk_tree_t *tree = malloc(sizeof(*tree));
+    assert(tree);
+    tree->fd = open(file_name, O_RDONLY);
+    if (tree->fd < 0 ||
+            !file_read_at(tree->fd, &tree->header, sizeof(tree->header), 0) ||
+            memcmp(tree->header.magic, DISK_MAGIC, MAGIC_LEN) != 0){
+        fprintf(stderr, "Not a page file: %s\n", file_name);
+        exit(EXIT_FAILURE);
+    }
+
+    // A file cut short would otherwise only fail on the first missing page
+    struct stat file_stat;
+    if (fstat(tree->fd, &file_stat) != 0 || (uint64_t)file_stat.st_size <
+            (uint64_t)tree->header.num_pages * DISK_PAGE_SIZE){
+        fprintf(stderr, "Page file is cut short: %s\n", file_name);
+        exit(EXIT_FAILURE);
+    }
+    tree->pool = buffer_pool_create(tree->fd, tree->header.num_pages,
+                                    pool_capacity);
+    return tree;
+}
+
+
+/* Copy the numbered node out of its page */
+static void disk_node_read(disk_tree_t *tree, uint32_t number,
+                           disk_node_t *node){
+    char *page = buffer_pool_get(tree->pool,
+        tree->header.node_page + number / NODES_PER_PAGE);
+    memcpy(node, page + (number % NODES_PER_PAGE) * sizeof(disk_node_t),
+           sizeof(disk_node_t));
+}
+
+
+/* Area covered by the tree */
+static rectangle_t *disk_area(disk_tree_t *tree){
+    return rectangle_create(
+        point_creator(tree->header.left, tree->header.bot),
+        point_creator(tree->header.right, tree->header.top));
+}
+/* Find the leaf the query is in & output its records to f, printing the
+directions taken to trace like tree_query */
+void disk_point_query(disk_tree_t *tree, point_t *query, FILE *f,
+                      FILE *trace){
+    rectangle_t *rect = disk_area(tree);
+    disk_node_t node;
+    disk_node_read(tree, 0, &node);
+    while (in_rectangle(rect, query)){
+        if (node.is_leaf){
+            if (node.num_entries > 0){
+                disk_entry_t *entries = malloc(sizeof(disk_entry_t) *
+                                               node.num_entries);
+                assert(entries);
+                buffer_pool_read(tree->pool, tree->header.list_offset +
+                    node.list_start * sizeof(disk_entry_t), entries,
+                    sizeof(disk_entry_t) * node.num_entries);
+                entries_output(tree, entries, node.num_entries, f);
+                free(entries);
+            }
+            break;
+        }
+
+        int quad = determine_quadrant(rect, query);
+        fprintf(trace, " %s", quadrant_names[quad]);
+        if (node.children[quad] == NO_CHILD){
+            break;
+        }
+        rectangle_t *child_rect = quadrant_assign(rect, quad);
+        rectangle_free(rect);
+        rect = child_rect;
+        disk_node_read(tree, node.children[quad], &node);
+    }
+    rectangle_free(rect);
+}
+
+
+/* Find the records with a point in the query & output them to f sorted by
+footpath id, printing the directions explored to trace like
+tree_ranged_query */
+void disk_ranged_query(disk_tree_t *tree, rectangle_t *query, FILE *f,
+                       FILE *trace){
+    rectangle_t *area = disk_area(tree);
+    if (rectangle_overlap(query, area)){
+        uint64_t num_found = 0, found_size = INITIAL_SIZE;
+        disk_entry_t *found = malloc(sizeof(disk_entry_t) * found_size);
+        assert(found);
+        disk_node_t root;
+        disk_node_read(tree, 0, &root);
+        disk_range_search(tree, &root, area, query, &found, &num_found,
+                          &found_size, trace);
+
+        // Same record may be found at both its points
+        qsort(found, num_found, sizeof(disk_entry_t), entry_cmp);
+        uint64_t num_unique = 0;
+        for (uint64_t i = 0; i < num_found; i++){
+            if (num_unique == 0 || found[i].footpath_id !=
+                    found[num_unique - 1].footpath_id){
+                found[num_unique++] = found[i];
+            }
+        }
+        entries_output(tree, found, num_unique, f);
+        free(found);
+    }
+    rectangle_free(area);
+}
+
+
+/* Collect the list entries of the leaves under the node(covering rect)
+with a point in the query, printing the directions explored to trace */
+static void disk_range_search(disk_tree_t *tree, disk_node_t *node,
+                              rectangle_t *rect, rectangle_t *query,
+                              disk_entry_t **found, uint64_t *num_found,
+                              uint64_t *found_size, FILE *trace){
+    if (node->is_leaf){
+        if (node->num_entries == 0){
+            return;
+        }
+        point_t *loc = point_creator(node->lon, node->lat);
+        int inside = in_rectangle(query, loc);
+        point_free(loc);
+        if (!inside){
+            return;
+        }
+
+        while (*num_found + node->num_entries > *found_size){
+            *found_size *= 2;
+            *found = realloc(*found, sizeof(disk_entry_t) * *found_size);
+            assert(*found);
+        }
+        buffer_pool_read(tree->pool, tree->header.list_offset +
+            node->list_start * sizeof(disk_entry_t), *found + *num_found,
+            sizeof(disk_entry_t) * node->num_entries);
+        *num_found += node->num_entries;
+        return;
+    }
+
+    // Explore branches that overlap, in the order SW, NW, NE, SE
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        if (node->children[quad] == NO_CHILD){
+            continue;
+        }
+        rectangle_t *child_rect = quadrant_assign(rect, quad);
+        if (rectangle_overlap(query, child_rect)){
+            fprintf(trace, " %s", quadrant_names[quad]);
+            disk_node_t child;
+            disk_node_read(tree, node->children[quad], &child);
+            disk_range_search(tree, &child, child_rect, query, found,
+                              num_found, found_size, trace);
+        }
+        rectangle_free(child_rect);
+    }
+}
+
+
+/* Output the text of each entry's record to f */
+static void entries_output(disk_tree_t *tree, disk_entry_t *entries,
+                           uint64_t num_entries, FILE *f){
+    char *text = NULL;
+    uint32_t text_size = 0;
+    for (uint64_t i = 0; i < num_entries; i++){
+        if (entries[i].text_len > text_size){
+            text_size = entries[i].text_len;
+            text = realloc(text, text_size);
+            assert(text);
+        }
+        buffer_pool_read(tree->pool, tree->header.text_offset +
+            entries[i].text_offset, text, entries[i].text_len);
+        fwrite(text, 1, entries[i].text_len, f);
+    }
+    free(text);
+}
+
+
+/* Order list entries by footpath id */
+static int entry_cmp(const void *a, const void *b){
+    const disk_entry_t *entry1 = a, *entry2 = b;
+    if (entry1->footpath_id != entry2->footpath_id){
+        return entry1->footpath_id < entry2->footpath_id ? SMALLER_THAN :
+                                                           GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Print the page statistics of the file's buffer pool to f */
+void disk_tree_stats_print(disk_tree_t *tree, FILE *f){
+    fprintf(f, "page file: %u nodes, %u pages\n", tree->header.num_nodes,
+            tree->header.num_pages);
+    buffer_pool_stats_print(tree->pool, f);
+}
+
+
+/* Close the page file */
+void disk_tree_close(disk_tree_t *tree){
+    buffer_pool_free(tree->pool);
+    close(tree->fd);
+    free(tree);
+}
@@ -0,0 +1,17 @@
+#ifndef _DISKQUADTREE_H_
+#define _DISKQUADTREE_H_
+#include <stdio.h>
+#include "rectangle.h"
+
+typedef struct disk_tree disk_tree_t;
+
+void disk_tree_build(FILE *data_file, point_t *bot_left, point_t *top_right,
+                     const char *file_name);
+disk_tree_t *disk_tree_open(const char *file_name, size_t pool_capacity);
+void disk_point_query(disk_tree_t *tree, point_t *query, FILE *f,
+                      FILE *trace);
+void disk_ranged_query(disk_tree_t *tree, rectangle_t *query, FILE *f,
+                       FILE *trace);
+void disk_tree_stats_print(disk_tree_t *tree, FILE *f);
+void disk_tree_close(disk_tree_t *tree);
+#endif
@@ -0,0 +1,294 @@
+/* distanceJoin.c
+*
+* Created by Ke Liao
+*
+* This module finds every pair of data points, one from each of two quad 
+* trees, that are within a given distance(in metres) of each other. Given 
+* the same tree twice it joins the tree with itself, finding each pair of 
+* different data points once. Both trees are walked together one pair of 
+* nodes at a time, and a pair is dropped as soon as its rectangles are 
+* further apart than the distance. 
+*
+* With more than one thread, the node pairs a few levels down are shared 
+* out between threads. Each pair's matches are buffered and written out in
+* the same order as a single thread would, as soon as the pairs before it 
+* are done.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "distanceJoin.h"
+#include "usefulConsts.h"
+
+#define TASKS_PER_THREAD 8  // node pairs per thread, to even out the work
+#define MAX_SPLIT_ROUNDS 6
+#define MAX_CHILD_PAIRS 16
+
+typedef struct node_pair{
+    quadtree_node_t *a;
+    quadtree_node_t *b;
+} node_pair_t;
+
+// State shared by the threads of one join
+typedef struct join{
+    quadtree_t *tree_a;
+    quadtree_t *tree_b;
+    int self_join;
+    long double max_dist;
+
+    node_pair_t *tasks;
+    int num_tasks;
+    char **buffers;   // each task's matches once it's done, else NULL
+    size_t *buffer_lens;
+    long *counts;
+    int next_task;
+    pthread_mutex_t lock;
+    pthread_cond_t task_done;
+} join_t;
+
+
+static void pair_join(join_t *join, quadtree_node_t *a, quadtree_node_t *b,
+                      FILE *f, long *count);
+static int pair_split(join_t *join, quadtree_node_t *a, quadtree_node_t *b,
+                      node_pair_t *children);
+static void tasks_create(join_t *join, int num_threads);
+static void *tasks_run(void *arg);
+static void match_print(join_t *join, data_point_t *dt_a, data_point_t *dt_b,
+                        long double dist, FILE *f);
+
+
+/* Output every pair of data points from tree_a & tree_b within max_dist 
+metres of each other, returning the number of pairs. tree_b may be the same
+tree as tree_a */
+long tree_distance_join(quadtree_t *tree_a, quadtree_t *tree_b,
+                        long double max_dist, int num_threads, FILE *f){
+    join_t join;
+    join.tree_a = tree_a;
+    join.tree_b = tree_b;
+    join.self_join = (tree_a == tree_b);
+    join.max_dist = max_dist;
+
+    // Nodes are only built as needed in lazy trees, which isn't thread safe
+    if (tree_a->lazy){
+        tree_expand_all(tree_a->root);
+    }
+    if (tree_b->lazy){
+        tree_expand_all(tree_b->root);
+    }
+
+    long count = 0;
+    if (num_threads <= 1){
+        pair_join(&join, tree_a->root, tree_b->root, f, &count);
+        return count;
+    }
+
+    tasks_create(&join, num_threads);
+    join.buffers = calloc(join.num_tasks + 1, sizeof(char*));
+    join.buffer_lens = malloc(sizeof(size_t) * (join.num_tasks + 1));
+    join.counts = malloc(sizeof(long) * (join.num_tasks + 1));
+    assert(join.buffers != NULL && join.buffer_lens != NULL);
+    assert(join.counts != NULL);
+    join.next_task = 0;
+    pthread_mutex_init(&join.lock, NULL);
+    pthread_cond_init(&join.task_done, NULL);
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    assert(threads != NULL);
+    for (int i = 0; i < num_threads; i++){
+        int created = pthread_create(&threads[i], NULL, tasks_run, &join);
+        assert(created == 0);
+    }
+
+    // Write out each task's matches in order as they finish
+    for (int task = 0; task < join.num_tasks; task++){
+        pthread_mutex_lock(&join.lock);
+        while (join.buffers[task] == NULL){
+            pthread_cond_wait(&join.task_done, &join.lock);
+        }
+        pthread_mutex_unlock(&join.lock);
+        fwrite(join.buffers[task], 1, join.buffer_lens[task], f);
+        free(join.buffers[task]);
+        count += join.counts[task];
+    }
+
+    for (int i = 0; i < num_threads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&join.lock);
+    pthread_cond_destroy(&join.task_done);
+    free(join.tasks);
+    free(join.buffers);
+    free(join.buffer_lens);
+    free(join.counts);
+    return count;
+}
+
+
+/* Output the matches between the subtrees of a & b */
+static void pair_join(join_t *join, quadtree_node_t *a, quadtree_node_t *b,
+                      FILE *f, long *count){
+    if (rectangle_min_distance(a->rectangle, b->rectangle) > join->max_dist){
+        return;
+    }
+
+    node_pair_t children[MAX_CHILD_PAIRS];
+    int num_children = pair_split(join, a, b, children);
+    if (num_children == UNDEFINED){
+        
+        // Two leaves, compare their points
+        if (a->dt_point == NULL || b->dt_point == NULL || 
+                a->dt_point == b->dt_point){
+            return;
+        }
+        long double dist = haversine_distance(get_dt_point_loc(a->dt_point),
+                                              get_dt_point_loc(b->dt_point));
+        if (dist <= join->max_dist){
+            match_print(join, a->dt_point, b->dt_point, dist, f);
+            (*count)++;
+        }
+        return;
+    }
+    for (int i = 0; i < num_children; i++){
+        pair_join(join, children[i].a, children[i].b, f, count);
+    }
+}
+
+
+/* Put the pairs of children to be joined in place of a & b into children,
+returning how many there are, or UNDEFINED if a & b are both leaves. When 
+joining a node with itself, only one of each two mirrored pairs is kept */
+static int pair_split(join_t *join, quadtree_node_t *a, quadtree_node_t *b,
+                      node_pair_t *children){
+    if (is_leaf_node(a) && is_leaf_node(b)){
+        return UNDEFINED;
+    }
+
+    // A leaf is paired up whole with each child of the other node
+    quadtree_node_t *sides[2][4];
+    int num_sides[2];
+    quadtree_node_t *nodes[] = {a, b};
+    for (int side = 0; side < 2; side++){
+        num_sides[side] = 0;
+        if (is_leaf_node(nodes[side])){
+            sides[side][num_sides[side]++] = nodes[side];
+            continue;
+        }
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            if (get_child(nodes[side], quad) != NULL){
+                sides[side][num_sides[side]++] = get_child(nodes[side], quad);
+            }
+        }
+    }
+
+    int num_children = 0;
+    for (int i = 0; i < num_sides[0]; i++){
+        int first_j = (join->self_join && a == b) ? i : 0;
+        for (int j = first_j; j < num_sides[1]; j++){
+            children[num_children].a = sides[0][i];
+            children[num_children].b = sides[1][j];
+            num_children++;
+        }
+    }
+    return num_children;
+}
+
+
+/* Split the root pair into enough pairs of nodes for the threads, keeping 
+them in the order a single thread would join them */
+static void tasks_create(join_t *join, int num_threads){
+    int max_tasks = 1;
+    join->tasks = malloc(sizeof(node_pair_t) * max_tasks);
+    assert(join->tasks != NULL);
+    join->tasks[0].a = join->tree_a->root;
+    join->tasks[0].b = join->tree_b->root;
+    join->num_tasks = 1;
+
+    for (int round = 0; round < MAX_SPLIT_ROUNDS && 
+            join->num_tasks < num_threads * TASKS_PER_THREAD; round++){
+        node_pair_t *split = malloc(sizeof(node_pair_t) * 
+                                    join->num_tasks * MAX_CHILD_PAIRS);
+        assert(split != NULL);
+        int num_split = 0;
+        int changed = FALSE;
+        for (int i = 0; i < join->num_tasks; i++){
+            node_pair_t *pair = &join->tasks[i];
+            if (rectangle_min_distance(pair->a->rectangle, 
+                    pair->b->rectangle) > join->max_dist){
+                changed = TRUE;
+                continue;   // Nothing to find in this pair
+            }
+            int num_children = pair_split(join, pair->a, pair->b,
+                                          &split[num_split]);
+            if (num_children == UNDEFINED){
+                split[num_split++] = *pair;
+            }else{
+                num_split += num_children;
+                changed = TRUE;
+            }
+        }
+        free(join->tasks);
+        join->tasks = split;
+        join->num_tasks = num_split;
+        if (!changed){
+            break;
+        }
+    }
+}
+
+
+/* Thread body: join node pairs until none are left, buffering the output */
+static void *tasks_run(void *arg){
+    join_t *join = arg;
+    while (TRUE){
+        int task = __atomic_fetch_add(&join->next_task, 1, __ATOMIC_RELAXED);
+        if (task >= join->num_tasks){
+            return NULL;
+        }
+        char *buffer = NULL;
+        size_t buffer_len = 0;
+        FILE *f = open_memstream(&buffer, &buffer_len);
+        assert(f != NULL);
+        long count = 0;
+        pair_join(join, join->tasks[task].a, join->tasks[task].b, f, &count);
+        fclose(f);
+
+        pthread_mutex_lock(&join->lock);
+        join->buffers[task] = buffer;
+        join->buffer_lens[task] = buffer_len;
+        join->counts[task] = count;
+        pthread_cond_signal(&join->task_done);
+        pthread_mutex_unlock(&join->lock);
+    }
+}
+
+
+/* Output the location & footpath ids of both data points of a match, and 
+the distance between them */
+static void match_print(join_t *join, data_point_t *dt_a, data_point_t *dt_b,
+                        long double dist, FILE *f){
+    data_point_t *dt_points[] = {dt_a, dt_b};
+    record_table_t *tables[] = {join->tree_a->records, 
+                                join->tree_b->records};
+    for (int side = 0; side < 2; side++){
+        point_t *loc = get_dt_point_loc(dt_points[side]);
+        fprintf(f, "%s(%.7Lf, %.7Lf) footpath_id", side ? " <-> " : "", 
+                get_lon(loc), get_lat(loc));
+        record_id_t *records = get_record_list(dt_points[side]);
+        for (int i = 0; i < get_num_stored(dt_points[side]); i++){
+            fprintf(f, " %d", record_table_footpath_id(tables[side],
+                                                       records[i]));
+        }
+    }
+    fprintf(f, " : %.2Lf m\n", dist);
+}
@@ -0,0 +1,8 @@
+#ifndef _DISTANCEJOIN_H_
+#define _DISTANCEJOIN_H_
+#include <stdio.h>
+#include "quadTree.h"
+
+long tree_distance_join(quadtree_t *tree_a, quadtree_t *tree_b,
+                        long double max_dist, int num_threads, FILE *f);
+#endif
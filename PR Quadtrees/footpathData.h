@@ -1,19 +1,31 @@
-#ifndef _FOOTPATHDATA_H_
-#define _FOOTPATHDATA_H_
-#include <stdio.h>
-#include "point2D.h"
-
-// Foot path data struct def
-typedef struct footpath footpath_t;
-
-footpath_t *footpath_read(FILE *data_file);
-char *str_field_read(FILE *f);
-void data_print(footpath_t *record, FILE *f);
-void data_free(footpath_t *record);
-int footpath_id_cmp(footpath_t *footpath1, footpath_t *footpath2);
-char *get_address(footpath_t *record);
-double get_grade1in(footpath_t *record);
-point_t *get_start_point(footpath_t *record);
-point_t *get_end_point(footpath_t *record);
-int sorted_record_add(footpath_t **arr, footpath_t *record, int num_ele);
+#ifndef _FOOTPATHDATA_H_
+#define _FOOTPATHDATA_H_
+#include <stdio.h>
+#include "point2D.h"
+
+// Foot path data struct def
+typedef struct footpath footpath_t;
+
+footpath_t *footpath_read(FILE *data_file);
+int footpath_read_into(FILE *data_file, footpath_t *footpath);
+char *str_field_read(FILE *f);
+void data_print(footpath_t *record, FILE *f);
+void data_free(footpath_t *record);
+void data_fields_free(footpath_t *record);
+void footpath_move(footpath_t *dest, footpath_t *src);
+footpath_t *footpath_array_resize(footpath_t *arr, int size);
+footpath_t *footpath_array_get(footpath_t *arr, int idx);
+int footpath_id_cmp(footpath_t *footpath1, footpath_t *footpath2);
+int get_footpath_id(footpath_t *record);
+char *get_address(footpath_t *record);
+double get_grade1in(footpath_t *record);
+double get_distance(footpath_t *record);
+double get_deltaz(footpath_t *record);
+char *get_clue_sa(footpath_t *record);
+char *get_asset_type(footpath_t *record);
+char *get_segside(footpath_t *record);
+int get_streetid(footpath_t *record);
+int get_street_group(footpath_t *record);
+point_t *get_start_point(footpath_t *record);
+point_t *get_end_point(footpath_t *record);
 #endif
\ No newline at end of file
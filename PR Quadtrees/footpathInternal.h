@@ -0,0 +1,20 @@
+#ifndef _FOOTPATHINTERNAL_H_
+#define _FOOTPATHINTERNAL_H_
+#include "footpathData.h"
+
+/* Layout of a footpath record, shared by the modules that store records 
+in another form instead of going through footpathData.h */
+
+// Struct definition for storing footpath data
+struct footpath{
+    int footpath_id;
+    char *address, *clue_sa, *asset_type;
+    double deltaz, distance, grade1in;
+    int mcc_id, mccid_int;
+    double rlmax, rlmin;
+    char *segside;
+    int statusid, streetid, street_group;
+    double start_lat,start_lon,end_lat,end_lon;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/* gridIndex.c
+*
+* Created by Ke Liao
+*
+* This module is the uniform grid backend of the spatial index interface. 
+* The area is cut into equal cells, about POINTS_PER_CELL locations to a 
+* cell on average, and the locations of each cell are stored next to each
+* other. Nearest neighbours are found by searching rings of cells around 
+* the query's cell, out until no closer location can be left.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "quadTree.h"
+#include "spatialIndexInternal.h"
+#include "gridIndex.h"
+#include "usefulConsts.h"
+
+#define POINTS_PER_CELL 2
+#define CELL_EDGE_SLACK 1e-9L  // Cell edges may be off by rounding
+
+typedef struct grid{
+    index_points_t *points;
+    long double left;
+    long double bot;
+    long double cell_width;
+    long double cell_height;
+    int cells_per_side;
+    int *first_point;   // points of cell c: first_point[c] to [c + 1] - 1
+    int *cell_points;
+} grid_t;
+
+
+static void *grid_create(record_table_t *table, index_points_t *points,
+                         rectangle_t *area);
+static int cell_column(grid_t *grid, long double lon);
+static int cell_row(grid_t *grid, long double lat);
+static void grid_point_query(void *index, point_t *query,
+                             matched_records_t *matches);
+static void grid_range_query(void *index, rectangle_t *query,
+                             matched_records_t *matches);
+static void grid_knn_query(void *index, point_t *query, 
+                           knn_result_t *result);
+static void cell_knn_query(grid_t *grid, int column, int row, 
+                           point_t *query, knn_result_t *result);
+static void grid_free(void *index);
+
+const index_backend_t grid_backend = {"grid", grid_create, grid_point_query,
+    grid_range_query, grid_knn_query, grid_free};
+
+
+/* Bucket the locations into the cells of the grid */
+static void *grid_create(record_table_t *table, index_points_t *points,
+                         rectangle_t *area){
+    grid_t *grid = malloc(sizeof(*grid));
+    assert(grid != NULL);
+    grid->points = points;
+    grid->cells_per_side = (int)ceil(sqrt((double)points->num_points / 
+                                          POINTS_PER_CELL));
+    if (grid->cells_per_side < 1){
+        grid->cells_per_side = 1;
+    }
+    grid->left = get_lon(get_bottomleft(area));
+    grid->bot = get_lat(get_bottomleft(area));
+    grid->cell_width = (get_lon(get_topright(area)) - grid->left) / 
+                       grid->cells_per_side;
+    grid->cell_height = (get_lat(get_topright(area)) - grid->bot) / 
+                        grid->cells_per_side;
+
+    // Count the locations of each cell, then place them
+    int num_cells = grid->cells_per_side * grid->cells_per_side;
+    grid->first_point = calloc(num_cells + 1, sizeof(int));
+    grid->cell_points = malloc(sizeof(int) * (points->num_points + 1));
+    assert(grid->first_point != NULL && grid->cell_points != NULL);
+    int *cells = malloc(sizeof(int) * (points->num_points + 1));
+    assert(cells != NULL);
+    for (int i = 0; i < points->num_points; i++){
+        cells[i] = cell_row(grid, points->lats[i]) * grid->cells_per_side +
+                   cell_column(grid, points->lons[i]);
+        grid->first_point[cells[i] + 1]++;
+    }
+    for (int cell = 0; cell < num_cells; cell++){
+        grid->first_point[cell + 1] += grid->first_point[cell];
+    }
+    int *fill = malloc(sizeof(int) * num_cells);
+    assert(fill != NULL);
+    for (int cell = 0; cell < num_cells; cell++){
+        fill[cell] = grid->first_point[cell];
+    }
+    for (int i = 0; i < points->num_points; i++){
+        grid->cell_points[fill[cells[i]]++] = i;
+    }
+    free(fill);
+    free(cells);
+    return grid;
+}
+
+
+/* Column of the cell the longitude is in, clamped to the grid */
+static int cell_column(grid_t *grid, long double lon){
+    long double column = floorl((lon - grid->left) / grid->cell_width);
+    if (column < 0){
+        return 0;
+    }else if (column >= grid->cells_per_side){
+        return grid->cells_per_side - 1;
+    }
+    return (int)column;
+}
+
+
+/* Row of the cell the latitude is in, clamped to the grid */
+static int cell_row(grid_t *grid, long double lat){
+    long double row = floorl((lat - grid->bot) / grid->cell_height);
+    if (row < 0){
+        return 0;
+    }else if (row >= grid->cells_per_side){
+        return grid->cells_per_side - 1;
+    }
+    return (int)row;
+}
+
+
+/* Find the location equal to the query in its cell */
+static void grid_point_query(void *index, point_t *query,
+                             matched_records_t *matches){
+    grid_t *grid = index;
+    long double lon = get_lon(query), lat = get_lat(query);
+    int cell = cell_row(grid, lat) * grid->cells_per_side + 
+               cell_column(grid, lon);
+    for (int i = grid->first_point[cell]; i < grid->first_point[cell + 1]; 
+            i++){
+        int point = grid->cell_points[i];
+        if (grid->points->lons[point] == lon && 
+                grid->points->lats[point] == lat){
+            point_records_match(grid->points, point, matches);
+        }
+    }
+}
+
+
+/* Check the locations of every cell the query rectangle overlaps */
+static void grid_range_query(void *index, rectangle_t *query,
+                             matched_records_t *matches){
+    grid_t *grid = index;
+    int first_column = cell_column(grid, get_lon(get_bottomleft(query)));
+    int last_column = cell_column(grid, get_lon(get_topright(query)));
+    int first_row = cell_row(grid, get_lat(get_bottomleft(query)));
+    int last_row = cell_row(grid, get_lat(get_topright(query)));
+    for (int row = first_row; row <= last_row; row++){
+        for (int column = first_column; column <= last_column; column++){
+            int cell = row * grid->cells_per_side + column;
+            for (int i = grid->first_point[cell]; 
+                    i < grid->first_point[cell + 1]; i++){
+                int point = grid->cell_points[i];
+                if (rectangle_contains(query, grid->points->lons[point],
+                                       grid->points->lats[point])){
+                    point_records_match(grid->points, point, matches);
+                }
+            }
+        }
+    }
+}
+
+
+/* Search rings of cells around the query's cell, stopping once the next 
+ring is further than the furthest of the k found */
+static void grid_knn_query(void *index, point_t *query, 
+                           knn_result_t *result){
+    grid_t *grid = index;
+    long double lon = get_lon(query), lat = get_lat(query);
+    int centre_column = cell_column(grid, lon);
+    int centre_row = cell_row(grid, lat);
+
+    for (int ring = 0; ring < grid->cells_per_side; ring++){
+        for (int row = centre_row - ring; row <= centre_row + ring; row++){
+            if (row < 0 || row >= grid->cells_per_side){
+                continue;
+            }
+            int on_edge = (row == centre_row - ring || 
+                           row == centre_row + ring);
+            int step = on_edge ? 1 : 2 * ring;
+            for (int column = centre_column - ring; 
+                    column <= centre_column + ring; column += step){
+                if (column >= 0 && column < grid->cells_per_side){
+                    cell_knn_query(grid, column, row, query, result);
+                }
+                if (step == 0){
+                    break;
+                }
+            }
+        }
+
+        // Least distance to any cell outside the rings searched so far
+        long double square_left = grid->left + (centre_column - ring) * 
+                                  grid->cell_width;
+        long double square_right = square_left + (2 * ring + 1) * 
+                                   grid->cell_width;
+        long double square_bot = grid->bot + (centre_row - ring) * 
+                                 grid->cell_height;
+        long double square_top = square_bot + (2 * ring + 1) * 
+                                 grid->cell_height;
+        long double lon_gap = fminl(lon - square_left, square_right - lon) -
+                              grid->cell_width * CELL_EDGE_SLACK;
+        long double lat_gap = fminl(lat - square_bot, square_top - lat) -
+                              grid->cell_height * CELL_EDGE_SLACK;
+        long double next_bound = fminl(
+            haversine_lower_bound(fmaxl(lon_gap, 0), 0, result->max_abs_lat),
+            haversine_lower_bound(0, fmaxl(lat_gap, 0), result->max_abs_lat));
+        if (next_bound > knn_bound(result)){
+            return;
+        }
+    }
+}
+
+
+/* Offer the locations of the cell to the result */
+static void cell_knn_query(grid_t *grid, int column, int row, 
+                           point_t *query, knn_result_t *result){
+    int cell = row * grid->cells_per_side + column;
+    for (int i = grid->first_point[cell]; i < grid->first_point[cell + 1]; 
+            i++){
+        int point = grid->cell_points[i];
+        long double lon = grid->points->lons[point];
+        long double lat = grid->points->lats[point];
+        long double dist = haversine_coords(get_lon(query), get_lat(query),
+                                            lon, lat);
+        knn_offer(result, dist, lon, lat, grid->points->records + 
+                  grid->points->first_record[point],
+                  grid->points->first_record[point + 1] - 
+                  grid->points->first_record[point]);
+    }
+}
+
+
+/* Free the grid, the locations belong to the interface */
+static void grid_free(void *index){
+    grid_t *grid = index;
+    free(grid->first_point);
+    free(grid->cell_points);
+    free(grid);
+}
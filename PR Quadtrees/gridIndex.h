@@ -0,0 +1,6 @@
+#ifndef _GRIDINDEX_H_
+#define _GRIDINDEX_H_
+#include "spatialIndexInternal.h"
+
+extern const index_backend_t grid_backend;
+#endif
@@ -0,0 +1,198 @@
+/* indexBenchmark.c
+*
+* Created by Ke Liao
+*
+* This program compares the index backends on one dataset: for each it
+* times the build, measures the heap memory the index holds and times the
+* point, range & k nearest neighbour queries given. The number of records
+* found by each backend is printed as well, so a backend giving different
+* results stands out.
+*
+* Usage: ./indexBenchmark dataset.csv bl_lon bl_lat tr_lon tr_lat
+*        point_queries range_queries k
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <malloc.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "spatialIndex.h"
+#include "compressedInput.h"
+
+#define NUM_ARGS 9
+#define INITIAL_QUERIES 64
+#define MICRO_PER_SEC 1e6
+#define NANO_PER_MICRO 1e3
+#define MICRO_PER_MILLI 1e3
+
+typedef struct {
+    int num_queries;
+    int query_size;
+    double (*coords)[4];
+} query_list_t;
+
+query_list_t *query_list_read(char *file_name, int num_coords);
+double elapsed_micro(struct timespec *start);
+void backend_benchmark(const char *backend, record_table_t *records,
+                       double area[4], query_list_t *points,
+                       query_list_t *ranges, int k);
+
+
+int main(int argc, char *argv[]){
+    if (argc != NUM_ARGS){
+        fprintf(stderr, "Usage: %s dataset.csv bl_lon bl_lat tr_lon tr_lat "
+                "point_queries range_queries k\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *input_file = compressed_input_open(argv[1]);
+    assert(input_file);
+
+    // Skip the first line as headers don't contain data
+    int a;
+    while ((a = fgetc(input_file)) != '\n' && a != EOF){}
+    record_table_t *records = record_table_read(input_file);
+    fclose(input_file);
+
+    double area[4];
+    for (int i = 0; i < 4; i++){
+        area[i] = strtod(argv[2 + i], NULL);
+    }
+    query_list_t *points = query_list_read(argv[6], 2);
+    query_list_t *ranges = query_list_read(argv[7], 4);
+    int k = atoi(argv[8]);
+
+    printf("%-10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "index",
+           "build_ms", "memory_kb", "point_us", "found", "range_us",
+           "found", "knn_us", "found");
+    for (int i = 0; i < spatial_backend_count(); i++){
+        backend_benchmark(spatial_backend_name(i), records, area, points,
+                          ranges, k);
+    }
+
+    free(points->coords);
+    free(points);
+    free(ranges->coords);
+    free(ranges);
+    record_table_free(records);
+    return 0;
+}
+
+
+/* Read each line of the file as a query of num_coords coordinates*/
+query_list_t *query_list_read(char *file_name, int num_coords){
+    FILE *query_file = fopen(file_name, "r");
+    assert(query_file);
+
+    query_list_t *list = malloc(sizeof(*list));
+    assert(list);
+    list->num_queries = 0;
+    list->query_size = INITIAL_QUERIES;
+    list->coords = malloc(sizeof(*list->coords) * list->query_size);
+    assert(list->coords);
+
+    char *query = NULL;
+    size_t query_len = 0;
+    while (getline(&query, &query_len, query_file) != EOF){
+        double *coords = list->coords[list->num_queries];
+        if (sscanf(query, "%lf %lf %lf %lf", &coords[0], &coords[1],
+                   &coords[2], &coords[3]) < num_coords){
+            continue;
+        }
+        list->num_queries++;
+        if (list->num_queries == list->query_size){
+            list->query_size *= 2;
+            list->coords = realloc(list->coords,
+                                   sizeof(*list->coords) * list->query_size);
+            assert(list->coords);
+        }
+    }
+
+    free(query);
+    fclose(query_file);
+    return list;
+}
+
+
+/* Microseconds since start*/
+double elapsed_micro(struct timespec *start){
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * MICRO_PER_SEC +
+           (end.tv_nsec - start->tv_nsec) / NANO_PER_MICRO;
+}
+
+
+/* Build the backend & run each query list through it, printing one row*/
+void backend_benchmark(const char *backend, record_table_t *records,
+                       double area[4], query_list_t *points,
+                       query_list_t *ranges, int k){
+    struct timespec start;
+    size_t memory_before = mallinfo2().uordblks;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    spatial_index_t *index = spatial_index_create(backend, records,
+        point_creator(area[0], area[1]), point_creator(area[2], area[3]));
+    assert(index);
+    double build_time = elapsed_micro(&start);
+    size_t memory = mallinfo2().uordblks - memory_before;
+
+    // Exact point queries
+    long point_found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < points->num_queries; i++){
+        point_t *query = point_creator(points->coords[i][0],
+                                       points->coords[i][1]);
+        matched_records_t *matches = record_struct_create(records);
+        spatial_point_query(index, query, matches);
+        point_found += matched_record_count(matches);
+        matched_record_struct_free(matches);
+        point_free(query);
+    }
+    double point_time = elapsed_micro(&start);
+
+    // Range queries
+    long range_found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ranges->num_queries; i++){
+        double *coords = ranges->coords[i];
+        rectangle_t *query = rectangle_create(
+            point_creator(coords[0], coords[1]),
+            point_creator(coords[2], coords[3]));
+        matched_records_t *matches = record_struct_create(records);
+        spatial_range_query(index, query, matches);
+        range_found += matched_record_count(matches);
+        matched_record_struct_free(matches);
+        rectangle_free(query);
+    }
+    double range_time = elapsed_micro(&start);
+
+    // k nearest neighbours of each point query
+    long knn_found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < points->num_queries; i++){
+        point_t *query = point_creator(points->coords[i][0],
+                                       points->coords[i][1]);
+        knn_result_t *nearest = spatial_knn_query(index, query, k);
+        knn_found += knn_result_count(nearest);
+        knn_result_free(nearest);
+        point_free(query);
+    }
+    double knn_time = elapsed_micro(&start);
+
+    printf("%-10s %10.2f %10zu %10.2f %10ld %10.2f %10ld %10.2f %10ld\n",
+           backend, build_time / MICRO_PER_MILLI, memory / 1024,
+           points->num_queries ? point_time / points->num_queries : 0,
+           point_found,
+           ranges->num_queries ? range_time / ranges->num_queries : 0,
+           range_found,
+           points->num_queries ? knn_time / points->num_queries : 0,
+           knn_found);
+
+    spatial_index_free(index);
+}
@@ -0,0 +1,257 @@
+/* kdTree.c
+*
+* Created by Ke Liao
+*
+* This module is the k-d tree backend of the spatial index interface. The 
+* tree is balanced and stored implicitly in an array of the locations: the
+* middle of each range is the median of the range by longitude or latitude
+* (alternating by depth), with the smaller half before it and the larger 
+* after it.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "quadTree.h"
+#include "spatialIndexInternal.h"
+#include "kdTree.h"
+#include "usefulConsts.h"
+
+#define LON_AXIS 0
+#define LAT_AXIS 1
+
+typedef struct kdtree{
+    index_points_t *points;
+    int *order;    // locations in tree order
+    int num_points;
+} kdtree_t;
+
+
+static void *kdtree_create(record_table_t *table, index_points_t *points,
+                           rectangle_t *area);
+static void subtree_build(kdtree_t *kdtree, int first, int last, int axis);
+static long double axis_value(kdtree_t *kdtree, int idx, int axis);
+static void kdtree_point_query(void *index, point_t *query,
+                               matched_records_t *matches);
+static void subtree_point_query(kdtree_t *kdtree, int first, int last, 
+                                int axis, point_t *query,
+                                matched_records_t *matches);
+static void kdtree_range_query(void *index, rectangle_t *query,
+                               matched_records_t *matches);
+static void subtree_range_query(kdtree_t *kdtree, int first, int last, 
+                                int axis, rectangle_t *query, 
+                                long double *bounds, 
+                                matched_records_t *matches);
+static void kdtree_knn_query(void *index, point_t *query, 
+                             knn_result_t *result);
+static void subtree_knn_query(kdtree_t *kdtree, int first, int last, 
+                              int axis, point_t *query, knn_result_t *result);
+static void kdtree_free(void *index);
+
+const index_backend_t kdtree_backend = {"kdtree", kdtree_create, 
+    kdtree_point_query, kdtree_range_query, kdtree_knn_query, kdtree_free};
+
+
+/* Arrange the locations into a balanced tree */
+static void *kdtree_create(record_table_t *table, index_points_t *points,
+                           rectangle_t *area){
+    kdtree_t *kdtree = malloc(sizeof(*kdtree));
+    assert(kdtree != NULL);
+    kdtree->points = points;
+    kdtree->num_points = points->num_points;
+    kdtree->order = malloc(sizeof(int) * (points->num_points + 1));
+    assert(kdtree->order != NULL);
+    for (int i = 0; i < points->num_points; i++){
+        kdtree->order[i] = i;
+    }
+    subtree_build(kdtree, 0, points->num_points, LON_AXIS);
+    return kdtree;
+}
+
+
+/* Put the median of order[first..last - 1] by axis in the middle with the 
+smaller values before & larger after(quickselect), then do the same to 
+each half by the other axis */
+static void subtree_build(kdtree_t *kdtree, int first, int last, int axis){
+    if (last - first <= 1){
+        return;
+    }
+    int *order = kdtree->order;
+    int mid = first + (last - first) / 2;
+    int low = first, high = last - 1;
+    while (low < high){
+        long double pivot = axis_value(kdtree, low + (high - low) / 2, axis);
+        int i = low, j = high;
+        while (i <= j){
+            while (axis_value(kdtree, i, axis) < pivot){
+                i++;
+            }
+            while (axis_value(kdtree, j, axis) > pivot){
+                j--;
+            }
+            if (i <= j){
+                int temp = order[i];
+                order[i] = order[j];
+                order[j] = temp;
+                i++;
+                j--;
+            }
+        }
+        if (mid <= j){
+            high = j;
+        }else if (mid >= i){
+            low = i;
+        }else{
+            break;
+        }
+    }
+    subtree_build(kdtree, first, mid, !axis);
+    subtree_build(kdtree, mid + 1, last, !axis);
+}
+
+
+/* Longitude or latitude of the location at idx of the tree order */
+static long double axis_value(kdtree_t *kdtree, int idx, int axis){
+    int point = kdtree->order[idx];
+    if (axis == LON_AXIS){
+        return kdtree->points->lons[point];
+    }
+    return kdtree->points->lats[point];
+}
+
+
+/* Find the location equal to the query */
+static void kdtree_point_query(void *index, point_t *query,
+                               matched_records_t *matches){
+    kdtree_t *kdtree = index;
+    subtree_point_query(kdtree, 0, kdtree->num_points, LON_AXIS, query, 
+                        matches);
+}
+
+
+/* Search the subtree of order[first..last - 1] for the query location, 
+going into both halves when the query is on the split */
+static void subtree_point_query(kdtree_t *kdtree, int first, int last, 
+                                int axis, point_t *query,
+                                matched_records_t *matches){
+    if (first >= last){
+        return;
+    }
+    int mid = first + (last - first) / 2;
+    int point = kdtree->order[mid];
+    long double lon = get_lon(query), lat = get_lat(query);
+    if (kdtree->points->lons[point] == lon && 
+            kdtree->points->lats[point] == lat){
+        point_records_match(kdtree->points, point, matches);
+        return;   // locations are distinct
+    }
+    long double split = axis_value(kdtree, mid, axis);
+    long double value = axis == LON_AXIS ? lon : lat;
+    if (value <= split){
+        subtree_point_query(kdtree, first, mid, !axis, query, matches);
+    }
+    if (value >= split){
+        subtree_point_query(kdtree, mid + 1, last, !axis, query, matches);
+    }
+}
+
+
+/* Find the locations in the query rectangle */
+static void kdtree_range_query(void *index, rectangle_t *query,
+                               matched_records_t *matches){
+    kdtree_t *kdtree = index;
+    long double bounds[] = {get_lon(get_bottomleft(query)), 
+        get_lat(get_bottomleft(query)), get_lon(get_topright(query)),
+        get_lat(get_topright(query))};
+    subtree_range_query(kdtree, 0, kdtree->num_points, LON_AXIS, query, 
+                        bounds, matches);
+}
+
+
+/* Search the subtree of order[first..last - 1] for locations in the query
+(with bounds left, bot, right, top), skipping halves the query misses */
+static void subtree_range_query(kdtree_t *kdtree, int first, int last, 
+                                int axis, rectangle_t *query, 
+                                long double *bounds, 
+                                matched_records_t *matches){
+    if (first >= last){
+        return;
+    }
+    int mid = first + (last - first) / 2;
+    int point = kdtree->order[mid];
+    if (rectangle_contains(query, kdtree->points->lons[point],
+                           kdtree->points->lats[point])){
+        point_records_match(kdtree->points, point, matches);
+    }
+    long double split = axis_value(kdtree, mid, axis);
+    long double low = axis == LON_AXIS ? bounds[0] : bounds[1];
+    long double high = axis == LON_AXIS ? bounds[2] : bounds[3];
+    if (low <= split){
+        subtree_range_query(kdtree, first, mid, !axis, query, bounds, 
+                            matches);
+    }
+    if (high >= split){
+        subtree_range_query(kdtree, mid + 1, last, !axis, query, bounds,
+                            matches);
+    }
+}
+
+
+/* Search for the nearest locations */
+static void kdtree_knn_query(void *index, point_t *query, 
+                             knn_result_t *result){
+    kdtree_t *kdtree = index;
+    subtree_knn_query(kdtree, 0, kdtree->num_points, LON_AXIS, query, 
+                      result);
+}
+
+
+/* Offer the locations of the subtree to the result, the half the query is
+in first, and the other half only if the split is closer than the 
+furthest of the k found so far */
+static void subtree_knn_query(kdtree_t *kdtree, int first, int last, 
+                              int axis, point_t *query, knn_result_t *result){
+    if (first >= last){
+        return;
+    }
+    int mid = first + (last - first) / 2;
+    int point = kdtree->order[mid];
+    long double lon = kdtree->points->lons[point];
+    long double lat = kdtree->points->lats[point];
+    long double dist = haversine_coords(get_lon(query), get_lat(query), 
+                                        lon, lat);
+    knn_offer(result, dist, lon, lat, kdtree->points->records + 
+              kdtree->points->first_record[point],
+              kdtree->points->first_record[point + 1] - 
+              kdtree->points->first_record[point]);
+
+    long double split = axis_value(kdtree, mid, axis);
+    long double value = axis == LON_AXIS ? get_lon(query) : get_lat(query);
+    long double gap = fabsl(value - split);
+    long double split_dist = axis == LON_AXIS ? 
+        haversine_lower_bound(gap, 0, result->max_abs_lat) :
+        haversine_lower_bound(0, gap, result->max_abs_lat);
+    if (value <= split){
+        subtree_knn_query(kdtree, first, mid, !axis, query, result);
+        if (split_dist <= knn_bound(result)){
+            subtree_knn_query(kdtree, mid + 1, last, !axis, query, result);
+        }
+    }else{
+        subtree_knn_query(kdtree, mid + 1, last, !axis, query, result);
+        if (split_dist <= knn_bound(result)){
+            subtree_knn_query(kdtree, first, mid, !axis, query, result);
+        }
+    }
+}
+
+
+/* Free the tree, the locations belong to the interface */
+static void kdtree_free(void *index){
+    kdtree_t *kdtree = index;
+    free(kdtree->order);
+    free(kdtree);
+}
@@ -0,0 +1,6 @@
+#ifndef _KDTREE_H_
+#define _KDTREE_H_
+#include "spatialIndexInternal.h"
+
+extern const index_backend_t kdtree_backend;
+#endif
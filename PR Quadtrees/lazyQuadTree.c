@@ -0,0 +1,167 @@
+/* lazyQuadTree.c
+*
+* Created by Ke Liao
+*
+* This module contains functions for building the quad tree lazily. Loading
+* only puts the (record, point) pairs in a bucket at the root. A node with a
+* bucket is built the first time a search looks at it: it becomes a leaf if
+* all its points are the same, otherwise its pairs are split into buckets of
+* new children for the quadrants holding points. Each node is only built 
+* once, so the tree grows into the same tree an eager build gives, but a few
+* searches only pay for the nodes they visit.
+*
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "usefulConsts.h"
+
+// A record inserted by one of its points, not yet pushed down the tree
+typedef struct pending_entry{
+    record_id_t record;
+    point_t *point;
+} pending_entry_t;
+
+// Pairs waiting under a node which hasn't been built yet(in insert order)
+struct pending_bucket{
+    record_table_t *table;
+    pending_entry_t *entries;
+    int num_ele;    // number of elements in array
+    int max_size;   // max array size
+};
+
+
+static pending_bucket_t *bucket_create(record_table_t *table);
+static void bucket_add(pending_bucket_t *bucket, record_id_t record,
+                       point_t *point);
+
+
+/* Create a new lazily built quad Tree over a defined bot_left & top_right 
+points*/
+quadtree_t *tree_create_lazy(record_table_t *records, point_t *bot_left,
+                             point_t *top_right){
+    quadtree_t *new_tree = tree_create(records, bot_left, top_right);
+    new_tree->lazy = TRUE;
+    return new_tree;
+}
+
+
+/* Add the record by the point to the root's bucket, without building nodes*/
+void lazy_insert(quadtree_t *qtree, record_id_t record, point_t *point){
+    
+    // don't insert if not within the tree
+    if (!in_rectangle(qtree->root->rectangle, point)){
+        return;
+    }
+    if (qtree->root->pending == NULL){
+        qtree->root->pending = bucket_create(qtree->records);
+    }
+    bucket_add(qtree->root->pending, record, point);
+}
+
+
+/* Build the node from its bucket: a leaf if every point in it is the same,
+otherwise an internal node with a bucket for each quadrant holding points */
+void node_expand(quadtree_node_t *node){
+    pending_bucket_t *bucket = node->pending;
+    if (bucket == NULL){
+        return;   // Already built
+    }
+    node->pending = NULL;
+
+    // Leaf if all points are the same
+    point_t *first_point = bucket->entries[0].point;
+    int all_same = TRUE;
+    for (int i = 1; i < bucket->num_ele && all_same; i++){
+        if (point_cmp(first_point, bucket->entries[i].point) != EQUALS){
+            all_same = FALSE;
+        }
+    }
+    if (all_same){
+        node->dt_point = data_point_create(first_point);
+        for (int i = 0; i < bucket->num_ele; i++){
+            record_dt_point_add(node->dt_point, bucket->table,
+                                bucket->entries[i].record);
+            if (i > 0){
+                point_free(bucket->entries[i].point);  // No longer needed
+            }
+        }
+        free(bucket->entries);
+        free(bucket);
+        return;
+    }
+
+    // Otherwise pass each pair on to its quadrant, keeping the insert order
+    for (int i = 0; i < bucket->num_ele; i++){
+        pending_entry_t *entry = &bucket->entries[i];
+        int quad = determine_quadrant(node->rectangle, entry->point);
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            rectangle_t *new_quadrant = quadrant_assign(node->rectangle, quad);
+            child = tree_node_create(new_quadrant);
+            child->pending = bucket_create(bucket->table);
+            set_child(node, quad, child);
+        }
+        bucket_add(child->pending, entry->record, entry->point);
+    }
+    free(bucket->entries);
+    free(bucket);
+}
+
+
+/* Build every node under the node that hasn't been built yet */
+void tree_expand_all(quadtree_node_t *node){
+    if (node == NULL || is_leaf_node(node)){
+        return;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        tree_expand_all(get_child(node, quad));
+    }
+}
+
+
+/* Free a bucket of a node that was never built, along with its points */
+void pending_bucket_free(pending_bucket_t *bucket){
+    for (int i = 0; i < bucket->num_ele; i++){
+        point_free(bucket->entries[i].point);
+    }
+    free(bucket->entries);
+    free(bucket);
+}
+
+
+/* Create an empty bucket */
+static pending_bucket_t *bucket_create(record_table_t *table){
+    pending_bucket_t *bucket = malloc(sizeof(*bucket));
+    assert(bucket != NULL);
+    bucket->table = table;
+    bucket->num_ele = 0;
+    bucket->max_size = 1;
+    bucket->entries = malloc(sizeof(pending_entry_t) * bucket->max_size);
+    assert(bucket->entries != NULL);
+    return bucket;
+}
+
+
+/* Add a (record, point) pair to the end of the bucket */
+static void bucket_add(pending_bucket_t *bucket, record_id_t record,
+                       point_t *point){
+    if (bucket->num_ele == bucket->max_size){
+        bucket->max_size *= 2;
+        bucket->entries = realloc(bucket->entries,
+            sizeof(pending_entry_t) * bucket->max_size);
+        assert(bucket->entries != NULL);
+    }
+    bucket->entries[bucket->num_ele].record = record;
+    bucket->entries[bucket->num_ele].point = point;
+    bucket->num_ele++;
+}
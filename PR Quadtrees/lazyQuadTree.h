@@ -0,0 +1,14 @@
+#ifndef _LAZYQUADTREE_H_
+#define _LAZYQUADTREE_H_
+#include "quadTree.h"
+#include "recordTable.h"
+
+typedef struct pending_bucket pending_bucket_t;
+
+quadtree_t *tree_create_lazy(record_table_t *records, point_t *bot_left,
+                             point_t *top_right);
+void lazy_insert(quadtree_t *qtree, record_id_t record, point_t *point);
+void node_expand(quadtree_node_t *node);
+void tree_expand_all(quadtree_node_t *node);
+void pending_bucket_free(pending_bucket_t *bucket);
+#endif
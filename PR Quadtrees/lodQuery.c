@@ -0,0 +1,258 @@
+/* lodQuery.c
+*
+* Created by Ke Liao
+*
+* This module answers a range query with at most N records spread over
+* the rectangle, for drawing a map zoomed out. Instead of finding every
+* record, the nodes overlapping the rectangle are taken a level at a time
+* a level has more than N of them. Each node gives one record: the first
+* by footpath id at the point under it nearest its centre(kept for every
+* node, in a table beside the tree). When the level has too many nodes, it
+* is cut into N runs of nodes & each run gives the record of its first
+* node with one; as a level is in Z order(each node's children SW, NW, NE,
+* SE together), that spreads them over the rectangle.
+*
+* A node only partly in the rectangle may have its point outside it; its
+* children are then tried(those in the rectangle) for one inside. If the
+* search reaches the leaves with places to spare, the other records at
+* them fill those places.
+*
+* The same query & N always give the same records.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "nodeTable.h"
+#include "lodQuery.h"
+#include "usefulConsts.h"
+
+#define INITIAL_SIZE 64
+
+struct lod_index{
+    quadtree_t *qtree;
+    node_table_t *representatives;   // leaf picked for each node, or NULL
+};
+
+// Nodes of a level of the search
+typedef struct {
+    quadtree_node_t **nodes;
+    int num_nodes, size;
+} lod_level_t;
+
+static quadtree_node_t *representative_build(lod_index_t *index,
+                                             quadtree_node_t *node);
+static long double centre_distance(quadtree_node_t *node,
+                                   quadtree_node_t *leaf);
+static quadtree_node_t *representative_find(lod_index_t *index,
+                                            quadtree_node_t *node,
+                                            rectangle_t *query);
+static void level_add(lod_level_t *level, quadtree_node_t *node);
+
+
+/* Pick the leaf of each node nearest its centre */
+lod_index_t *lod_index_create(quadtree_t *qtree){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+    lod_index_t *index = malloc(sizeof(*index));
+    assert(index);
+    index->qtree = qtree;
+    index->representatives = node_table_create(qtree->root,
+                                               sizeof(quadtree_node_t*));
+    representative_build(index, qtree->root);
+    return index;
+}
+
+
+/* Pick the node's leaf from those of its children */
+static quadtree_node_t *representative_build(lod_index_t *index,
+                                             quadtree_node_t *node){
+    quadtree_node_t *best = NULL;
+    if (is_leaf_node(node)){
+        if (node->dt_point != NULL){
+            best = node;
+        }
+    }else{
+        long double best_distance = 0;
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            quadtree_node_t *leaf = representative_build(index, child);
+            if (leaf == NULL){
+                continue;
+            }
+            long double distance = centre_distance(node, leaf);
+            if (best == NULL || distance < best_distance){
+                best = leaf;
+                best_distance = distance;
+            }
+        }
+    }
+    quadtree_node_t **slot = node_table_get(index->representatives, node);
+    *slot = best;
+    return best;
+}
+
+
+/* Squared distance(in degrees) from the centre of the node to the leaf's
+point */
+static long double centre_distance(quadtree_node_t *node,
+                                   quadtree_node_t *leaf){
+    point_t *bot_left = get_bottomleft(node->rectangle);
+    point_t *top_right = get_topright(node->rectangle);
+    point_t *loc = get_dt_point_loc(leaf->dt_point);
+    long double dlon = get_lon(loc) - (get_lon(bot_left) +
+                                       get_lon(top_right)) / 2;
+    long double dlat = get_lat(loc) - (get_lat(bot_left) +
+                                       get_lat(top_right)) / 2;
+    return dlon * dlon + dlat * dlat;
+}
+
+
+/* Output to f at most max_records records with a point in the query,
+spread over it & sorted by footpath id, & to summary the number output &
+the depth of the nodes they were taken from */
+void lod_ranged_query(lod_index_t *index, rectangle_t *query, int max_records,
+                      FILE *f, FILE *summary){
+    lod_level_t level = {NULL, 0, 0}, next = {NULL, 0, 0};
+    quadtree_node_t *root = index->qtree->root;
+    if (max_records > 0 && rectangle_overlap(query, root->rectangle) &&
+            *(quadtree_node_t**)node_table_get(index->representatives,
+                                               root) != NULL){
+        level_add(&level, root);
+    }
+
+    /* Go down a level while it has at most max_records nodes(leaves are
+    kept as they are), stopping at the first level with more */
+    int depth = 0, more = level.num_nodes > 0;
+    while (more){
+        next.num_nodes = 0;
+        more = FALSE;
+        for (int i = 0; i < level.num_nodes; i++){
+            quadtree_node_t *node = level.nodes[i];
+            if (is_leaf_node(node)){
+                level_add(&next, node);
+                continue;
+            }
+            for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+                quadtree_node_t *child = get_child(node, quad);
+                if (child != NULL && rectangle_overlap(query,
+                        child->rectangle) && *(quadtree_node_t**)
+                        node_table_get(index->representatives,
+                                       child) != NULL){
+                    level_add(&next, child);
+                    more = TRUE;
+                }
+            }
+        }
+        if (!more){
+            break;
+        }
+        lod_level_t swap = level;
+        level = next;
+        next = swap;
+        depth++;
+        more = more && level.num_nodes <= max_records;
+    }
+
+    /* A record from each node(sorted by footpath id), or with too many 
+    nodes from each of max_records runs of them evenly through the level: 
+    the first of the run with a point in the query */
+    int num_runs = level.num_nodes < max_records ? level.num_nodes :
+                                                   max_records;
+    matched_records_t *matches = record_struct_create(index->qtree->records);
+    for (int run = 0; run < num_runs; run++){
+        long long end = (long long)(run + 1) * level.num_nodes / num_runs;
+        for (long long i = (long long)run * level.num_nodes / num_runs;
+                i < end; i++){
+            quadtree_node_t *leaf = representative_find(index, 
+                                                        level.nodes[i], query);
+            if (leaf != NULL){
+                matched_record_insert(matches,
+                                      get_record_list(leaf->dt_point)[0]);
+                break;
+            }
+        }
+    }
+
+    /* Fill any places left with the other records at the leaves reached,
+    so a query with few records reaching the leaves gets them all */
+    for (int i = 0; i < level.num_nodes; i++){
+        quadtree_node_t *leaf = level.nodes[i];
+        if (!is_leaf_node(leaf) ||
+                !in_rectangle(query, get_dt_point_loc(leaf->dt_point))){
+            continue;
+        }
+        record_id_t *records = get_record_list(leaf->dt_point);
+        int num_records = get_num_stored(leaf->dt_point);
+        for (int j = 1; j < num_records &&
+                matched_record_count(matches) < max_records; j++){
+            matched_record_insert(matches, records[j]);
+        }
+    }
+    match_record_output(matches, f);
+    fprintf(summary, " %d footpaths, depth %d",
+            matched_record_count(matches), depth);
+    matched_record_struct_free(matches);
+    free(level.nodes);
+    free(next.nodes);
+}
+
+
+/* The node's leaf if its point is in the query, otherwise the first found
+in its children, or NULL if none has a point in the query */
+static quadtree_node_t *representative_find(lod_index_t *index,
+                                            quadtree_node_t *node,
+                                            rectangle_t *query){
+    quadtree_node_t *leaf = *(quadtree_node_t**)node_table_get(
+        index->representatives, node);
+    if (leaf == NULL){
+        return NULL;
+    }
+    if (in_rectangle(query, get_dt_point_loc(leaf->dt_point))){
+        return leaf;
+    }
+    if (is_leaf_node(node)){
+        return NULL;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL && rectangle_overlap(query, child->rectangle)){
+            leaf = representative_find(index, child, query);
+            if (leaf != NULL){
+                return leaf;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/* Add a node to the level */
+static void level_add(lod_level_t *level, quadtree_node_t *node){
+    if (level->num_nodes == level->size){
+        level->size = level->size ? 2 * level->size : INITIAL_SIZE;
+        level->nodes = realloc(level->nodes,
+                               sizeof(quadtree_node_t*) * level->size);
+        assert(level->nodes);
+    }
+    level->nodes[level->num_nodes++] = node;
+}
+
+
+/* Free the table of picked leaves(the tree is left alone)*/
+void lod_index_free(lod_index_t *index){
+    node_table_free(index->representatives);
+    free(index);
+}
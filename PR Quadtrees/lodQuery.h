@@ -0,0 +1,13 @@
+#ifndef _LODQUERY_H_
+#define _LODQUERY_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+typedef struct lod_index lod_index_t;
+
+lod_index_t *lod_index_create(quadtree_t *qtree);
+void lod_ranged_query(lod_index_t *index, rectangle_t *query, int max_records,
+                      FILE *f, FILE *summary);
+void lod_index_free(lod_index_t *index);
+#endif
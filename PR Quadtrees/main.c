@@ -1,147 +1,1077 @@
-/* main.c
-*
-* Created by Ke Liao
-*
-* This is the main program for the execution of stage 3 or 4, depending on
-* the flag included. 
-*
-* Both stage: Construct quad tree from the inputted footpath records over a
-* specified range.
-*
-* Stage 3: take query containing longitude and latitude 
-* 
-*/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include <string.h>
-#include "linkedList.h"
-#include "footpathData.h"
-#include "quadTree.h"
-#include "point2D.h"
-#include "rectangle.h"
-
-#define DEBUG 0
-#define STAGE3 3
-#define STAGE4 4
-#define STAGE_IDX 1
-#define INPUT_FILE 2
-#define OUTPUT_FILE 3
-#define BOT_LEFT_LON 4
-#define BOT_LEFT_LAT 5
-#define TOP_RIGHT_LON 6
-#define TOP_RIGHT_LAT 7
-
-void stage_3_implementation(quadtree_t *quadtree, FILE *output);
-void stage_4_implementation(quadtree_t *quadtree, FILE *output);
-
-
-int main(int argc, char *argv[]){
-    FILE *input_file = fopen(argv[INPUT_FILE],"r");
-    FILE *output_file = fopen(argv[OUTPUT_FILE],"w");
-    assert(input_file != NULL);
-    int stage = atoi(argv[STAGE_IDX]);
-    
-    // Create the empty quad tree
-    long double bot_left_lon, bot_left_lat, top_right_lon, top_right_lat;
-    sscanf(argv[BOT_LEFT_LON], "%LF", &bot_left_lon); 
-    sscanf(argv[BOT_LEFT_LAT], "%LF", &bot_left_lat);
-    sscanf(argv[TOP_RIGHT_LON], "%LF", &top_right_lon);
-    sscanf(argv[TOP_RIGHT_LAT], "%LF", &top_right_lat);
-    point_t *bot_left = point_creator(bot_left_lon, bot_left_lat);
-    point_t *top_right = point_creator(top_right_lon, top_right_lat);
-    quadtree_t *quadtree = tree_create(bot_left, top_right);
-
-    // Skip the first line as headers don't contain data
-    char a = 'r';
-    while((a = fgetc(input_file)) != '\n'){}
-
-    // Creation of linked_list for the footpath data
-    list_t *list = empty_list_create();
-    footpath_t *record;
-    while((record = footpath_read(input_file)) != NULL){
-        add_node(list, record);        
-    }
-
-    // Add footpath records into quad tree
-    list_node_t *curr_record_node = get_head(list);
-    while (curr_record_node != NULL){
-        add_record(quadtree, get_footpath_data(curr_record_node));
-        curr_record_node = next_node(curr_record_node);
-    }
-
-    if (stage == STAGE3){
-        stage_3_implementation(quadtree, output_file);
-    }else if (stage == STAGE4){
-        stage_4_implementation(quadtree, output_file);
-    }
-
-    free_quad_tree(quadtree);
-    list_free(list);
-    
-
-    // Close the files after finishing 
-    fclose(input_file);
-    fclose(output_file);    
-
-}
-
-
-/* Implementation of stage 3*/
-void stage_3_implementation(quadtree_t *quadtree, FILE *output){
-    
-    char *query = NULL;  // query inputs
-    size_t query_len = 0;
-
-    /* Read input point query & perform search & output results */
-    while (getline(&query, &query_len, stdin) != EOF){
-        
-        // Get rid of newline char in query
-        sscanf(query, "%[^\n]", query);
-        fprintf(output, "%s\n", query);
-
-        // Process query & perform search 
-        double query_lon, query_lat;
-        sscanf(query, "%lf %lf", &query_lon, &query_lat);
-        printf("%s -->", query);
-        point_t *query_point = point_creator(query_lon, query_lat);
-        tree_query(quadtree, query_point, output);
-        printf("\n");
-
-        point_free(query_point);
-    }
-
-    free(query);
-    query = NULL;
-}
-
-
-/* Implementation of stage 4*/
-void stage_4_implementation(quadtree_t *quadtree, FILE *output){
-    char *query = NULL;  // query inputs
-    size_t query_len = 0;
-
-    /* Read input point query & perform search & output results */
-    while (getline(&query, &query_len, stdin) != EOF){
-        
-        // Get rid of newline char in query
-        sscanf(query, "%[^\n]", query);
-        fprintf(output, "%s\n", query);
-        
-        // Process query and perform search
-        double left, right, top, bot;
-        sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
-        point_t *bot_left = point_creator(left, bot);
-        point_t *top_right = point_creator(right, top);
-        rectangle_t *query_rectangle = rectangle_create(bot_left, top_right);
-        printf("%s -->", query);
-        tree_ranged_query(quadtree, query_rectangle, output);
-        printf("\n");
-
-        rectangle_free(query_rectangle); 
-    }
-
-    free(query);
-    query = NULL;
+/* main.c
+*
+* Created by Ke Liao
+*
+* This is the main program for the execution of stage 3 or 4, depending on
+* the flag included. 
+*
+* Both stage: Construct quad tree from the inputted footpath records over a
+* specified range.
+*
+* Stage 3: take query containing longitude and latitude 
+* 
+* Stage 4: take query containing bottom left & top right longitude and
+* latitude of a rectangle
+*
+* Stage 5: take query containing longitude and latitude of a centre and a
+* radius in metres
+*
+* Stage 6: take query containing the longitude and latitude of each vertex
+* of a simple polygon
+*
+* Stage 7: take a rectangle query like stage 4 followed by the number of
+* records to skip, the maximum number of records to output(-1 for no limit)
+* and the order("spatial" or "id"), streaming out records as they are found
+*
+* Stage 8: take query containing a distance in metres, outputting every pair
+* of data points within it(in the tree, or between the tree and the dataset
+* given with --join)
+*
+* Stage 9: take query containing longitude, latitude and k, outputting the
+* records at the k nearest distinct locations, nearest first
+*
+* Stage 10: take GPS points containing a trace id, longitude and latitude,
+* outputting the nearest footpath segment to each point, the point snapped 
+* onto it and how far along it that is
+*
+* Stage 11: take a rectangle query like stage 4 followed by an attribute
+* (grade1in, distance or deltaz), "max" or "min" and k, outputting the k
+* records in the rectangle with the largest(or smallest) values of it
+*
+* Stage 12: take query containing the longitude and latitude of an origin
+* and a destination, outputting the footpaths of the shortest route between
+* them over the footpath network(steep footpaths cost more with --slope)
+*
+* Stage 13: take a rectangle query like stage 4 followed by a tolerance and
+* optionally a number of samples, outputting an estimate of the number of 
+* footpaths in the rectangle with a 95% confidence interval
+*
+* Stage 14: take query containing a rectangle like stage 4(optional) 
+* followed by column=value conditions on clue_sa, asset_type, segside, 
+* streetid or street_group, outputting the footpaths in the rectangle 
+* meeting all of them
+*
+* Stage 15: take a rectangle query like stage 4 followed by N, outputting 
+* at most N records in the rectangle spread over it(for a zoomed out map)
+*
+* Stage 16: take no queries, writing to the output file the number of 
+* footpaths & the sums of their distance and deltaz in every web map tile
+* over the area at zoom levels 10 to 18
+*
+* With --index=NAME stages 4 & 9 use the chosen index backend
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "recordTable.h"
+#include "footpathData.h"
+#include "quadTree.h"
+#include "point2D.h"
+#include "rectangle.h"
+#include "queryShape.h"
+#include "shardedIndex.h"
+#include "programOptions.h"
+#include "rangeCursor.h"
+#include "compressedQuadTree.h"
+#include "lazyQuadTree.h"
+#include "parallelBuild.h"
+#include "concurrentInsert.h"
+#include "distanceJoin.h"
+#include "batchRangeQuery.h"
+#include "mortonIndex.h"
+#include "spatialIndex.h"
+#include "queryPlanner.h"
+#include "diskQuadTree.h"
+#include "traceSnap.h"
+#include "topKQuery.h"
+#include "routeGraph.h"
+#include "parallelRangeQuery.h"
+#include "asyncWriter.h"
+#include "approxCount.h"
+#include "attributeIndex.h"
+#include "lodQuery.h"
+#include "tilePyramid.h"
+#include "compressedInput.h"
+#include "usefulConsts.h"
+
+#define DEBUG 0
+#define STAGE3 3
+#define STAGE4 4
+#define STAGE5 5
+#define STAGE6 6
+#define STAGE7 7
+#define STAGE8 8
+#define STAGE9 9
+#define STAGE10 10
+#define STAGE11 11
+#define STAGE12 12
+#define STAGE13 13
+#define STAGE14 14
+#define STAGE15 15
+#define STAGE16 16
+#define LARGEST_ORDER "max"
+#define SMALLEST_ORDER "min"
+#define TOP_K_FIELDS 7   // bounds, attribute, order & k
+#define MIN_TILE_ZOOM 10
+#define MAX_TILE_ZOOM 18
+#define KB 1024
+#define ASYNC_BUFFERS 4     // output buffers shared by the output file & stdout
+#define ASYNC_BUFFER_KB 1024
+#define ORDER_LEN 16
+#define STAGE_IDX 1
+#define INPUT_FILE 2
+#define OUTPUT_FILE 3
+#define BOT_LEFT_LON 4
+#define BOT_LEFT_LAT 5
+#define TOP_RIGHT_LON 6
+#define TOP_RIGHT_LAT 7
+#define FIRST_FLAG 8
+
+void stage_3_implementation(quadtree_t *quadtree, sharded_index_t *shards,
+                            morton_index_t *morton, FILE *output,
+                            FILE *summary);
+void stage_4_implementation(quadtree_t *quadtree, sharded_index_t *shards,
+                            range_pool_t *pool, FILE *output, FILE *summary);
+void stage_4_planned_implementation(query_planner_t *planner, FILE *output,
+                                    FILE *summary);
+void disk_stage_implementation(const char *file_name, int stage,
+                               program_options_t *options, FILE *output,
+                               FILE *summary);
+void stage_11_implementation(top_k_index_t *top_k, FILE *output, FILE *summary);
+void stage_12_implementation(route_graph_t *graph, FILE *output, FILE *summary);
+void stage_13_implementation(approx_counter_t *counter, FILE *output,
+                             FILE *summary);
+void stage_14_implementation(attribute_index_t *attributes, FILE *output,
+                             FILE *summary);
+void stage_15_implementation(lod_index_t *lod, FILE *output, FILE *summary);
+void stage_4_batch_implementation(quadtree_t *quadtree, int batch_size,
+                                  FILE *output, FILE *summary);
+void stage_5_implementation(quadtree_t *quadtree, FILE *output, FILE *summary);
+void stage_6_implementation(quadtree_t *quadtree, FILE *output, FILE *summary);
+void stage_7_implementation(quadtree_t *quadtree, FILE *output, FILE *summary);
+void stage_8_implementation(quadtree_t *quadtree, program_options_t *options,
+                            FILE *output, FILE *summary);
+void stage_9_implementation(spatial_index_t *index, record_table_t *records,
+                            FILE *output, FILE *summary);
+void index_range_implementation(spatial_index_t *index, 
+                                record_table_t *records, FILE *output,
+                                FILE *summary);
+quadtree_t *tree_load(record_table_t *records, point_t *bot_left,
+                      point_t *top_right, program_options_t *options);
+query_shape_t *polygon_query_read(char *query);
+void output_close(async_writer_t *writer, FILE *output, FILE *summary);
+
+
+int main(int argc, char *argv[]){
+    FILE *output_file = fopen(argv[OUTPUT_FILE],"w");
+    int stage = atoi(argv[STAGE_IDX]);
+    program_options_t options;
+    options_read(&options, argc, argv, FIRST_FLAG);
+    
+    // Create the empty quad tree
+    long double bot_left_lon, bot_left_lat, top_right_lon, top_right_lat;
+    sscanf(argv[BOT_LEFT_LON], "%LF", &bot_left_lon); 
+    sscanf(argv[BOT_LEFT_LAT], "%LF", &bot_left_lat);
+    sscanf(argv[TOP_RIGHT_LON], "%LF", &top_right_lon);
+    sscanf(argv[TOP_RIGHT_LAT], "%LF", &top_right_lat);
+    point_t *bot_left = point_creator(bot_left_lon, bot_left_lat);
+    point_t *top_right = point_creator(top_right_lon, top_right_lat);
+
+    if ((options.disk_file != NULL || options.open_disk_file != NULL) &&
+            stage != STAGE3 && stage != STAGE4){
+        fprintf(stderr, "The page file is only supported for stage 3 & 4\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Sharded mode: worker processes read the input and build the trees
+    if (options.num_shards > 1){
+        if (stage != STAGE3 && stage != STAGE4){
+            fprintf(stderr, "Sharding is only supported for stage 3 & 4\n");
+            exit(EXIT_FAILURE);
+        }
+        sharded_index_t *shards = sharded_index_create(argv[INPUT_FILE],
+            bot_left, top_right, options.num_shards);
+        if (stage == STAGE3){
+            stage_3_implementation(NULL, shards, NULL, output_file, stdout);
+        }else{
+            stage_4_implementation(NULL, shards, NULL, output_file, stdout);
+        }
+        sharded_index_free(shards);
+        fclose(output_file);
+        return 0;
+    }
+
+    // Output & what goes to stdout go through the writer's thread from here
+    async_writer_t *writer = NULL;
+    FILE *summary = stdout;
+    if (options.async_output){
+        writer = async_writer_create(ASYNC_BUFFERS, 
+                                     (size_t)ASYNC_BUFFER_KB * KB);
+        output_file = async_writer_open(writer, output_file, TRUE);
+        summary = async_writer_open(writer, stdout, FALSE);
+    }
+
+    // Page file of an earlier run: searched without reading the dataset
+    if (options.open_disk_file != NULL){
+        point_free(bot_left);
+        point_free(top_right);
+        disk_stage_implementation(options.open_disk_file, stage, &options,
+                                  output_file, summary);
+        output_close(writer, output_file, summary);
+        return 0;
+    }
+
+    FILE *input_file = compressed_input_open(argv[INPUT_FILE]);
+    assert(input_file != NULL);
+
+    // Skip the first line as headers don't contain data
+    char a = 'r';
+    while((a = fgetc(input_file)) != '\n'){}
+
+    // Out of core mode: stream the records into the page file & search it
+    if (options.disk_file != NULL){
+        disk_tree_build(input_file, bot_left, top_right, options.disk_file);
+        point_free(bot_left);
+        point_free(top_right);
+        fclose(input_file);
+        disk_stage_implementation(options.disk_file, stage, &options,
+                                  output_file, summary);
+        output_close(writer, output_file, summary);
+        return 0;
+    }
+
+    // Read the footpath data into the record table
+    record_table_t *records = options.compact ?
+        record_table_read_compact(input_file) : record_table_read(input_file);
+
+    /* Other index backends & k nearest neighbours go through the interface.
+    Point search stays with the quad tree, as it outputs the records of the
+    leaf the point falls in, which other indexes don't have */
+    if (stage == STAGE3 && strcmp(options.index_name, QUADTREE_INDEX) != 0){
+        fprintf(stderr, "Point search can only use the quad tree index\n");
+        exit(EXIT_FAILURE);
+    }
+    if (stage == STAGE9 || strcmp(options.index_name, QUADTREE_INDEX) != 0){
+        spatial_index_t *index = spatial_index_create(options.index_name,
+            records, bot_left, top_right);
+        if (index == NULL){
+            fprintf(stderr, "Unknown index: %s\n", options.index_name);
+            exit(EXIT_FAILURE);
+        }
+        if (stage == STAGE4){
+            index_range_implementation(index, records, output_file, summary);
+        }else if (stage == STAGE9){
+            stage_9_implementation(index, records, output_file, summary);
+        }else{
+            fprintf(stderr, "Only stages 4 & 9 can choose the index\n");
+            exit(EXIT_FAILURE);
+        }
+        spatial_index_free(index);
+        record_table_free(records);
+        fclose(input_file);
+        output_close(writer, output_file, summary);
+        return 0;
+    }
+
+    quadtree_t *quadtree = tree_load(records, bot_left, top_right, &options);
+
+    if (stage == STAGE3 && options.morton){
+        morton_index_t *morton = morton_index_create(quadtree);
+        stage_3_implementation(quadtree, NULL, morton, output_file, summary);
+        morton_index_free(morton);
+    }else if (stage == STAGE3){
+        stage_3_implementation(quadtree, NULL, NULL, output_file, summary);
+    }else if (stage == STAGE4 && options.planner){
+        query_planner_t *planner = planner_create(quadtree);
+        stage_4_planned_implementation(planner, output_file, summary);
+        planner_free(planner);
+    }else if (stage == STAGE4 && options.batch_size > 1){
+        stage_4_batch_implementation(quadtree, options.batch_size, 
+                                     output_file, summary);
+    }else if (stage == STAGE4 && options.num_threads > 1){
+        range_pool_t *pool = range_pool_create(quadtree, options.num_threads);
+        stage_4_implementation(quadtree, NULL, pool, output_file, summary);
+        range_pool_free(pool);
+    }else if (stage == STAGE4){
+        stage_4_implementation(quadtree, NULL, NULL, output_file, summary);
+    }else if (stage == STAGE5){
+        stage_5_implementation(quadtree, output_file, summary);
+    }else if (stage == STAGE6){
+        stage_6_implementation(quadtree, output_file, summary);
+    }else if (stage == STAGE7){
+        stage_7_implementation(quadtree, output_file, summary);
+    }else if (stage == STAGE8){
+        stage_8_implementation(quadtree, &options, output_file, summary);
+    }else if (stage == STAGE10){
+        snap_index_t *snap = snap_index_create(quadtree);
+        snap_traces(snap, stdin, output_file, summary, options.num_threads);
+        snap_index_free(snap);
+    }else if (stage == STAGE11){
+        top_k_index_t *top_k = top_k_index_create(quadtree);
+        stage_11_implementation(top_k, output_file, summary);
+        top_k_index_free(top_k);
+    }else if (stage == STAGE12){
+        route_graph_t *graph = route_graph_create(quadtree, 
+                                                  options.slope_penalty);
+        stage_12_implementation(graph, output_file, summary);
+        route_graph_free(graph);
+    }else if (stage == STAGE13){
+        approx_counter_t *counter = approx_counter_create(quadtree);
+        stage_13_implementation(counter, output_file, summary);
+        approx_counter_free(counter);
+    }else if (stage == STAGE14){
+        attribute_index_t *attributes = attribute_index_create(quadtree);
+        stage_14_implementation(attributes, output_file, summary);
+        attribute_index_free(attributes);
+    }else if (stage == STAGE15){
+        lod_index_t *lod = lod_index_create(quadtree);
+        stage_15_implementation(lod, output_file, summary);
+        lod_index_free(lod);
+    }else if (stage == STAGE16){
+        tile_pyramid_t *pyramid = tile_pyramid_build(quadtree, MIN_TILE_ZOOM,
+                                                     MAX_TILE_ZOOM,
+                                                     options.num_threads);
+        tile_pyramid_write(pyramid, output_file);
+        tile_pyramid_stats_print(pyramid, summary);
+        tile_pyramid_free(pyramid);
+    }
+
+    free_quad_tree(quadtree);
+    record_table_free(records);
+    
+
+    // Close the files after finishing 
+    fclose(input_file);
+    output_close(writer, output_file, summary);
+}
+
+
+/* Implementation of stage 3, querying the shards instead if there are any*/
+void stage_3_implementation(quadtree_t *quadtree, sharded_index_t *shards,
+                            morton_index_t *morton, FILE *output,
+                            FILE *summary){
+    
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input point query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        // Process query & perform search 
+        double query_lon, query_lat;
+        sscanf(query, "%lf %lf", &query_lon, &query_lat);
+        fprintf(summary, "%s -->", query);
+        point_t *query_point = point_creator(query_lon, query_lat);
+        if (shards != NULL){
+            sharded_point_query(shards, query_point, output, summary);
+        }else if (morton != NULL){
+            morton_point_query(morton, query_point, output, summary);
+        }else{
+            tree_query(quadtree, query_point, output, summary);
+        }
+        fprintf(summary, "\n");
+
+        point_free(query_point);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 4, querying the shards instead if there are any*/
+void stage_4_implementation(quadtree_t *quadtree, sharded_index_t *shards,
+                            range_pool_t *pool, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input point query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        
+        // Process query and perform search
+        double left, right, top, bot;
+        sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
+        point_t *bot_left = point_creator(left, bot);
+        point_t *top_right = point_creator(right, top);
+        rectangle_t *query_rectangle = rectangle_create(bot_left, top_right);
+        fprintf(summary, "%s -->", query);
+        if (shards != NULL){
+            sharded_range_query(shards, query_rectangle, output, summary);
+        }else if (pool != NULL){
+            tree_parallel_ranged_query(pool, query_rectangle, output,
+                                       summary);
+        }else{
+            tree_ranged_query(quadtree, query_rectangle, output, summary);
+        }
+        fprintf(summary, "\n");
+
+        rectangle_free(query_rectangle); 
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 4 letting the planner choose between the tree & a
+scan for each query*/
+void stage_4_planned_implementation(query_planner_t *planner, FILE *output,
+                                    FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input range query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        double left, right, top, bot;
+        sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
+        rectangle_t *query_rectangle = rectangle_create(
+            point_creator(left, bot), point_creator(right, top));
+        fprintf(summary, "%s --> ", query);
+        planner_ranged_query(planner, query_rectangle, output, summary);
+        fprintf(summary, "\n");
+
+        rectangle_free(query_rectangle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 3 or 4 searching the tree in the page file, with
+its statistics printed to stderr at the end*/
+void disk_stage_implementation(const char *file_name, int stage,
+                               program_options_t *options, FILE *output,
+                               FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+    disk_tree_t *disk = disk_tree_open(file_name, 
+                                       (size_t)options->pool_kb * KB);
+
+    /* Read input query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        if (stage == STAGE3){
+            double query_lon, query_lat;
+            sscanf(query, "%lf %lf", &query_lon, &query_lat);
+            point_t *query_point = point_creator(query_lon, query_lat);
+            disk_point_query(disk, query_point, output, summary);
+            point_free(query_point);
+        }else{
+            double left, right, top, bot;
+            sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
+            rectangle_t *query_rectangle = rectangle_create(
+                point_creator(left, bot), point_creator(right, top));
+            disk_ranged_query(disk, query_rectangle, output, summary);
+            rectangle_free(query_rectangle);
+        }
+        fprintf(summary, "\n");
+    }
+
+    disk_tree_stats_print(disk, stderr);
+    disk_tree_close(disk);
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 11*/
+void stage_11_implementation(top_k_index_t *top_k, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input top k query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        double left, right, top, bot;
+        char attribute_name[query_len + 1], order[query_len + 1];
+        int k = 0;
+        int num_read = sscanf(query, "%lf %lf %lf %lf %s %s %d", &left, &bot,
+                              &right, &top, attribute_name, order, &k);
+        if (num_read != TOP_K_FIELDS || k < 0){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+        int attribute = top_k_attribute(attribute_name);
+        int largest = strcmp(order, LARGEST_ORDER) == 0;
+        if (attribute == UNDEFINED || 
+                (!largest && strcmp(order, SMALLEST_ORDER) != 0)){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+
+        rectangle_t *query_rectangle = rectangle_create(
+            point_creator(left, bot), point_creator(right, top));
+        tree_top_k_query(top_k, query_rectangle, attribute, largest, k, 
+                         output, summary);
+        fprintf(summary, "\n");
+        rectangle_free(query_rectangle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 12*/
+void stage_12_implementation(route_graph_t *graph, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input route query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        long double origin_lon, origin_lat, dest_lon, dest_lat;
+        if (sscanf(query, "%Lf %Lf %Lf %Lf", &origin_lon, &origin_lat,
+                   &dest_lon, &dest_lat) != 4){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+        point_t *origin = point_creator(origin_lon, origin_lat);
+        point_t *destination = point_creator(dest_lon, dest_lat);
+        route_query(graph, origin, destination, output, summary);
+        fprintf(summary, "\n");
+        point_free(origin);
+        point_free(destination);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 13*/
+void stage_13_implementation(approx_counter_t *counter, FILE *output,
+                             FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input count query & perform estimate & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        double left, right, top, bot, tolerance;
+        int num_samples = 0;
+        int num_read = sscanf(query, "%lf %lf %lf %lf %lf %d", &left, &bot,
+                              &right, &top, &tolerance, &num_samples);
+        if (num_read < 5 || tolerance < 0 || num_samples < 0){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+
+        rectangle_t *query_rectangle = rectangle_create(
+            point_creator(left, bot), point_creator(right, top));
+        approx_range_count(counter, query_rectangle, tolerance, num_samples,
+                           output, summary);
+        fprintf(summary, "\n");
+        rectangle_free(query_rectangle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 14*/
+void stage_14_implementation(attribute_index_t *attributes, FILE *output,
+                             FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input attribute query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        // The rectangle is optional
+        double left, right, top, bot;
+        int num_chars = 0;
+        int has_rectangle = sscanf(query, "%lf %lf %lf %lf %n", &left, &bot,
+                                   &right, &top, &num_chars) == 4;
+        char *conditions = has_rectangle ? query + num_chars : query;
+
+        /* Split the conditions at each column=, a value going on until the 
+        next one(so it may have spaces) */
+        int column_ids[query_len + 1];
+        char *values[query_len + 1];
+        char value_text[query_len + 1];
+        int num_predicates = 0, text_len = 0, valid = TRUE;
+        char *token = strtok(conditions, " ");
+        while (token != NULL && valid){
+            char *equals = strchr(token, '=');
+            if (equals != NULL){
+                *equals = '\0';
+                column_ids[num_predicates] = attribute_column(token);
+                valid = column_ids[num_predicates] != UNDEFINED;
+                values[num_predicates++] = value_text + text_len;
+                token = equals + 1;
+            }else if (num_predicates == 0){
+                valid = FALSE;
+            }else if (values[num_predicates - 1][0] != '\0'){
+                value_text[text_len - 1] = ' ';
+            }else{
+                text_len--;
+            }
+            strcpy(value_text + text_len, token);
+            text_len += strlen(token) + 1;
+            token = strtok(NULL, " ");
+        }
+        if (!valid || num_predicates == 0){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+
+        rectangle_t *query_rectangle = NULL;
+        if (has_rectangle){
+            query_rectangle = rectangle_create(point_creator(left, bot), 
+                                               point_creator(right, top));
+        }
+        attribute_ranged_query(attributes, query_rectangle, column_ids, 
+                               values, num_predicates, output, summary);
+        fprintf(summary, "\n");
+        if (query_rectangle != NULL){
+            rectangle_free(query_rectangle);
+        }
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 15*/
+void stage_15_implementation(lod_index_t *lod, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input sampled range query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+        fprintf(summary, "%s -->", query);
+
+        double left, right, top, bot;
+        int max_records;
+        if (sscanf(query, "%lf %lf %lf %lf %d", &left, &bot, &right, &top,
+                   &max_records) != 5 || max_records < 0){
+            fprintf(summary, " invalid query\n");
+            continue;
+        }
+
+        rectangle_t *query_rectangle = rectangle_create(
+            point_creator(left, bot), point_creator(right, top));
+        lod_ranged_query(lod, query_rectangle, max_records, output, summary);
+        fprintf(summary, "\n");
+        rectangle_free(query_rectangle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 4 reading the queries in batches of batch_size, 
+each batch answered in one walk of the tree*/
+void stage_4_batch_implementation(quadtree_t *quadtree, int batch_size,
+                                  FILE *output, FILE *summary){
+    char **queries = malloc(sizeof(char*) * batch_size);
+    size_t *query_lens = malloc(sizeof(size_t) * batch_size);
+    rectangle_t **rectangles = malloc(sizeof(rectangle_t*) * batch_size);
+    matched_records_t **matches = malloc(sizeof(matched_records_t*) *
+                                         batch_size);
+    FILE **traces = malloc(sizeof(FILE*) * batch_size);
+    char **trace_texts = malloc(sizeof(char*) * batch_size);
+    size_t *trace_lens = malloc(sizeof(size_t) * batch_size);
+    assert(queries != NULL && query_lens != NULL && rectangles != NULL);
+    assert(matches != NULL && traces != NULL && trace_texts != NULL);
+    assert(trace_lens != NULL);
+    for (int i = 0; i < batch_size; i++){
+        queries[i] = NULL;
+        query_lens[i] = 0;
+    }
+
+    int num_queries;
+    do {
+        /* Read a batch of range queries */
+        num_queries = 0;
+        while (num_queries < batch_size && getline(&queries[num_queries], 
+                &query_lens[num_queries], stdin) != EOF){
+            char *query = queries[num_queries];
+            
+            // Get rid of newline char in query
+            sscanf(query, "%[^\n]", query);
+            double left, right, top, bot;
+            sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
+            rectangles[num_queries] = rectangle_create(
+                point_creator(left, bot), point_creator(right, top));
+            matches[num_queries] = record_struct_create(
+                get_records(quadtree));
+            trace_texts[num_queries] = NULL;
+            traces[num_queries] = open_memstream(&trace_texts[num_queries],
+                                                 &trace_lens[num_queries]);
+            assert(traces[num_queries] != NULL);
+            num_queries++;
+        }
+
+        // Search for the whole batch & output results in query order
+        tree_batch_ranged_query(quadtree, rectangles, num_queries, matches,
+                                traces);
+        for (int i = 0; i < num_queries; i++){
+            fprintf(output, "%s\n", queries[i]);
+            match_record_output(matches[i], output);
+            fclose(traces[i]);
+            fprintf(summary, "%s -->%s\n", queries[i], trace_texts[i]);
+
+            free(trace_texts[i]);
+            matched_record_struct_free(matches[i]);
+            rectangle_free(rectangles[i]);
+        }
+    } while (num_queries == batch_size);
+
+    for (int i = 0; i < batch_size; i++){
+        free(queries[i]);
+    }
+    free(queries);
+    free(query_lens);
+    free(rectangles);
+    free(matches);
+    free(traces);
+    free(trace_texts);
+    free(trace_lens);
+}
+
+
+/* Implementation of stage 5*/
+void stage_5_implementation(quadtree_t *quadtree, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input circle query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        // Process query and perform search
+        double lon, lat, radius;
+        sscanf(query, "%lf %lf %lf", &lon, &lat, &radius);
+        point_t *centre = point_creator(lon, lat);
+        query_shape_t *circle = circle_shape_create(centre, radius);
+        fprintf(summary, "%s -->", query);
+        tree_shape_query(quadtree, circle, output, summary);
+        fprintf(summary, "\n");
+
+        shape_free(circle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 6*/
+void stage_6_implementation(quadtree_t *quadtree, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input polygon query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        // Process query and perform search
+        query_shape_t *polygon = polygon_query_read(query);
+        fprintf(summary, "%s -->", query);
+        if (polygon != NULL){
+            tree_shape_query(quadtree, polygon, output, summary);
+            shape_free(polygon);
+        }
+        fprintf(summary, "\n");
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 7*/
+void stage_7_implementation(quadtree_t *quadtree, FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input paged range query & stream out the results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        // Process query, records are output as the cursor finds them
+        double left, right, top, bot;
+        int offset = 0, limit = NO_LIMIT;
+        char order_name[ORDER_LEN] = "id";
+        sscanf(query, "%lf %lf %lf %lf %d %d %15s", &left, &bot, &right,
+               &top, &offset, &limit, order_name);
+        int order = CURSOR_ID_ORDER;
+        if (strcmp(order_name, "spatial") == 0){
+            order = CURSOR_SPATIAL_ORDER;
+        }
+        point_t *bot_left = point_creator(left, bot);
+        point_t *top_right = point_creator(right, top);
+        rectangle_t *query_rectangle = rectangle_create(bot_left, top_right);
+        range_cursor_t *cursor = range_cursor_create(quadtree,
+            query_rectangle, order, offset, limit);
+        
+        int num_output = 0;
+        footpath_t *record;
+        while ((record = range_cursor_next(cursor)) != NULL){
+            data_print(record, output);
+            num_output++;
+        }
+        fprintf(summary, "%s --> %d\n", query, num_output);
+
+        range_cursor_free(cursor);
+        rectangle_free(query_rectangle); 
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 8*/
+void stage_8_implementation(quadtree_t *quadtree, program_options_t *options,
+                            FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    // Join with the other dataset if one is given, otherwise with itself
+    quadtree_t *other = quadtree;
+    record_table_t *other_records = NULL;
+    if (options->join_file != NULL){
+        FILE *join_file = compressed_input_open(options->join_file);
+        assert(join_file != NULL);
+        char a = 'r';
+        while((a = fgetc(join_file)) != '\n'){}
+        other_records = options->compact ? record_table_read_compact(
+            join_file) : record_table_read(join_file);
+        fclose(join_file);
+        point_t *bot_left = get_bottomleft(get_root_rectangle(quadtree));
+        point_t *top_right = get_topright(get_root_rectangle(quadtree));
+        other = tree_load(other_records,
+            point_creator(get_lon(bot_left), get_lat(bot_left)),
+            point_creator(get_lon(top_right), get_lat(top_right)), options);
+    }
+
+    /* Read input distance query & output the pairs within it */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        long double max_dist = 0;
+        sscanf(query, "%Lf", &max_dist);
+        long num_pairs = tree_distance_join(quadtree, other, max_dist,
+                                            options->num_threads, output);
+        fprintf(summary, "%s --> %ld\n", query, num_pairs);
+    }
+
+    if (other != quadtree){
+        free_quad_tree(other);
+        record_table_free(other_records);
+    }
+    free(query);
+    query = NULL;
+}
+
+
+/* Implementation of stage 9*/
+void stage_9_implementation(spatial_index_t *index, record_table_t *records,
+                            FILE *output, FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input nearest neighbour query & output the nearest records */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        double lon, lat;
+        int k = 1;
+        sscanf(query, "%lf %lf %d", &lon, &lat, &k);
+        point_t *query_point = point_creator(lon, lat);
+        knn_result_t *nearest = spatial_knn_query(index, query_point, k);
+        knn_result_output(nearest, records, output);
+
+        // Distances of the locations found to stdout
+        fprintf(summary, "%s -->", query);
+        for (int i = 0; i < knn_result_count(nearest); i++){
+            fprintf(summary, " %.2Lf", knn_result_distance(nearest, i));
+        }
+        fprintf(summary, "\n");
+
+        knn_result_free(nearest);
+        point_free(query_point);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Stage 4 through the index interface*/
+void index_range_implementation(spatial_index_t *index, 
+                                record_table_t *records, FILE *output,
+                                FILE *summary){
+    char *query = NULL;  // query inputs
+    size_t query_len = 0;
+
+    /* Read input range query & perform search & output results */
+    while (getline(&query, &query_len, stdin) != EOF){
+        
+        // Get rid of newline char in query
+        sscanf(query, "%[^\n]", query);
+        fprintf(output, "%s\n", query);
+
+        double left, right, top, bot;
+        sscanf(query, "%lf %lf %lf %lf", &left, &bot, &right, &top);
+        rectangle_t *query_rectangle = rectangle_create(
+            point_creator(left, bot), point_creator(right, top));
+        matched_records_t *matches = record_struct_create(records);
+        spatial_range_query(index, query_rectangle, matches);
+        match_record_output(matches, output);
+        fprintf(summary, "%s --> %d\n", query, matched_record_count(matches));
+
+        matched_record_struct_free(matches);
+        rectangle_free(query_rectangle);
+    }
+
+    free(query);
+    query = NULL;
+}
+
+
+/* Create the tree over the given area & add every record of the table to it,
+in the way chosen by the options */
+quadtree_t *tree_load(record_table_t *records, point_t *bot_left,
+                      point_t *top_right, program_options_t *options){
+    quadtree_t *quadtree;
+    if (options->compressed){
+        quadtree = tree_create_compressed(records, bot_left, top_right);
+    }else if (options->lazy){
+        quadtree = tree_create_lazy(records, bot_left, top_right);
+    }else{
+        quadtree = tree_create(records, bot_left, top_right);
+    }
+
+    // Add footpath records into quad tree
+    if (options->num_threads > 1 && !options->compressed && !options->lazy){
+        if (options->concurrent){
+            tree_build_concurrent(quadtree, options->num_threads);
+        }else{
+            tree_build_parallel(quadtree, options->num_threads);
+        }
+    }else{
+        int num_records = record_table_size(records);
+        for (record_id_t record = 0; record < num_records; record++){
+            add_record(quadtree, record);
+        }
+    }
+    return quadtree;
+}
+
+
+/* Close the output file & finish writing what goes to stdout through the
+writer(if any), exiting if either couldn't be written */
+void output_close(async_writer_t *writer, FILE *output, FILE *summary){
+    int failed = fclose(output) != 0;
+    if (writer != NULL){
+        failed = fclose(summary) != 0 || failed;
+        async_writer_free(writer);
+    }else{
+        failed = fflush(summary) != 0 || failed;
+    }
+    if (failed){
+        fprintf(stderr, "Can't write the output\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/* Read the polygon vertices(longitude latitude pairs) from the query. Returns 
+NULL if the query doesn't describe at least 3 vertices*/
+query_shape_t *polygon_query_read(char *query){
+    int max_size = 4;
+    int num_vertices = 0;
+    long double *lons = malloc(sizeof(long double) * max_size);
+    long double *lats = malloc(sizeof(long double) * max_size);
+    assert(lons != NULL && lats != NULL);
+
+    double lon, lat;
+    int num_read = 0;
+    while (sscanf(query, "%lf %lf%n", &lon, &lat, &num_read) == 2){
+        if (num_vertices == max_size){
+            max_size *= 2;
+            lons = realloc(lons, sizeof(long double) * max_size);
+            lats = realloc(lats, sizeof(long double) * max_size);
+            assert(lons != NULL && lats != NULL);
+        }
+        lons[num_vertices] = lon;
+        lats[num_vertices] = lat;
+        num_vertices++;
+        query += num_read;
+    }
+
+    if (num_vertices < 3){
+        free(lons);
+        free(lats);
+        return NULL;
+    }
+    return polygon_shape_create(lons, lats, num_vertices);
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+/* mortonIndex.c
+*
+* Created by Ke Liao
+*
+* This module keeps a hash table from the quadkey of each node(its depth and
+* the quadrants taken to reach it, packed 2 bits per level like a Morton 
+* code) to the node. A point query turns the point into its Morton code 
+* once, then binary searches over the depth for the deepest node on the 
+* point's path, rather than calling determine_quadrant at every level. The
+* directions printed come from the quadkey of the node found, so the output 
+* is the same as tree_query.
+*
+* The node found is checked to contain the point, and the tree is walked 
+* from the root as usual for the rare point on the edge of a cell that the 
+* integer code puts on the wrong side. Nodes deeper than MAX_KEY_DEPTH are 
+* reached by walking down from the deepest node in the table.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "mortonIndex.h"
+#include "usefulConsts.h"
+
+#define MAX_KEY_DEPTH 31     // levels that fit in a 64 bit key
+#define CELLS_PER_SIDE 2147483648.0L  // 2^MAX_KEY_DEPTH
+#define EMPTY_KEY 0
+
+/* 2 bit code of each quadrant in the Morton code: bit 1 set for the east 
+half, bit 0 for the north half */
+static const int quadrant_codes[] = {0, 1, 3, 2};   // SW NW NE SE
+static const int code_quadrants[] = {SW_QUADRANT, NW_QUADRANT, SE_QUADRANT,
+                                     NE_QUADRANT};
+
+/* The key is a 1 bit followed by the codes of the quadrants taken(the last 
+in the lowest bits), so its length gives the depth */
+typedef struct morton_entry{
+    uint64_t key;      // EMPTY_KEY if the slot is empty
+    quadtree_node_t *node;
+} morton_entry_t;
+
+struct morton_index{
+    quadtree_t *qtree;
+    morton_entry_t *table;
+    uint64_t mask;     // number of slots - 1
+    int max_depth;     // deepest node in the table
+};
+
+
+static int nodes_count(quadtree_node_t *node);
+static void nodes_add(morton_index_t *index, quadtree_node_t *node,
+                      uint64_t key, int depth);
+static uint64_t key_hash(uint64_t key);
+static morton_entry_t *entry_find(morton_index_t *index, uint64_t key);
+static uint64_t morton_code(morton_index_t *index, point_t *point);
+
+
+/* Build the quadkey table over the nodes of the tree. The tree shouldn't 
+be changed while the table is in use */
+morton_index_t *morton_index_create(quadtree_t *qtree){
+    assert(!qtree->compressed);
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+
+    morton_index_t *index = malloc(sizeof(*index));
+    assert(index != NULL);
+    index->qtree = qtree;
+    uint64_t num_slots = 1;
+    while (num_slots < (uint64_t)nodes_count(qtree->root) * 3 / 2){
+        num_slots *= 2;
+    }
+    index->table = malloc(sizeof(morton_entry_t) * num_slots);
+    assert(index->table != NULL);
+    for (uint64_t i = 0; i < num_slots; i++){
+        index->table[i].key = EMPTY_KEY;
+    }
+    index->mask = num_slots - 1;
+    index->max_depth = 0;
+    nodes_add(index, qtree->root, 1, 0);
+    return index;
+}
+
+
+/* Search the tree for the point query like tree_query, printing out 
+associated outputs to f & the directions taken to trace */
+void morton_point_query(morton_index_t *index, point_t *query, FILE *f,
+                        FILE *trace){
+    quadtree_node_t *root = index->qtree->root;
+    if (!in_rectangle(root->rectangle, query)){
+        return;
+    }
+
+    /* Binary search for the deepest node with the start of the point's code
+    as its quadkey, the nodes above it are always in the table too */
+    uint64_t code = morton_code(index, query);
+    quadtree_node_t *found = root;
+    uint64_t found_key = 1;
+    int found_depth = 0;
+    int low = 1, high = index->max_depth;
+    while (low <= high){
+        int depth = (low + high) / 2;
+        uint64_t key = (1ULL << (2 * depth)) | 
+                       (code >> (2 * (MAX_KEY_DEPTH - depth)));
+        morton_entry_t *entry = entry_find(index, key);
+        if (entry != NULL){
+            found = entry->node;
+            found_key = key;
+            found_depth = depth;
+            low = depth + 1;
+        }else{
+            high = depth - 1;
+        }
+    }
+
+    /* A point on the edge of a cell may be given the wrong quadrant by the 
+    integer code, so walk from the root if it took a wrong turn */
+    if (!in_rectangle(found->rectangle, query)){
+        tree_node_query(root, index->qtree->records, query, f, trace);
+        return;
+    }
+
+    // Directions to the node found, from its quadkey
+    for (int level = found_depth - 1; level >= 0; level--){
+        int quad_code = (found_key >> (2 * level)) & 3;
+        fprintf(trace, " %s", quadrant_names[code_quadrants[quad_code]]);
+    }
+
+    // The rest of the way(if any) is walked
+    tree_node_query(found, index->qtree->records, query, f, trace);
+}
+
+
+/* Free the table, the tree isn't touched */
+void morton_index_free(morton_index_t *index){
+    free(index->table);
+    free(index);
+}
+
+
+/* Count the nodes of the subtree */
+static int nodes_count(quadtree_node_t *node){
+    if (node == NULL){
+        return 0;
+    }
+    int count = 1;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        count += nodes_count(get_child(node, quad));
+    }
+    return count;
+}
+
+
+/* Add the node & its subtree down to MAX_KEY_DEPTH to the table */
+static void nodes_add(morton_index_t *index, quadtree_node_t *node,
+                      uint64_t key, int depth){
+    if (node == NULL || depth > MAX_KEY_DEPTH){
+        return;
+    }
+
+    uint64_t slot = key_hash(key) & index->mask;
+    while (index->table[slot].key != EMPTY_KEY){
+        slot = (slot + 1) & index->mask;
+    }
+    index->table[slot].key = key;
+    index->table[slot].node = node;
+    if (depth > index->max_depth){
+        index->max_depth = depth;
+    }
+
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        nodes_add(index, get_child(node, quad), 
+                  (key << 2) | quadrant_codes[quad], depth + 1);
+    }
+}
+
+
+/* Mix the bits of the key(splitmix64 finaliser) */
+static uint64_t key_hash(uint64_t key){
+    uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+
+/* Find the entry of the node with the key, or NULL */
+static morton_entry_t *entry_find(morton_index_t *index, uint64_t key){
+    uint64_t slot = key_hash(key) & index->mask;
+    while (index->table[slot].key != EMPTY_KEY){
+        morton_entry_t *entry = &index->table[slot];
+        if (entry->key == key){
+            return entry;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    return NULL;
+}
+
+
+/* Interleave the point's cell number along each side of the tree's area, 
+with the same edge rules as in_rectangle: a point on a vertical line goes 
+west of it, on a horizontal line north of it */
+static uint64_t morton_code(morton_index_t *index, point_t *point){
+    rectangle_t *root_rect = index->qtree->root->rectangle;
+    long double left = get_lon(get_bottomleft(root_rect));
+    long double bot = get_lat(get_bottomleft(root_rect));
+    long double width = get_lon(get_topright(root_rect)) - left;
+    long double height = get_lat(get_topright(root_rect)) - bot;
+
+    long double x_cell = ceill((get_lon(point) - left) / width * 
+                               CELLS_PER_SIDE) - 1;
+    long double y_cell = floorl((get_lat(point) - bot) / height * 
+                                CELLS_PER_SIDE);
+    uint64_t x = x_cell < 0 ? 0 : x_cell >= CELLS_PER_SIDE ? 
+                 CELLS_PER_SIDE - 1 : (uint64_t)x_cell;
+    uint64_t y = y_cell < 0 ? 0 : y_cell >= CELLS_PER_SIDE ? 
+                 CELLS_PER_SIDE - 1 : (uint64_t)y_cell;
+
+    uint64_t code = 0;
+    for (int bit = MAX_KEY_DEPTH - 1; bit >= 0; bit--){
+        code = (code << 2) | (((x >> bit) & 1) << 1) | ((y >> bit) & 1);
+    }
+    return code;
+}
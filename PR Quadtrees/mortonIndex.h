@@ -0,0 +1,12 @@
+#ifndef _MORTONINDEX_H_
+#define _MORTONINDEX_H_
+#include <stdio.h>
+#include "quadTree.h"
+
+typedef struct morton_index morton_index_t;
+
+morton_index_t *morton_index_create(quadtree_t *qtree);
+void morton_point_query(morton_index_t *index, point_t *query, FILE *f,
+                        FILE *trace);
+void morton_index_free(morton_index_t *index);
+#endif
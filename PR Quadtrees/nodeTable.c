@@ -0,0 +1,90 @@
+/* nodeTable.c
+*
+* Created by Ke Liao
+*
+* This module keeps a value of a given size for each node of a tree, in a
+* hash table beside the tree(open addressing on the node's address), so a
+* search can store what it needs about the nodes without making every 
+* node bigger.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "quadTree.h"
+#include "nodeTable.h"
+#include "usefulConsts.h"
+
+#define HASH_MULTIPLIER 11400714819323198485ull   // 2^64 / golden ratio
+#define HASH_SHIFT 20
+#define VALUE_ALIGN 16
+
+struct node_table{
+    size_t slot_size;     // node address, then the value VALUE_ALIGN in
+    size_t mask;          // number of slots - 1
+    char *slots;
+};
+
+static int node_count(quadtree_node_t *node);
+
+
+/* Create a table with room for every node under root */
+node_table_t *node_table_create(quadtree_node_t *root, size_t value_size){
+    node_table_t *table = malloc(sizeof(*table));
+    assert(table);
+
+    // At least twice as many slots as nodes
+    size_t num_slots = 1;
+    while (num_slots < 2 * (size_t)node_count(root)){
+        num_slots *= 2;
+    }
+    table->slot_size = VALUE_ALIGN + 
+        (value_size + VALUE_ALIGN - 1) / VALUE_ALIGN * VALUE_ALIGN;
+    table->mask = num_slots - 1;
+    table->slots = calloc(num_slots, table->slot_size);
+    assert(table->slots);
+    return table;
+}
+
+
+/* Number of nodes in the subtree */
+static int node_count(quadtree_node_t *node){
+    int count = 1;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL){
+            count += node_count(child);
+        }
+    }
+    return count;
+}
+
+
+/* Get the node's value, set to zero the first time. Nodes already in the
+table can be looked up by many threads at once */
+void *node_table_get(node_table_t *table, quadtree_node_t *node){
+    size_t slot = ((uintptr_t)node * HASH_MULTIPLIER) >> HASH_SHIFT & 
+                  table->mask;
+    while (TRUE){
+        char *entry = table->slots + slot * table->slot_size;
+        quadtree_node_t *owner;
+        memcpy(&owner, entry, sizeof(owner));
+        if (owner == node){
+            return entry + VALUE_ALIGN;
+        }
+        if (owner == NULL){
+            memcpy(entry, &node, sizeof(node));
+            return entry + VALUE_ALIGN;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+
+/* Free the table */
+void node_table_free(node_table_t *table){
+    free(table->slots);
+    free(table);
+}
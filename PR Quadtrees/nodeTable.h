@@ -0,0 +1,11 @@
+#ifndef _NODETABLE_H_
+#define _NODETABLE_H_
+#include <stddef.h>
+#include "quadTree.h"
+
+typedef struct node_table node_table_t;
+
+node_table_t *node_table_create(quadtree_node_t *root, size_t value_size);
+void *node_table_get(node_table_t *table, quadtree_node_t *node);
+void node_table_free(node_table_t *table);
+#endif
@@ -0,0 +1,314 @@
+/* parallelBuild.c
+*
+* Created by Ke Liao
+*
+* This module builds the quad tree from every record in its record table 
+* using several threads. The points are split between the quadrants a few
+* levels down(enough quadrants for every thread to have several), the 
+* subtree of each quadrant is built on its own by whichever thread is free,
+* and the subtrees are then joined up under the levels above. Points are 
+* inserted into each subtree in the same order as a sequential build, so 
+* the tree comes out identical to adding the records one by one.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "parallelBuild.h"
+#include "usefulConsts.h"
+
+#define TASKS_PER_THREAD 8  // quadrants per thread, to even out the work
+#define MAX_SPLIT_DEPTH 8
+
+// State shared by the threads of one build
+typedef struct parallel_build{
+    quadtree_t *qtree;
+    int num_threads;
+    int depth;         // level of the quadrants built separately
+    int num_tiles;     // 4^depth
+    rectangle_t **tile_rects;   // rectangle of each quadrant at that level
+    
+    // Point of each (record, point) pair and the quadrant it's in
+    int num_entries;
+    point_t **entry_points;
+    int *entry_tiles;   // UNDEFINED if outside the tree
+
+    // Pairs grouped by quadrant, keeping their order within a quadrant
+    int *tile_start;    // first pair of each quadrant in sorted_entries
+    int *sorted_entries;
+    quadtree_node_t **subtrees;
+
+    int next_task;      // next record chunk or quadrant to be taken
+} parallel_build_t;
+
+
+static void tile_rects_assign(parallel_build_t *build, rectangle_t *cell,
+                              int depth, int *next_tile);
+static void threads_run(parallel_build_t *build, void *(*work)(void *));
+static void *entries_locate(void *arg);
+static void *subtrees_build(void *arg);
+static quadtree_node_t *subtrees_join(parallel_build_t *build,
+                                      rectangle_t *cell, int first, int span);
+
+
+/* Add every record of the tree's record table to the tree, building the 
+quadrants below the top levels in parallel */
+void tree_build_parallel(quadtree_t *qtree, int num_threads){
+    assert(!qtree->compressed && !qtree->lazy);
+    assert(is_leaf_node(qtree->root) && qtree->root->dt_point == NULL);
+
+    parallel_build_t build;
+    build.qtree = qtree;
+    build.num_threads = num_threads;
+    build.depth = 0;
+    build.num_tiles = 1;
+    while (build.num_tiles < num_threads * TASKS_PER_THREAD &&
+            build.depth < MAX_SPLIT_DEPTH){
+        build.num_tiles *= 4;
+        build.depth++;
+    }
+    build.tile_rects = malloc(sizeof(rectangle_t*) * build.num_tiles);
+    assert(build.tile_rects != NULL);
+    int next_tile = 0;
+    tile_rects_assign(&build, qtree->root->rectangle, build.depth, &next_tile);
+
+    // Find the quadrant of every start & end point
+    build.num_entries = 2 * record_table_size(qtree->records);
+    build.entry_points = malloc(sizeof(point_t*) * (build.num_entries + 1));
+    build.entry_tiles = malloc(sizeof(int) * (build.num_entries + 1));
+    assert(build.entry_points != NULL && build.entry_tiles != NULL);
+    build.next_task = 0;
+    threads_run(&build, entries_locate);
+
+    // Group the pairs by quadrant(counting sort keeps the insert order)
+    build.tile_start = calloc(build.num_tiles + 1, sizeof(int));
+    build.sorted_entries = malloc(sizeof(int) * (build.num_entries + 1));
+    assert(build.tile_start != NULL && build.sorted_entries != NULL);
+    for (int i = 0; i < build.num_entries; i++){
+        if (build.entry_tiles[i] != UNDEFINED){
+            build.tile_start[build.entry_tiles[i] + 1]++;
+        }
+    }
+    for (int tile = 0; tile < build.num_tiles; tile++){
+        build.tile_start[tile + 1] += build.tile_start[tile];
+    }
+    int *fill = malloc(sizeof(int) * build.num_tiles);
+    assert(fill != NULL);
+    for (int tile = 0; tile < build.num_tiles; tile++){
+        fill[tile] = build.tile_start[tile];
+    }
+    for (int i = 0; i < build.num_entries; i++){
+        if (build.entry_tiles[i] != UNDEFINED){
+            build.sorted_entries[fill[build.entry_tiles[i]]++] = i;
+        }
+    }
+    free(fill);
+
+    // Build the subtree of each quadrant
+    build.subtrees = calloc(build.num_tiles, sizeof(quadtree_node_t*));
+    assert(build.subtrees != NULL);
+    build.next_task = 0;
+    threads_run(&build, subtrees_build);
+
+    // Join the subtrees under the top levels, reusing the existing root
+    quadtree_node_t *top = subtrees_join(&build, qtree->root->rectangle, 0,
+                                         build.num_tiles);
+    if (top != NULL){
+        quadtree_node_t *root = qtree->root;
+        root->dt_point = top->dt_point;
+        root->SW = top->SW;
+        root->NW = top->NW;
+        root->NE = top->NE;
+        root->SE = top->SE;
+        rectangle_free(top->rectangle);
+        free(top);
+    }
+
+    for (int tile = 0; tile < build.num_tiles; tile++){
+        rectangle_free(build.tile_rects[tile]);
+    }
+    free(build.tile_rects);
+    free(build.entry_points);
+    free(build.entry_tiles);
+    free(build.tile_start);
+    free(build.sorted_entries);
+    free(build.subtrees);
+}
+
+
+/* Work out the rectangles of the quadrants depth levels below the cell, in 
+the order the tree is explored */
+static void tile_rects_assign(parallel_build_t *build, rectangle_t *cell,
+                              int depth, int *next_tile){
+    if (depth == 0){
+        point_t *bot_left = get_bottomleft(cell);
+        point_t *top_right = get_topright(cell);
+        build->tile_rects[(*next_tile)++] = rectangle_create(
+            point_creator(get_lon(bot_left), get_lat(bot_left)),
+            point_creator(get_lon(top_right), get_lat(top_right)));
+        return;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        rectangle_t *quadrant = quadrant_assign(cell, quad);
+        tile_rects_assign(build, quadrant, depth - 1, next_tile);
+        rectangle_free(quadrant);
+    }
+}
+
+
+/* Run the work function on the build's threads and wait for them */
+static void threads_run(parallel_build_t *build, void *(*work)(void *)){
+    pthread_t *threads = malloc(sizeof(pthread_t) * build->num_threads);
+    assert(threads != NULL);
+    for (int i = 0; i < build->num_threads; i++){
+        int created = pthread_create(&threads[i], NULL, work, build);
+        assert(created == 0);
+    }
+    for (int i = 0; i < build->num_threads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+
+/* Thread body: create the points of chunks of records and find which 
+quadrant each is in */
+static void *entries_locate(void *arg){
+    parallel_build_t *build = arg;
+    int num_records = build->num_entries / 2;
+    int chunk = num_records / (build->num_threads * TASKS_PER_THREAD) + 1;
+    rectangle_t *root_rect = build->qtree->root->rectangle;
+    footpath_t *buffer = record_buffer_create();
+
+    while (TRUE){
+        int first = __atomic_fetch_add(&build->next_task, chunk,
+                                       __ATOMIC_RELAXED);
+        if (first >= num_records){
+            record_buffer_free(buffer);
+            return NULL;
+        }
+        int last = first + chunk < num_records ? first + chunk : num_records;
+        for (int record = first; record < last; record++){
+            footpath_t *footpath = record_table_get(build->qtree->records,
+                                                    record, buffer);
+            build->entry_points[2 * record] = get_start_point(footpath);
+            build->entry_points[2 * record + 1] = get_end_point(footpath);
+
+            for (int i = 2 * record; i <= 2 * record + 1; i++){
+                point_t *point = build->entry_points[i];
+                if (!in_rectangle(root_rect, point)){
+                    build->entry_tiles[i] = UNDEFINED;
+                    point_free(point);  // Never inserted
+                    continue;
+                }
+
+                // Follow the quadrants down to the split level
+                int tile = 0;
+                int span = build->num_tiles;
+                rectangle_t *cell = root_rect;
+                for (int level = 0; level < build->depth; level++){
+                    int quad = determine_quadrant(cell, point);
+                    span /= 4;
+                    tile += quad * span;
+                    rectangle_t *next_cell = quadrant_assign(cell, quad);
+                    if (cell != root_rect){
+                        rectangle_free(cell);
+                    }
+                    cell = next_cell;
+                }
+                if (cell != root_rect){
+                    rectangle_free(cell);
+                }
+                build->entry_tiles[i] = tile;
+            }
+        }
+    }
+}
+
+
+/* Thread body: build the subtrees of quadrants until none are left */
+static void *subtrees_build(void *arg){
+    parallel_build_t *build = arg;
+    record_table_t *table = build->qtree->records;
+
+    while (TRUE){
+        int tile = __atomic_fetch_add(&build->next_task, 1, __ATOMIC_RELAXED);
+        if (tile >= build->num_tiles){
+            return NULL;
+        }
+        int first = build->tile_start[tile];
+        int last = build->tile_start[tile + 1];
+        if (first == last){
+            continue;   // No points, no subtree
+        }
+
+        point_t *bot_left = get_bottomleft(build->tile_rects[tile]);
+        point_t *top_right = get_topright(build->tile_rects[tile]);
+        rectangle_t *rect = rectangle_create(
+            point_creator(get_lon(bot_left), get_lat(bot_left)),
+            point_creator(get_lon(top_right), get_lat(top_right)));
+        quadtree_node_t *subtree = tree_node_create(rect);
+        for (int i = first; i < last; i++){
+            int entry = build->sorted_entries[i];
+            insert_record(subtree, table, entry / 2,
+                          build->entry_points[entry]);
+        }
+        build->subtrees[tile] = subtree;
+    }
+}
+
+
+/* Join the subtrees of the quadrants first to first + span - 1 under a node
+over the cell, as the sequential build would have. Returns NULL if there are
+no points in the cell */
+static quadtree_node_t *subtrees_join(parallel_build_t *build,
+                                      rectangle_t *cell, int first, int span){
+    if (span == 1){
+        return build->subtrees[first];
+    }
+
+    quadtree_node_t *children[4];
+    int num_children = 0;
+    int last_child = UNDEFINED;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        rectangle_t *quadrant = quadrant_assign(cell, quad);
+        children[quad] = subtrees_join(build, quadrant, 
+                                       first + quad * span / 4, span / 4);
+        rectangle_free(quadrant);
+        if (children[quad] != NULL){
+            num_children++;
+            last_child = quad;
+        }
+    }
+    if (num_children == 0){
+        return NULL;
+    }
+
+    point_t *bot_left = get_bottomleft(cell);
+    point_t *top_right = get_topright(cell);
+    rectangle_t *rect = rectangle_create(
+        point_creator(get_lon(bot_left), get_lat(bot_left)),
+        point_creator(get_lon(top_right), get_lat(top_right)));
+    quadtree_node_t *node = tree_node_create(rect);
+
+    // A single point in the cell makes this node the leaf
+    quadtree_node_t *only_child = children[last_child];
+    if (num_children == 1 && is_leaf_node(only_child)){
+        node->dt_point = only_child->dt_point;
+        rectangle_free(only_child->rectangle);
+        free(only_child);
+        return node;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        set_child(node, quad, children[quad]);
+    }
+    return node;
+}
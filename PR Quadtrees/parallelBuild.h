@@ -0,0 +1,6 @@
+#ifndef _PARALLELBUILD_H_
+#define _PARALLELBUILD_H_
+#include "quadTree.h"
+
+void tree_build_parallel(quadtree_t *qtree, int num_threads);
+#endif
@@ -0,0 +1,386 @@
+/* parallelRangeQuery.c
+*
+* Created by Ke Liao
+*
+* This module answers a large range query on several threads. The calling
+* thread walks the top levels of the tree as range_query would, and each
+* overlapping subtree a few levels down becomes a task. The tasks are dealt
+* out in order to the threads of a pool(kept for every query), each taking
+* its own tasks first and stealing from the back of another's when it runs
+* out, so a thread given dense subtrees doesn't hold up the query.
+*
+* Each thread collects the records it finds in its own list & each task
+* writes the directions it takes to its own buffer. When all the tasks are
+* done the lists are merged(they're each sorted by footpath id) and the
+* directions are printed in the order of the walk, so the output is the
+* same as tree_ranged_query.
+*
+* Queries overlapping fewer than PARALLEL_MIN_NODES nodes(counted only up
+* to that many) or fewer than 2 subtrees are answered on the calling
+* thread, as handing them out would cost more than it saves.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "rectangle.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "compressedQuadTree.h"
+#include "lazyQuadTree.h"
+#include "parallelRangeQuery.h"
+#include "usefulConsts.h"
+
+#define TASKS_PER_THREAD 8  // subtrees per thread, to even out the work
+#define MAX_SPLIT_DEPTH 8
+#define PARALLEL_MIN_NODES 4096
+
+// Subtree searched by one thread, with the directions printed before it
+typedef struct {
+    quadtree_node_t *node;
+    char *prefix;
+    size_t prefix_len;
+    char *trace;
+    size_t trace_len;
+} range_task_t;
+
+// Tasks of a thread, taken from the front by it & from the back by others
+typedef struct {
+    pthread_mutex_t lock;
+    int front, back;
+    matched_records_t *records;
+} task_queue_t;
+
+struct range_pool{
+    quadtree_t *qtree;
+    int num_threads;
+    pthread_t *threads;
+    task_queue_t *queues;
+
+    // Current query, handed out when round changes
+    rectangle_t *query;
+    range_task_t *tasks;
+    int num_tasks, tasks_size;
+    int round;
+    int num_done;         // threads finished with this round
+    int shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t round_start, round_done;
+};
+
+// What a pool thread needs to know about itself
+typedef struct {
+    range_pool_t *pool;
+    int id;
+} pool_thread_t;
+
+static long overlap_count(quadtree_node_t *node, rectangle_t *query,
+                          long cap);
+static int frontier_count(quadtree_node_t *node, rectangle_t *query,
+                          int depth);
+static void tasks_create(range_pool_t *pool, quadtree_node_t *node,
+                         rectangle_t *query, int depth,
+                         matched_records_t *records, FILE **segment,
+                         char **segment_text, size_t *segment_len);
+static void *pool_run(void *arg);
+static int task_take(range_pool_t *pool, int id);
+
+
+/* Start num_threads threads for the queries of the tree */
+range_pool_t *range_pool_create(quadtree_t *qtree, int num_threads){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);   // threads search the tree at once
+    }
+    range_pool_t *pool = malloc(sizeof(*pool));
+    assert(pool != NULL);
+    pool->qtree = qtree;
+    pool->num_threads = num_threads;
+    pool->tasks_size = num_threads * TASKS_PER_THREAD;
+    pool->tasks = malloc(sizeof(range_task_t) * pool->tasks_size);
+    pool->queues = malloc(sizeof(task_queue_t) * num_threads);
+    pool->threads = malloc(sizeof(pthread_t) * num_threads);
+    assert(pool->tasks != NULL && pool->queues != NULL);
+    assert(pool->threads != NULL);
+    pool->num_tasks = 0;
+    pool->round = 0;
+    pool->num_done = 0;
+    pool->shutdown = FALSE;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->round_start, NULL);
+    pthread_cond_init(&pool->round_done, NULL);
+
+    for (int i = 0; i < num_threads; i++){
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+        pool->queues[i].front = pool->queues[i].back = 0;
+        pool->queues[i].records = NULL;
+        pool_thread_t *thread = malloc(sizeof(*thread));
+        assert(thread != NULL);
+        thread->pool = pool;
+        thread->id = i;
+        int created = pthread_create(&pool->threads[i], NULL, pool_run,
+                                     thread);
+        assert(created == 0);
+    }
+    return pool;
+}
+
+
+/* Number of nodes under node(itself included) a range query visits, those
+overlapping the query, counted only up to cap */
+static long overlap_count(quadtree_node_t *node, rectangle_t *query,
+                          long cap){
+    long count = 1;
+    if (is_leaf_node(node)){
+        return count;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT && count < cap; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL && rectangle_overlap(query, child->rectangle)){
+            count += overlap_count(child, query, cap - count);
+        }
+    }
+    return count;
+}
+
+
+/* Find all footpath records of the tree within the rectangular query and
+output them to f & the directions taken to trace, as tree_ranged_query */
+void tree_parallel_ranged_query(range_pool_t *pool, rectangle_t *query,
+                                FILE *f, FILE *trace){
+    quadtree_node_t *root = pool->qtree->root;
+    if (rectangle_overlap(query, root->rectangle) == FALSE){
+        return;
+    }
+    matched_records_t *records = record_struct_create(pool->qtree->records);
+
+    /* Go down until there are enough subtrees for the threads. Levels where
+    the query is still in one subtree(clustered data) don't count */
+    int depth = 0, num_subtrees = 0, num_splits = 0;
+    int large = overlap_count(root, query, PARALLEL_MIN_NODES) >=
+                PARALLEL_MIN_NODES;
+    if (large){
+        do {
+            depth++;
+            num_subtrees = frontier_count(root, query, depth);
+            num_splits += num_subtrees > 1;
+        } while (num_subtrees > 0 &&
+                 num_subtrees < pool->num_threads * TASKS_PER_THREAD &&
+                 num_splits < MAX_SPLIT_DEPTH);
+    }
+
+    // Small queries, or those in a single subtree, aren't worth handing out
+    if (!large || num_subtrees < 2){
+        range_query(root, query, records, trace);
+        match_record_output(records, f);
+        matched_record_struct_free(records);
+        return;
+    }
+
+    // Walk the top levels, cutting the directions at each task
+    if (num_subtrees > pool->tasks_size){
+        pool->tasks_size = num_subtrees;
+        pool->tasks = realloc(pool->tasks,
+                              sizeof(range_task_t) * pool->tasks_size);
+        assert(pool->tasks != NULL);
+    }
+    pool->num_tasks = 0;
+    char *segment_text = NULL;
+    size_t segment_len = 0;
+    FILE *segment = open_memstream(&segment_text, &segment_len);
+    assert(segment != NULL);
+    tasks_create(pool, root, query, depth, records, &segment, &segment_text,
+                 &segment_len);
+    fclose(segment);
+
+    // Deal out the tasks in order, a run of them to each thread
+    int num_threads = pool->num_threads;
+    matched_records_t **parts = malloc(sizeof(matched_records_t*) *
+                                       (num_threads + 1));
+    assert(parts != NULL);
+    for (int i = 0; i < num_threads; i++){
+        pool->queues[i].front = (long)pool->num_tasks * i / num_threads;
+        pool->queues[i].back = (long)pool->num_tasks * (i + 1) / num_threads;
+        pool->queues[i].records = record_struct_create(pool->qtree->records);
+        parts[i] = pool->queues[i].records;
+    }
+    parts[num_threads] = records;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->query = query;
+    pool->num_done = 0;
+    pool->round++;
+    pthread_cond_broadcast(&pool->round_start);
+    while (pool->num_done < num_threads){
+        pthread_cond_wait(&pool->round_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Directions in the order of the walk
+    for (int task = 0; task < pool->num_tasks; task++){
+        fwrite(pool->tasks[task].prefix, 1, pool->tasks[task].prefix_len,
+               trace);
+        fwrite(pool->tasks[task].trace, 1, pool->tasks[task].trace_len,
+               trace);
+        free(pool->tasks[task].prefix);
+        free(pool->tasks[task].trace);
+    }
+    fwrite(segment_text, 1, segment_len, trace);
+    free(segment_text);
+
+    matched_records_t *merged = record_struct_create(pool->qtree->records);
+    matched_records_merge(merged, parts, num_threads + 1);
+    match_record_output(merged, f);
+    matched_record_struct_free(merged);
+    for (int i = 0; i <= num_threads; i++){
+        matched_record_struct_free(parts[i]);
+    }
+    free(parts);
+}
+
+
+/* Count the subtrees depth levels below node that overlap the query */
+static int frontier_count(quadtree_node_t *node, rectangle_t *query,
+                          int depth){
+    if (is_leaf_node(node)){
+        return 0;
+    }
+    if (depth == 0){
+        return 1;
+    }
+    int count = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL && rectangle_overlap(query, child->rectangle)){
+            count += frontier_count(child, query, depth - 1);
+        }
+    }
+    return count;
+}
+
+
+/* Walk the levels above the tasks as range_query does, printing to the
+segment & making each overlapping subtree depth levels down a task. The
+directions so far go with the task, & a new segment is started after it */
+static void tasks_create(range_pool_t *pool, quadtree_node_t *node,
+                         rectangle_t *query, int depth,
+                         matched_records_t *records, FILE **segment,
+                         char **segment_text, size_t *segment_len){
+    if (is_leaf_node(node)){
+        range_query(node, query, records, *segment);
+        return;
+    }
+    if (depth == 0){
+        fclose(*segment);
+        range_task_t *task = &pool->tasks[pool->num_tasks++];
+        task->node = node;
+        task->prefix = *segment_text;
+        task->prefix_len = *segment_len;
+        *segment_text = NULL;
+        *segment_len = 0;
+        *segment = open_memstream(segment_text, segment_len);
+        assert(*segment != NULL);
+        return;
+    }
+
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+        if (rectangle_overlap(query, child->rectangle) == TRUE){
+            child_path_print(child, quad, *segment);
+            tasks_create(pool, child, query, depth - 1, records, segment,
+                         segment_text, segment_len);
+        }else if (child->skipped > 0){
+            skipped_levels_print(node, quad, query, NULL, *segment);
+        }
+    }
+}
+
+
+/* Thread body: search the subtrees of each query's tasks until the pool is
+freed */
+static void *pool_run(void *arg){
+    pool_thread_t *thread = arg;
+    range_pool_t *pool = thread->pool;
+    int id = thread->id;
+    free(thread);
+    int round = 0;
+
+    while (TRUE){
+        pthread_mutex_lock(&pool->lock);
+        while (pool->round == round && !pool->shutdown){
+            pthread_cond_wait(&pool->round_start, &pool->lock);
+        }
+        if (pool->shutdown){
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        round = pool->round;
+        pthread_mutex_unlock(&pool->lock);
+
+        int task_num;
+        while ((task_num = task_take(pool, id)) != UNDEFINED){
+            range_task_t *task = &pool->tasks[task_num];
+            task->trace = NULL;
+            task->trace_len = 0;
+            FILE *trace = open_memstream(&task->trace, &task->trace_len);
+            assert(trace != NULL);
+            range_query(task->node, pool->query, pool->queues[id].records,
+                        trace);
+            fclose(trace);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->num_done++;
+        pthread_cond_signal(&pool->round_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+/* Take the next of the thread's own tasks, or steal the last task of
+another thread. Returns UNDEFINED once every task is taken */
+static int task_take(range_pool_t *pool, int id){
+    task_queue_t *own = &pool->queues[id];
+    int task = UNDEFINED;
+    pthread_mutex_lock(&own->lock);
+    if (own->front < own->back){
+        task = own->front++;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    // No new tasks are made during a query, so empty queues stay empty
+    for (int i = 1; i < pool->num_threads && task == UNDEFINED; i++){
+        task_queue_t *victim = &pool->queues[(id + i) % pool->num_threads];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->front < victim->back){
+            task = --victim->back;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return task;
+}
+
+
+/* Stop the threads & free the pool(the tree is left alone)*/
+void range_pool_free(range_pool_t *pool){
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = TRUE;
+    pthread_cond_broadcast(&pool->round_start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_threads; i++){
+        pthread_join(pool->threads[i], NULL);
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->round_start);
+    pthread_cond_destroy(&pool->round_done);
+    free(pool->threads);
+    free(pool->queues);
+    free(pool->tasks);
+    free(pool);
+}
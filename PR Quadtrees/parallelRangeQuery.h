@@ -0,0 +1,13 @@
+#ifndef _PARALLELRANGEQUERY_H_
+#define _PARALLELRANGEQUERY_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+typedef struct range_pool range_pool_t;
+
+range_pool_t *range_pool_create(quadtree_t *qtree, int num_threads);
+void tree_parallel_ranged_query(range_pool_t *pool, rectangle_t *query,
+                                FILE *f, FILE *trace);
+void range_pool_free(range_pool_t *pool);
+#endif
@@ -1,84 +1,131 @@
-/* point2D.c
-*
-* Created by Ke Liao
-*
-* This module contains functions for construction of struct storing 
-* latitude and longitude of a point. This module also contain functions that
-* returns information about the point as well the comparison of two points.
-*
-*/
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include "point2D.h"
-#include "usefulConsts.h"
-
-struct point{
-    long double longitude; // Also known as x-val
-    long double latitude; // Also known as y_val
-};
-
-
-/* Create a pointer to a point with supplied longitude & latitude value*/
-point_t *point_creator(long double longitude,long double latitude){
-    point_t *new_point = malloc(sizeof(point_t));
-    assert(new_point != NULL);
-    new_point->longitude = longitude;
-    new_point->latitude = latitude;
-    return new_point;
-}
-
-
-/* Compare two point's logitude (x) */
-int point_X_cmp(point_t *point1, point_t *point2){
-    if ((point1->longitude) < (point2->longitude)){
-        return SMALLER_THAN;
-    }else if ((point1->longitude) == (point2->longitude)){
-        return EQUALS;
-    }else{
-        return GREATER_THAN;
-    } 
-}
-
-
-/* Compare two point's latitude(y) */
-int point_Y_cmp(point_t *point1, point_t *point2){
-    if ((point1->latitude) < (point2->latitude)){
-        return SMALLER_THAN;
-    }else if ((point1->longitude) == (point2->latitude)){
-        return EQUALS;
-    }else{
-        return GREATER_THAN;
-    } 
-}
-
-
-/* Check if two points are the same */
-int point_cmp(point_t *point1, point_t *point2){
-    if((point1->latitude) == (point2->latitude)){
-        if((point1->longitude) == (point2->longitude)){
-            return EQUALS;
-        }
-    }
-    return NOT_EQUALS;
-}
-
-
-/* Free the point*/
-void point_free(point_t *point){
-    assert(point != NULL);
-    free(point);
-}
-
-
-/* get logititude val of point */
-long double get_lon(point_t *point){
-    return point->longitude;
-}
-
-
-/* get latitude val of point */
-long double get_lat(point_t *point){
-    return point->latitude;
-}
\ No newline at end of file
+/* point2D.c
+*
+* Created by Ke Liao
+*
+* This module contains functions for construction of struct storing 
+* latitude and longitude of a point. This module also contain functions that
+* returns information about the point as well the comparison of two points.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "point2D.h"
+#include "usefulConsts.h"
+
+/* Kept as doubles, as the coordinates are read as doubles; half the size of
+long doubles for every point of the tree */
+struct point{
+    double longitude; // Also known as x-val
+    double latitude; // Also known as y_val
+};
+
+
+/* Create a pointer to a point with supplied longitude & latitude value(to 
+the nearest double)*/
+point_t *point_creator(long double longitude,long double latitude){
+    point_t *new_point = malloc(sizeof(point_t));
+    assert(new_point != NULL);
+    new_point->longitude = longitude;
+    new_point->latitude = latitude;
+    return new_point;
+}
+
+
+/* Compare two point's logitude (x) */
+int point_X_cmp(point_t *point1, point_t *point2){
+    if ((point1->longitude) < (point2->longitude)){
+        return SMALLER_THAN;
+    }else if ((point1->longitude) == (point2->longitude)){
+        return EQUALS;
+    }else{
+        return GREATER_THAN;
+    } 
+}
+
+
+/* Compare two point's latitude(y) */
+int point_Y_cmp(point_t *point1, point_t *point2){
+    if ((point1->latitude) < (point2->latitude)){
+        return SMALLER_THAN;
+    }else if ((point1->longitude) == (point2->latitude)){
+        return EQUALS;
+    }else{
+        return GREATER_THAN;
+    } 
+}
+
+
+/* Check if two points are the same */
+int point_cmp(point_t *point1, point_t *point2){
+    if((point1->latitude) == (point2->latitude)){
+        if((point1->longitude) == (point2->longitude)){
+            return EQUALS;
+        }
+    }
+    return NOT_EQUALS;
+}
+
+
+/* Free the point*/
+void point_free(point_t *point){
+    assert(point != NULL);
+    free(point);
+}
+
+
+/* get logititude val of point */
+long double get_lon(point_t *point){
+    return point->longitude;
+}
+
+
+/* get latitude val of point */
+long double get_lat(point_t *point){
+    return point->latitude;
+}
+
+/* Great circle distance between two points in metres (haversine formula) */
+long double haversine_distance(point_t *point1, point_t *point2){
+    return haversine_coords(point1->longitude, point1->latitude,
+                            point2->longitude, point2->latitude);
+}
+
+
+/* Great circle distance in metres between two longitude, latitude pairs */
+long double haversine_coords(long double lon1, long double lat1, 
+                             long double lon2, long double lat2){
+    lat1 = lat1 * DEG_TO_RAD;
+    lat2 = lat2 * DEG_TO_RAD;
+    long double dlat = lat2 - lat1;
+    long double dlon = (lon2 - lon1) * DEG_TO_RAD;
+    long double a = sinl(dlat/2) * sinl(dlat/2) +
+                    cosl(lat1) * cosl(lat2) * sinl(dlon/2) * sinl(dlon/2);
+    if (a > 1){
+        a = 1;  // Guard against rounding pushing asin out of domain
+    }
+    return 2 * EARTH_RADIUS * asinl(sqrtl(a));
+}
+
+
+/* Lower bound in metres on the distance between two points at least lon_gap
+& lat_gap degrees apart, neither further than max_abs_lat from the equator.
+The haversine formula with the cosine of the furthest latitude never 
+overestimates */
+long double haversine_lower_bound(long double lon_gap, long double lat_gap,
+                                  long double max_abs_lat){
+    if (lon_gap <= 0 && lat_gap <= 0){
+        return 0;
+    }
+    long double cos_lat = cosl(max_abs_lat * DEG_TO_RAD);
+    long double sin_dlat = sinl(lat_gap * DEG_TO_RAD / 2);
+    long double sin_dlon = sinl(lon_gap * DEG_TO_RAD / 2);
+    long double a = sin_dlat * sin_dlat + 
+                    cos_lat * cos_lat * sin_dlon * sin_dlon;
+    if (a > 1){
+        a = 1;
+    }
+    return 2 * EARTH_RADIUS * asinl(sqrtl(a));
+}
@@ -1,14 +1,22 @@
-#ifndef _POINT2D_H_
-#define _POINT2D_H_
-
-typedef struct point point_t;
-
-point_t *point_creator(long double longitude, long double latitude);
-void point_free(point_t *point);
-int point_X_cmp(point_t *point1, point_t *point2);
-int point_Y_cmp(point_t *point1, point_t *point2);
-int point_cmp(point_t *point1, point_t *point2);
-long double get_lon(point_t *point);
-long double get_lat(point_t *point);
-
+#ifndef _POINT2D_H_
+#define _POINT2D_H_
+
+#define EARTH_RADIUS 6371008.8L  // Mean earth radius in metres
+#define DEG_TO_RAD (3.14159265358979323846L / 180)
+
+typedef struct point point_t;
+
+point_t *point_creator(long double longitude, long double latitude);
+void point_free(point_t *point);
+int point_X_cmp(point_t *point1, point_t *point2);
+int point_Y_cmp(point_t *point1, point_t *point2);
+int point_cmp(point_t *point1, point_t *point2);
+long double get_lon(point_t *point);
+long double get_lat(point_t *point);
+long double haversine_distance(point_t *point1, point_t *point2);
+long double haversine_coords(long double lon1, long double lat1, 
+                             long double lon2, long double lat2);
+long double haversine_lower_bound(long double lon_gap, long double lat_gap,
+                                  long double max_abs_lat);
+
 #endif
\ No newline at end of file
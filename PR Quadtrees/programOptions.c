@@ -0,0 +1,176 @@
+/* programOptions.c
+*
+* Created by Ke Liao
+*
+* This module reads the optional flags(in the form --name=value) that may
+* follow the positional arguments of the program, and fills in defaults for
+* the flags not given.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "programOptions.h"
+#include "spatialIndex.h"
+#include "usefulConsts.h"
+
+#define SHARDS_FLAG "--shards="
+#define COMPRESSED_FLAG "--compressed"
+#define LAZY_FLAG "--lazy"
+#define THREADS_FLAG "--threads="
+#define CONCURRENT_FLAG "--concurrent"
+#define JOIN_FLAG "--join="
+#define BATCH_FLAG "--batch="
+#define MORTON_FLAG "--morton"
+#define PLANNER_FLAG "--planner"
+#define INDEX_FLAG "--index="
+#define DISK_FLAG "--disk="
+#define OPEN_DISK_FLAG "--open-disk="
+#define POOL_FLAG "--pool="
+#define SLOPE_FLAG "--slope="
+#define ASYNC_OUTPUT_FLAG "--async-output"
+#define COMPACT_FLAG "--compact"
+#define DEFAULT_POOL_KB 4096
+
+static const char *unsharded_flag(program_options_t *options);
+
+
+/* Read the flags from argv[first_flag] onwards into options. Exits on a flag
+which isn't recognised */
+void options_read(program_options_t *options, int argc, char *argv[],
+                  int first_flag){
+    
+    // Defaults
+    options->num_shards = 1;
+    options->compressed = FALSE;
+    options->lazy = FALSE;
+    options->num_threads = 1;
+    options->concurrent = FALSE;
+    options->join_file = NULL;
+    options->batch_size = 1;
+    options->morton = FALSE;
+    options->index_name = QUADTREE_INDEX;
+    options->planner = FALSE;
+    options->disk_file = NULL;
+    options->open_disk_file = NULL;
+    options->pool_kb = DEFAULT_POOL_KB;
+    options->slope_penalty = 0;
+    options->async_output = FALSE;
+    options->compact = FALSE;
+
+    for (int i = first_flag; i < argc; i++){
+        char *flag = argv[i];
+        if (strncmp(flag, SHARDS_FLAG, strlen(SHARDS_FLAG)) == 0){
+            options->num_shards = atoi(flag + strlen(SHARDS_FLAG));
+            if (options->num_shards < 1){
+                options->num_shards = 1;
+            }
+        }else if (strncmp(flag, THREADS_FLAG, strlen(THREADS_FLAG)) == 0){
+            options->num_threads = atoi(flag + strlen(THREADS_FLAG));
+            if (options->num_threads < 1){
+                options->num_threads = 1;
+            }
+        }else if (strcmp(flag, COMPRESSED_FLAG) == 0){
+            options->compressed = TRUE;
+        }else if (strcmp(flag, LAZY_FLAG) == 0){
+            options->lazy = TRUE;
+        }else if (strncmp(flag, INDEX_FLAG, strlen(INDEX_FLAG)) == 0){
+            options->index_name = flag + strlen(INDEX_FLAG);
+        }else if (strncmp(flag, DISK_FLAG, strlen(DISK_FLAG)) == 0){
+            options->disk_file = flag + strlen(DISK_FLAG);
+        }else if (strncmp(flag, OPEN_DISK_FLAG,
+                          strlen(OPEN_DISK_FLAG)) == 0){
+            options->open_disk_file = flag + strlen(OPEN_DISK_FLAG);
+        }else if (strncmp(flag, POOL_FLAG, strlen(POOL_FLAG)) == 0){
+            options->pool_kb = atoi(flag + strlen(POOL_FLAG));
+            if (options->pool_kb < 1){
+                options->pool_kb = 1;
+            }
+        }else if (strncmp(flag, SLOPE_FLAG, strlen(SLOPE_FLAG)) == 0){
+            options->slope_penalty = atof(flag + strlen(SLOPE_FLAG));
+            if (options->slope_penalty < 0){
+                options->slope_penalty = 0;
+            }
+        }else if (strcmp(flag, ASYNC_OUTPUT_FLAG) == 0){
+            options->async_output = TRUE;
+        }else if (strcmp(flag, COMPACT_FLAG) == 0){
+            options->compact = TRUE;
+        }else if (strcmp(flag, PLANNER_FLAG) == 0){
+            options->planner = TRUE;
+        }else if (strcmp(flag, MORTON_FLAG) == 0){
+            options->morton = TRUE;
+        }else if (strcmp(flag, CONCURRENT_FLAG) == 0){
+            options->concurrent = TRUE;
+        }else if (strncmp(flag, JOIN_FLAG, strlen(JOIN_FLAG)) == 0){
+            options->join_file = flag + strlen(JOIN_FLAG);
+        }else if (strncmp(flag, BATCH_FLAG, strlen(BATCH_FLAG)) == 0){
+            options->batch_size = atoi(flag + strlen(BATCH_FLAG));
+            if (options->batch_size < 1){
+                options->batch_size = 1;
+            }
+        }else{
+            fprintf(stderr, "Unknown flag: %s\n", flag);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (options->compressed && options->lazy){
+        fprintf(stderr, "%s and %s can't be used together\n",
+                COMPRESSED_FLAG, LAZY_FLAG);
+        exit(EXIT_FAILURE);
+    }
+    if (options->compressed && options->disk_file != NULL){
+        fprintf(stderr, "%s and %s can't be used together\n",
+                COMPRESSED_FLAG, DISK_FLAG);
+        exit(EXIT_FAILURE);
+    }
+    if (options->disk_file != NULL && options->open_disk_file != NULL){
+        fprintf(stderr, "%s and %s can't be used together\n",
+                DISK_FLAG, OPEN_DISK_FLAG);
+        exit(EXIT_FAILURE);
+    }
+    if (options->compressed && options->morton){
+        fprintf(stderr, "%s and %s can't be used together\n",
+                COMPRESSED_FLAG, MORTON_FLAG);
+        exit(EXIT_FAILURE);
+    }
+    const char *unsharded = unsharded_flag(options);
+    if (options->num_shards > 1 && unsharded != NULL){
+        fprintf(stderr, "%s and %s can't be used together\n",
+                SHARDS_FLAG, unsharded);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/* The first flag given that the shards' workers don't support(they build
+plain quad trees in memory & search them one query at a time), or NULL */
+static const char *unsharded_flag(program_options_t *options){
+    if (options->compressed){
+        return COMPRESSED_FLAG;
+    }else if (options->lazy){
+        return LAZY_FLAG;
+    }else if (options->compact){
+        return COMPACT_FLAG;
+    }else if (options->async_output){
+        return ASYNC_OUTPUT_FLAG;
+    }else if (options->planner){
+        return PLANNER_FLAG;
+    }else if (options->morton){
+        return MORTON_FLAG;
+    }else if (options->batch_size > 1){
+        return BATCH_FLAG;
+    }else if (options->num_threads > 1){
+        return THREADS_FLAG;
+    }else if (options->concurrent){
+        return CONCURRENT_FLAG;
+    }else if (options->disk_file != NULL){
+        return DISK_FLAG;
+    }else if (options->open_disk_file != NULL){
+        return OPEN_DISK_FLAG;
+    }else if (strcmp(options->index_name, QUADTREE_INDEX) != 0){
+        return INDEX_FLAG;
+    }
+    return NULL;
+}
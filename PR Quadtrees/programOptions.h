@@ -0,0 +1,26 @@
+#ifndef _PROGRAMOPTIONS_H_
+#define _PROGRAMOPTIONS_H_
+
+// Optional flags given after the positional arguments
+typedef struct program_options{
+    int num_shards;    // --shards=K, number of worker processes(1 = none)
+    int compressed;    // --compressed, collapse single child chains
+    int lazy;          // --lazy, build nodes when first searched
+    int num_threads;   // --threads=N, worker threads(1 = none)
+    int concurrent;    // --concurrent, threads insert into one shared tree
+    char *join_file;   // --join=FILE, dataset to join with(NULL = self)
+    int batch_size;    // --batch=N, range queries per tree walk(1 = none)
+    int morton;        // --morton, point queries through the quadkey table
+    char *index_name;  // --index=NAME, backend for stages 4 & 9
+    int planner;       // --planner, stage 4 picks tree or scan per query
+    char *disk_file;   // --disk=FILE, search the tree from this page file
+    char *open_disk_file; // --open-disk=FILE, page file of an earlier run
+    int pool_kb;       // --pool=KB, memory cap of the page file's buffers
+    double slope_penalty; // --slope=F, extra route cost of steep footpaths
+    int async_output;  // --async-output, write output on its own thread
+    int compact;       // --compact, keep the records packed in memory
+} program_options_t;
+
+void options_read(program_options_t *options, int argc, char *argv[],
+                  int first_flag);
+#endif
@@ -1,398 +1,619 @@
-/* quadTree.c
-*
-* Created by Ke Liao 
-*
-* This module contains functions which construct the quad tree from a set
-* of footpath records. In addition, this module also facilitates the searching
-* of the quad tree for records in the same area as the query point or
-* all records within the query rectangle. To facilitate the search of 
-* records within query rectangle, this module also contain struct for 
-* storage of matched records(sorted by footpath id)
-*
-*/
-
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include "rectangle.h"
-#include "footpathData.h"
-#include "quadTree.h"
-#include "usefulConsts.h"
-#include "dataPoint.h"
-
-
-// struct for storing matched records sorted by footpath id
-struct matched_records{
-    footpath_t **record_list;  
-    int num_ele;    // number of elements in array
-    int max_size;   // max array size
-};
-
-
-// Tree Node
-struct quadtree_node{
-    rectangle_t *rectangle;
-    data_point_t *dt_point;
-    quadtree_node_t *NW;
-    quadtree_node_t *NE;
-    quadtree_node_t *SW;
-    quadtree_node_t *SE;
-};
-
-
-// Quad Tree
-struct quadtree{
-    quadtree_node_t *root;
-};
-
-
-/* Create a new quad Tree over a defined bot_left & top_right points*/
-quadtree_t *tree_create(point_t *bot_left, point_t *top_right){
-    quadtree_t *new_tree;
-    new_tree = malloc(sizeof(*new_tree));
-    assert(new_tree != NULL);
-    rectangle_t *rectangle = rectangle_create(bot_left, top_right);
-    new_tree->root = tree_node_create(rectangle);
-    return new_tree;
-}
-
-
-/* Create a node with no data point over a defined rectangle*/
-quadtree_node_t *tree_node_create(rectangle_t *rectangle){
-    quadtree_node_t *new_node;
-    new_node = malloc(sizeof(*new_node));
-    assert(new_node != NULL);
-    new_node->dt_point = NULL;
-    new_node->rectangle = rectangle;
-    new_node->NW = new_node->NE = new_node->SW = new_node->SE = NULL;
-    return new_node;
-}
-
-
-/* Add a record to the tree */
-void add_record(quadtree_t *qtree, footpath_t *record){
-    
-    assert(qtree != NULL);
-    assert(qtree->root != NULL);
-
-    /* Insert record by its start point */
-    point_t *start_point = get_start_point(record);
-    insert_record(qtree->root, record, start_point);
-
-    // Do the same for end point
-    point_t *end_point = get_end_point(record);
-    insert_record(qtree->root, record, end_point);
-}
-
-/* Insert record to the appriate branch on the tree, recursively based on the 
- point attached */
-void insert_record(quadtree_node_t *node, footpath_t *record, point_t *point){
-    assert(node != NULL);
-    int is_leaf = is_leaf_node(node);
-    rectangle_t *curr_rectangle = node->rectangle;
-
-    // don't insert if not within rectangle
-    if (!in_rectangle(curr_rectangle, point)){
-        return;
-    }
-
-    // Insert data_point to node recursively
-    if(node->dt_point == NULL && is_leaf){
-        
-        // End point of recursion
-        data_point_t *dt_point = data_point_create(point);
-        record_dt_point_add(dt_point, record);
-        node->dt_point = dt_point;
-        
-    }else{ 
-    
-        /* For when the leaf node contains data point */ 
-        if (is_leaf){ 
-
-            point_t *node_point_loc = get_dt_point_loc(node->dt_point);
-            // Add record to the point if record contain the same point
-            if (point_cmp(node_point_loc, point) == EQUALS){
-                record_dt_point_add(node->dt_point, record);
-                point_free(point);  // No longer needed 
-                return;
-            }
-
-            // Pass the data point to another quadrant
-            int quadrant = determine_quadrant(curr_rectangle, node_point_loc);
-            data_point_to_quad(node, quadrant);
-            node->dt_point = NULL;  // This node is now an internal node
-        }
-
-        // Insert to lower branch
-        int record_quadrant = determine_quadrant(curr_rectangle, point);
-        record_to_quad(node, record, point, record_quadrant);
-    }
-}
-
-
-/* Insert record(rec) to quadrant quad(part of recursive insertion process) */
-void record_to_quad(quadtree_node_t *node, footpath_t *record,
-                    point_t *point, int quad) {
-    
-    rectangle_t *curr_rect = node->rectangle;
-
-    // Insert to appropriate quadrant(and create node if null)
-    if (quad == SW_QUADRANT){
-        if (node->SW == NULL){
-            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
-            node->SW = tree_node_create(new_quadrant);
-        }
-        insert_record(node->SW, record, point);
-    }else if (quad == NW_QUADRANT){
-        if (node->NW == NULL){
-            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
-            node->NW = tree_node_create(new_quadrant);
-        }
-        insert_record(node->NW, record, point);
-    }else if (quad == NE_QUADRANT){
-        if (node->NE == NULL){
-            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
-            node->NE = tree_node_create(new_quadrant);
-        }
-        insert_record(node->NE, record, point);
-    }else if (quad == SE_QUADRANT){
-        if (node->SE == NULL){
-            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
-            node->SE = tree_node_create(new_quadrant);
-        }
-        insert_record(node->SE, record, point);
-    }
-}
-
-
-/* Insert data_point on the leaf node to the quadrant specified. */
-void data_point_to_quad(quadtree_node_t *node, int quad){
-    
-    assert(is_leaf_node(node));
-    data_point_t *dt_point = node->dt_point;
-    rectangle_t *curr_rect = node->rectangle;
-    rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
-    
-    if (quad == SW_QUADRANT){
-        node->SW = tree_node_create(new_quadrant);
-        node->SW->dt_point = dt_point;
-    }else if(quad == NW_QUADRANT){
-        node->NW = tree_node_create(new_quadrant); 
-        node->NW->dt_point = dt_point;
-    }else if (quad == NE_QUADRANT){
-        node->NE = tree_node_create(new_quadrant);
-        node->NE->dt_point = dt_point;
-    }else if (quad == SE_QUADRANT){
-        node->SE = tree_node_create(new_quadrant);
-        node->SE->dt_point = dt_point;
-    }
-}
-
-
-/*Check if the node is a leaf node*/
-int is_leaf_node(quadtree_node_t *data_node){
-    int isleaf = TRUE;
-    if ((data_node->NE != NULL) || (data_node->NW != NULL)){
-        isleaf = FALSE;
-    }
-    if ((data_node->SE != NULL) || (data_node->SW != NULL)){
-        isleaf = FALSE;
-    }
-    return isleaf;
-}
-
-
-/* Search the tree for the point query, printing out associated outputs*/
-void tree_query(quadtree_t *tree, point_t *query, FILE *f){
-    tree_node_query(tree->root, query, f);
-}
-
-
-/* Look through tree nodes for the query, printing out associated outputs */
-void tree_node_query(quadtree_node_t *node, point_t *query, FILE *f){
-    
-    // Don't want to query null pointers
-    if (node == NULL){
-        return;
-    }
-    
-    // Query end if the point's not in range defined by the node's rectangle
-    rectangle_t *node_rectangle = node->rectangle;
-    if (!in_rectangle(node_rectangle, query)){
-        return;
-    }
-
-    // Point data only located in leaf nodes
-    if (is_leaf_node(node)){
-        assert(node->dt_point != NULL);   // Something is wrong if NULL
-        data_point_record_print(node->dt_point, f);
-        return;  // Query done
-    }
-
-    // Direct to the correct quadrant if internal node & print the direction
-    int query_quadrant = determine_quadrant(node_rectangle, query);
-    if (query_quadrant == SE_QUADRANT){
-        printf(" SE");
-        tree_node_query(node->SE, query, f);
-    }else if (query_quadrant == SW_QUADRANT){
-        printf(" SW");
-        tree_node_query(node->SW, query, f);
-    }else if (query_quadrant == NW_QUADRANT){
-        printf(" NW");
-        tree_node_query(node->NW, query, f);
-    }else{
-        printf(" NE");
-        tree_node_query(node->NE, query, f);
-    }
-}
-
-
-/* Find all foorpath records of the tree within rectangular area inputted and
-output required outputs to file and stdout */
-void tree_ranged_query(quadtree_t *quadtree, rectangle_t *query, FILE *f){
-    
-    // End query if query not within scope covered by the tree
-    int overlap = rectangle_overlap(query, quadtree->root->rectangle);
-    if (overlap == FALSE){
-        return;
-    }
-
-    matched_records_t *matched_records = record_struct_create();
-    range_query(quadtree->root, query, matched_records);
-    match_record_output(matched_records, f);
-    matched_record_struct_free(matched_records);
-}
-
-
-/* Check the nodes of tree for the footpath records in the query area, storing 
-matched records in the records and print out directions explored*/
-void range_query(quadtree_node_t *node, rectangle_t *query,
-                 matched_records_t *records) {
-    
-    int isleaf = is_leaf_node(node);
-    if (isleaf == TRUE){
-
-        // Check if the records are in the area of the query
-        point_t *dt_point_loc = get_dt_point_loc(node->dt_point);
-        if (in_rectangle(query, dt_point_loc) == FALSE){
-            return;
-        }
-
-        // Extract records from overlaping leaf nodes if within query's area
-        footpath_t **node_records = get_record_list(node->dt_point);
-        int num_records = get_num_stored(node->dt_point);
-        for (int i = 0; i < num_records; i++){
-            matched_record_insert(records, node_records[i]);
-        }
-    }else{
-
-        // Explore branches that overlap
-        if (node->SW != NULL){
-            if(rectangle_overlap(query, node->SW->rectangle) == TRUE){
-                printf(" SW");
-                range_query(node->SW, query, records);
-            }
-        }
-        if (node->NW != NULL){
-            if(rectangle_overlap(query, node->NW->rectangle) == TRUE){
-                printf(" NW");
-                range_query(node->NW, query, records);
-            }
-        }
-        if (node->NE != NULL){
-            if(rectangle_overlap(query, node->NE->rectangle) == TRUE){
-                printf(" NE");
-                range_query(node->NE, query, records);
-            }
-        }
-        if (node->SE != NULL){
-            if(rectangle_overlap(query, node->SE->rectangle) == TRUE){
-                printf(" SE");
-                range_query(node->SE, query, records);
-            }
-        }
-    }
-
-}
-
-
-/* Output to file records that are matched */
-void match_record_output(matched_records_t *records, FILE *output){
-    assert(records != NULL);
-
-    for (int i = 0; i < records->num_ele; i++){
-        footpath_t *record = (records->record_list)[i];
-        data_print(record, output);
-    }
-}
-
-
-/* Create the struct which contains array holding matched records*/
-matched_records_t *record_struct_create(){
-    matched_records_t *records;
-    records = malloc(sizeof(*records));
-    assert(records != NULL);
-    records->max_size = 1;
-    records->num_ele = 0;
-    records->record_list = malloc(sizeof(footpath_t*) * records->max_size);
-    assert(records->record_list != NULL);
-    return records;
-}
-
-
-/* Add the found record to the struct containing array of records */
-void matched_record_insert(matched_records_t *records, footpath_t *record){
-    
-    // Allocate space as required 
-    int num_ele = records->num_ele;
-    if (num_ele == records->max_size){
-        records->max_size *= 2;
-        records->record_list = realloc(records->record_list, 
-            sizeof(footpath_t*) * records->max_size);
-        assert(records->record_list != NULL);
-    }
-
-    int try_insert = sorted_record_add(records->record_list, record, num_ele);
-    if (try_insert == INSERT_SUCCESS){
-        records->num_ele += 1;
-    }
-    
-}
-
-
-/* Free the struct containing array for matched records */
-void matched_record_struct_free(matched_records_t *records){
-    free(records->record_list);  // Free records later
-    free(records);
-}
-
-
-/*Function for freeing the quad tree*/
-void free_quad_tree(quadtree_t *curr_quadtree){
-    free_tree_nodes(curr_quadtree->root);
-    free(curr_quadtree);
-}
-
-
-/* Function for freeing the tree nodes*/
-void free_tree_nodes(quadtree_node_t *tree_node){
-    assert(tree_node != NULL);
-    rectangle_free(tree_node->rectangle);
-    if (tree_node->dt_point != NULL){
-        data_point_free(tree_node->dt_point);
-    }
-    if (tree_node->NE != NULL){
-        free_tree_nodes(tree_node->NE);
-    }
-    if (tree_node->NW != NULL){
-        free_tree_nodes(tree_node->NW);
-    }
-    if (tree_node->SE != NULL){
-        free_tree_nodes(tree_node->SE);
-    }
-    if (tree_node->SW != NULL){
-        free_tree_nodes(tree_node->SW);
-    }
-    free(tree_node);
+/* quadTree.c
+*
+* Created by Ke Liao 
+*
+* This module contains functions which construct the quad tree from a set
+* of footpath records. In addition, this module also facilitates the searching
+* of the quad tree for records in the same area as the query point or
+* all records within the query rectangle. To facilitate the search of 
+* records within query rectangle, this module also contain struct for 
+* storage of matched records(sorted by footpath id)
+*
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "rectangle.h"
+#include "footpathData.h"
+#include "quadTree.h"
+#include "usefulConsts.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "queryShape.h"
+#include "quadTreeInternal.h"
+#include "compressedQuadTree.h"
+#include "lazyQuadTree.h"
+
+// Direction names indexed by quadrant number
+const char *quadrant_names[] = {"SW", "NW", "NE", "SE"};
+
+
+// struct for storing matched records sorted by footpath id
+struct matched_records{
+    record_table_t *table;   // table the records are from
+    record_id_t *record_list;  
+    int num_ele;    // number of elements in array
+    int max_size;   // max array size
+};
+
+
+/* Create a new quad Tree over a defined bot_left & top_right points, for 
+records of the record table*/
+quadtree_t *tree_create(record_table_t *records, point_t *bot_left,
+                        point_t *top_right){
+    quadtree_t *new_tree;
+    new_tree = malloc(sizeof(*new_tree));
+    assert(new_tree != NULL);
+    rectangle_t *rectangle = rectangle_create(bot_left, top_right);
+    new_tree->root = tree_node_create(rectangle);
+    new_tree->compressed = FALSE;
+    new_tree->lazy = FALSE;
+    new_tree->records = records;
+    return new_tree;
+}
+
+
+/* Create a node with no data point over a defined rectangle*/
+quadtree_node_t *tree_node_create(rectangle_t *rectangle){
+    quadtree_node_t *new_node;
+    new_node = malloc(sizeof(*new_node));
+    assert(new_node != NULL);
+    new_node->dt_point = NULL;
+    new_node->rectangle = rectangle;
+    new_node->NW = new_node->NE = new_node->SW = new_node->SE = NULL;
+    new_node->skip_path = NULL;
+    new_node->skipped = 0;
+    new_node->pending = NULL;
+    new_node->lock = FALSE;
+    return new_node;
+}
+
+
+/* Add a record to the tree */
+void add_record(quadtree_t *qtree, record_id_t record){
+    
+    assert(qtree != NULL);
+    assert(qtree->root != NULL);
+
+    /* Insert record by its start point */
+    footpath_t *buffer = record_buffer_create();
+    footpath_t *footpath = record_table_get(qtree->records, record, buffer);
+    point_t *start_point = get_start_point(footpath);
+    point_t *end_point = get_end_point(footpath);
+    record_buffer_free(buffer);
+    if (qtree->compressed){
+        compressed_insert(qtree, record, start_point);
+        compressed_insert(qtree, record, end_point);
+        return;
+    }else if (qtree->lazy){
+        lazy_insert(qtree, record, start_point);
+        lazy_insert(qtree, record, end_point);
+        return;
+    }
+    insert_record(qtree->root, qtree->records, record, start_point);
+
+    // Do the same for end point
+    insert_record(qtree->root, qtree->records, record, end_point);
+}
+
+/* Insert record to the appriate branch on the tree, recursively based on the 
+ point attached */
+void insert_record(quadtree_node_t *node, record_table_t *table,
+                   record_id_t record, point_t *point){
+    assert(node != NULL);
+    int is_leaf = is_leaf_node(node);
+    rectangle_t *curr_rectangle = node->rectangle;
+
+    // don't insert if not within rectangle
+    if (!in_rectangle(curr_rectangle, point)){
+        return;
+    }
+
+    // Insert data_point to node recursively
+    if(node->dt_point == NULL && is_leaf){
+        
+        // End point of recursion
+        data_point_t *dt_point = data_point_create(point);
+        record_dt_point_add(dt_point, table, record);
+        node->dt_point = dt_point;
+        
+    }else{ 
+    
+        /* For when the leaf node contains data point */ 
+        if (is_leaf){ 
+
+            point_t *node_point_loc = get_dt_point_loc(node->dt_point);
+            // Add record to the point if record contain the same point
+            if (point_cmp(node_point_loc, point) == EQUALS){
+                record_dt_point_add(node->dt_point, table, record);
+                point_free(point);  // No longer needed 
+                return;
+            }
+
+            // Pass the data point to another quadrant
+            int quadrant = determine_quadrant(curr_rectangle, node_point_loc);
+            data_point_to_quad(node, quadrant);
+            node->dt_point = NULL;  // This node is now an internal node
+        }
+
+        // Insert to lower branch
+        int record_quadrant = determine_quadrant(curr_rectangle, point);
+        record_to_quad(node, table, record, point, record_quadrant);
+    }
+}
+
+
+/* Insert record(rec) to quadrant quad(part of recursive insertion process) */
+void record_to_quad(quadtree_node_t *node, record_table_t *table,
+                    record_id_t record, point_t *point, int quad) {
+    
+    rectangle_t *curr_rect = node->rectangle;
+
+    // Insert to appropriate quadrant(and create node if null)
+    if (quad == SW_QUADRANT){
+        if (node->SW == NULL){
+            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
+            node->SW = tree_node_create(new_quadrant);
+        }
+        insert_record(node->SW, table, record, point);
+    }else if (quad == NW_QUADRANT){
+        if (node->NW == NULL){
+            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
+            node->NW = tree_node_create(new_quadrant);
+        }
+        insert_record(node->NW, table, record, point);
+    }else if (quad == NE_QUADRANT){
+        if (node->NE == NULL){
+            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
+            node->NE = tree_node_create(new_quadrant);
+        }
+        insert_record(node->NE, table, record, point);
+    }else if (quad == SE_QUADRANT){
+        if (node->SE == NULL){
+            rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
+            node->SE = tree_node_create(new_quadrant);
+        }
+        insert_record(node->SE, table, record, point);
+    }
+}
+
+
+/* Insert data_point on the leaf node to the quadrant specified. */
+void data_point_to_quad(quadtree_node_t *node, int quad){
+    
+    assert(is_leaf_node(node));
+    data_point_t *dt_point = node->dt_point;
+    rectangle_t *curr_rect = node->rectangle;
+    rectangle_t *new_quadrant = quadrant_assign(curr_rect, quad);
+    
+    if (quad == SW_QUADRANT){
+        node->SW = tree_node_create(new_quadrant);
+        node->SW->dt_point = dt_point;
+    }else if(quad == NW_QUADRANT){
+        node->NW = tree_node_create(new_quadrant); 
+        node->NW->dt_point = dt_point;
+    }else if (quad == NE_QUADRANT){
+        node->NE = tree_node_create(new_quadrant);
+        node->NE->dt_point = dt_point;
+    }else if (quad == SE_QUADRANT){
+        node->SE = tree_node_create(new_quadrant);
+        node->SE->dt_point = dt_point;
+    }
+}
+
+
+/*Check if the node is a leaf node. Nodes of a lazy tree are built the first
+time they are checked*/
+int is_leaf_node(quadtree_node_t *data_node){
+    if (data_node->pending != NULL){
+        node_expand(data_node);
+    }
+    int isleaf = TRUE;
+    if ((data_node->NE != NULL) || (data_node->NW != NULL)){
+        isleaf = FALSE;
+    }
+    if ((data_node->SE != NULL) || (data_node->SW != NULL)){
+        isleaf = FALSE;
+    }
+    return isleaf;
+}
+
+
+/* Search the tree for the point query, printing out associated outputs to f
+& the directions taken to trace*/
+void tree_query(quadtree_t *tree, point_t *query, FILE *f, FILE *trace){
+    tree_node_query(tree->root, tree->records, query, f, trace);
+}
+
+
+/* Look through tree nodes for the query, printing out associated outputs to
+f & the directions taken to trace */
+void tree_node_query(quadtree_node_t *node, record_table_t *table,
+                     point_t *query, FILE *f, FILE *trace){
+    
+    // Don't want to query null pointers
+    if (node == NULL){
+        return;
+    }
+    
+    // Query end if the point's not in range defined by the node's rectangle
+    rectangle_t *node_rectangle = node->rectangle;
+    if (!in_rectangle(node_rectangle, query)){
+        return;
+    }
+
+    // Point data only located in leaf nodes
+    if (is_leaf_node(node)){
+        assert(node->dt_point != NULL);   // Something is wrong if NULL
+        data_point_record_print(node->dt_point, table, f);
+        return;  // Query done
+    }
+
+    // Direct to the correct quadrant if internal node & print the direction
+    int query_quadrant = determine_quadrant(node_rectangle, query);
+    quadtree_node_t *child = get_child(node, query_quadrant);
+    fprintf(trace, " %s", quadrant_names[query_quadrant]);
+    if (child != NULL && child->skipped > 0){
+        
+        // Compressed child: follow the levels it skips first
+        if (!skipped_levels_query(node, query_quadrant, query, trace)){
+            return;
+        }
+    }
+    tree_node_query(child, table, query, f, trace);
+}
+
+
+/* Find all foorpath records of the tree within rectangular area inputted and
+output required outputs to file and directions explored to trace */
+void tree_ranged_query(quadtree_t *quadtree, rectangle_t *query, FILE *f,
+                       FILE *trace){
+    
+    // End query if query not within scope covered by the tree
+    int overlap = rectangle_overlap(query, quadtree->root->rectangle);
+    if (overlap == FALSE){
+        return;
+    }
+
+    matched_records_t *matched_records = 
+        record_struct_create(quadtree->records);
+    range_query(quadtree->root, query, matched_records, trace);
+    match_record_output(matched_records, f);
+    matched_record_struct_free(matched_records);
+}
+
+
+/* Check the nodes of tree for the footpath records in the query area, storing 
+matched records in the records and print out directions explored to trace
+(if not NULL)*/
+void range_query(quadtree_node_t *node, rectangle_t *query,
+                 matched_records_t *records, FILE *trace) {
+    
+    int isleaf = is_leaf_node(node);
+    if (isleaf == TRUE){
+
+        // Check if the records are in the area of the query
+        point_t *dt_point_loc = get_dt_point_loc(node->dt_point);
+        if (in_rectangle(query, dt_point_loc) == FALSE){
+            return;
+        }
+
+        // Extract records from overlaping leaf nodes if within query's area
+        record_id_t *node_records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+        for (int i = 0; i < num_records; i++){
+            matched_record_insert(records, node_records[i]);
+        }
+    }else{
+
+        // Explore branches that overlap, in the order SW, NW, NE, SE
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            if(rectangle_overlap(query, child->rectangle) == TRUE){
+                child_path_print(child, quad, trace);
+                range_query(child, query, records, trace);
+            }else if (child->skipped > 0){
+                skipped_levels_print(node, quad, query, NULL, trace);
+            }
+        }
+    }
+
+}
+
+
+/* Find all footpath records of the tree within the circle or polygon and 
+output required outputs to file and directions explored to trace */
+void tree_shape_query(quadtree_t *quadtree, query_shape_t *shape, FILE *f,
+                      FILE *trace){
+    
+    // End query if the shape misses the scope covered by the tree
+    int relation = shape_rectangle_relation(shape, quadtree->root->rectangle);
+    if (relation == SHAPE_DISJOINT){
+        return;
+    }
+
+    matched_records_t *matched_records = 
+        record_struct_create(quadtree->records);
+    shape_query(quadtree->root, shape, matched_records,
+                relation == SHAPE_CONTAINS, trace);
+    match_record_output(matched_records, f);
+    matched_record_struct_free(matched_records);
+}
+
+
+/* Check the nodes of tree for the footpath records inside the shape, storing 
+matched records in the records and print out directions explored to trace.
+Nodes whose rectangle is contained in the shape take all their records 
+without checking each point */
+void shape_query(quadtree_node_t *node, query_shape_t *shape,
+                 matched_records_t *records, int contained, FILE *trace){
+    
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL){
+            return;  // Tree is empty
+        }
+
+        // Check if the records are in the shape
+        point_t *dt_point_loc = get_dt_point_loc(node->dt_point);
+        if (!contained && in_shape(shape, dt_point_loc) == FALSE){
+            return;
+        }
+
+        record_id_t *node_records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+        for (int i = 0; i < num_records; i++){
+            matched_record_insert(records, node_records[i]);
+        }
+        return;
+    }
+
+    // Explore branches which the shape reaches, in the same order as range
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+
+        int relation = SHAPE_CONTAINS;
+        if (!contained){
+            relation = shape_rectangle_relation(shape, child->rectangle);
+        }
+        if (relation != SHAPE_DISJOINT){
+            child_path_print(child, quad, trace);
+            shape_query(child, shape, records, relation == SHAPE_CONTAINS,
+                        trace);
+        }else if (child->skipped > 0){
+            skipped_levels_print(node, quad, NULL, shape, trace);
+        }
+    }
+}
+
+
+/* Get the child node of the quadrant specified */
+quadtree_node_t *get_child(quadtree_node_t *node, int quad){
+    if (quad == SW_QUADRANT){
+        return node->SW;
+    }else if (quad == NW_QUADRANT){
+        return node->NW;
+    }else if (quad == NE_QUADRANT){
+        return node->NE;
+    }
+    return node->SE;
+}
+
+
+/* Set the child node of the quadrant specified */
+void set_child(quadtree_node_t *node, int quad, quadtree_node_t *child){
+    if (quad == SW_QUADRANT){
+        node->SW = child;
+    }else if (quad == NW_QUADRANT){
+        node->NW = child;
+    }else if (quad == NE_QUADRANT){
+        node->NE = child;
+    }else{
+        node->SE = child;
+    }
+}
+
+
+/* Get the root node of the tree */
+quadtree_node_t *get_root(quadtree_t *quadtree){
+    return quadtree->root;
+}
+
+
+/* Get the record table the tree's record ids refer to */
+record_table_t *get_records(quadtree_t *quadtree){
+    return quadtree->records;
+}
+
+
+/* Get the rectangle covered by the whole tree */
+rectangle_t *get_root_rectangle(quadtree_t *quadtree){
+    return quadtree->root->rectangle;
+}
+
+
+/* Count the data points stored under the node, stopping once cap is reached*/
+int tree_count_points(quadtree_node_t *node, int cap){
+    if (node == NULL){
+        return 0;
+    }
+    if (is_leaf_node(node)){
+        return node->dt_point != NULL;
+    }
+
+    int count = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT && count < cap; quad++){
+        count += tree_count_points(get_child(node, quad), cap - count);
+    }
+    return count;
+}
+
+
+/* Output to file records that are matched */
+void match_record_output(matched_records_t *records, FILE *output){
+    assert(records != NULL);
+
+    footpath_t *buffer = record_buffer_create();
+    for (int i = 0; i < records->num_ele; i++){
+        record_id_t record = (records->record_list)[i];
+        data_print(record_table_get(records->table, record, buffer), output);
+    }
+    record_buffer_free(buffer);
+}
+
+
+/* Create the struct which contains array holding matched records of the
+record table*/
+matched_records_t *record_struct_create(record_table_t *table){
+    matched_records_t *records;
+    records = malloc(sizeof(*records));
+    assert(records != NULL);
+    records->table = table;
+    records->max_size = 1;
+    records->num_ele = 0;
+    records->record_list = malloc(sizeof(record_id_t) * records->max_size);
+    assert(records->record_list != NULL);
+    return records;
+}
+
+
+/* Add the found record to the struct containing array of records */
+void matched_record_insert(matched_records_t *records, record_id_t record){
+    
+    // Allocate space as required 
+    int num_ele = records->num_ele;
+    if (num_ele == records->max_size){
+        records->max_size *= 2;
+        records->record_list = realloc(records->record_list, 
+            sizeof(record_id_t) * records->max_size);
+        assert(records->record_list != NULL);
+    }
+
+    int try_insert = sorted_record_add(records->table, records->record_list,
+                                       record, num_ele);
+    if (try_insert == INSERT_SUCCESS){
+        records->num_ele += 1;
+    }
+    
+}
+
+
+/* Add a record that sorts after(or with) every record already matched, as
+when the records are found in footpath id order */
+void matched_record_append(matched_records_t *records, record_id_t record){
+    int num_ele = records->num_ele;
+    if (num_ele > 0 && record_id_cmp(records->table, record, 
+            records->record_list[num_ele - 1]) == EQUALS){
+        return;
+    }
+    assert(num_ele == 0 || record_id_cmp(records->table, record, 
+        records->record_list[num_ele - 1]) == GREATER_THAN);
+
+    if (num_ele == records->max_size){
+        records->max_size *= 2;
+        records->record_list = realloc(records->record_list, 
+            sizeof(record_id_t) * records->max_size);
+        assert(records->record_list != NULL);
+    }
+    records->record_list[num_ele] = record;
+    records->num_ele += 1;
+}
+
+
+/* Add the records of each of the parts(each sorted by footpath id) in
+footpath id order, once each */
+void matched_records_merge(matched_records_t *records,
+                           matched_records_t **parts, int num_parts){
+    int *next = calloc(num_parts + 1, sizeof(int));
+    assert(next != NULL);
+    while (TRUE){
+        int first = UNDEFINED;
+        for (int i = 0; i < num_parts; i++){
+            if (next[i] == parts[i]->num_ele){
+                continue;
+            }
+            if (first == UNDEFINED || record_id_cmp(records->table,
+                    parts[i]->record_list[next[i]],
+                    parts[first]->record_list[next[first]]) == SMALLER_THAN){
+                first = i;
+            }
+        }
+        if (first == UNDEFINED){
+            break;
+        }
+        matched_record_append(records, parts[first]->record_list[next[first]]);
+        next[first]++;
+    }
+    free(next);
+}
+
+
+/* Get the number of matched records */
+int matched_record_count(matched_records_t *records){
+    return records->num_ele;
+}
+
+
+/* Get the matched record at index idx(records are sorted by footpath id),
+unpacked into the buffer if the table is compact */
+footpath_t *matched_record_get(matched_records_t *records, int idx,
+                               footpath_t *buffer){
+    assert(idx >= 0 && idx < records->num_ele);
+    return record_table_get(records->table, records->record_list[idx],
+                            buffer);
+}
+
+
+/* Get the id of the idx-th matched record(in footpath id order)*/
+record_id_t matched_record_id(matched_records_t *records, int idx){
+    assert(idx >= 0 && idx < records->num_ele);
+    return records->record_list[idx];
+}
+
+
+/* Free the struct containing array for matched records */
+void matched_record_struct_free(matched_records_t *records){
+    free(records->record_list);  // Free records later
+    free(records);
+}
+
+
+/*Function for freeing the quad tree*/
+void free_quad_tree(quadtree_t *curr_quadtree){
+    free_tree_nodes(curr_quadtree->root);
+    free(curr_quadtree);
+}
+
+
+/* Function for freeing the tree nodes*/
+void free_tree_nodes(quadtree_node_t *tree_node){
+    assert(tree_node != NULL);
+    rectangle_free(tree_node->rectangle);
+    free(tree_node->skip_path);
+    if (tree_node->pending != NULL){
+        pending_bucket_free(tree_node->pending);
+    }
+    if (tree_node->dt_point != NULL){
+        data_point_free(tree_node->dt_point);
+    }
+    if (tree_node->NE != NULL){
+        free_tree_nodes(tree_node->NE);
+    }
+    if (tree_node->NW != NULL){
+        free_tree_nodes(tree_node->NW);
+    }
+    if (tree_node->SE != NULL){
+        free_tree_nodes(tree_node->SE);
+    }
+    if (tree_node->SW != NULL){
+        free_tree_nodes(tree_node->SW);
+    }
+    free(tree_node);
 }
\ No newline at end of file
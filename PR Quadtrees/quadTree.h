@@ -1,29 +1,52 @@
-#ifndef _QUADTREECREATOR_H_
-#define _QUADTREECREATOR_H_
-#include "rectangle.h" 
-
-typedef struct quadtree_node quadtree_node_t;
-typedef struct quadtree quadtree_t;
-typedef struct matched_records matched_records_t;
-
-quadtree_t *tree_create(point_t *bot_left, point_t *top_right);
-quadtree_node_t *tree_node_create(rectangle_t *rectangle);
-void add_record(quadtree_t *qtree, footpath_t *record);
-void insert_record(quadtree_node_t *node, footpath_t *record, point_t *point);
-void record_to_quad(quadtree_node_t *node, footpath_t *record,
-                    point_t *point, int quad);
-void data_point_to_quad(quadtree_node_t *node, int quad);
-int is_leaf_node(quadtree_node_t *data_node);
-void tree_query(quadtree_t *tree, point_t *query, FILE *f);
-void tree_node_query(quadtree_node_t *node, point_t *query, FILE *f);
-void tree_ranged_query(quadtree_t *quadtree, rectangle_t *query, FILE *f);
-void range_query(quadtree_node_t *node, rectangle_t *query,
-                 matched_records_t *records);
-void match_record_output(matched_records_t *records, FILE *output);
-matched_records_t *record_struct_create();
-void matched_record_insert(matched_records_t *records, footpath_t *record);
-void matched_record_struct_free(matched_records_t *records);
-void free_quad_tree(quadtree_t *curr_quadtree);
-void free_tree_nodes(quadtree_node_t *tree_node);
-
+#ifndef _QUADTREECREATOR_H_
+#define _QUADTREECREATOR_H_
+#include "rectangle.h" 
+#include "queryShape.h"
+#include "recordTable.h"
+
+typedef struct quadtree_node quadtree_node_t;
+typedef struct quadtree quadtree_t;
+typedef struct matched_records matched_records_t;
+
+quadtree_t *tree_create(record_table_t *records, point_t *bot_left,
+                        point_t *top_right);
+quadtree_node_t *tree_node_create(rectangle_t *rectangle);
+void add_record(quadtree_t *qtree, record_id_t record);
+void insert_record(quadtree_node_t *node, record_table_t *table,
+                   record_id_t record, point_t *point);
+void record_to_quad(quadtree_node_t *node, record_table_t *table,
+                    record_id_t record, point_t *point, int quad);
+void data_point_to_quad(quadtree_node_t *node, int quad);
+int is_leaf_node(quadtree_node_t *data_node);
+void tree_query(quadtree_t *tree, point_t *query, FILE *f, FILE *trace);
+void tree_node_query(quadtree_node_t *node, record_table_t *table,
+                     point_t *query, FILE *f, FILE *trace);
+void tree_ranged_query(quadtree_t *quadtree, rectangle_t *query, FILE *f,
+                       FILE *trace);
+void range_query(quadtree_node_t *node, rectangle_t *query,
+                 matched_records_t *records, FILE *trace);
+void tree_shape_query(quadtree_t *quadtree, query_shape_t *shape, FILE *f,
+                      FILE *trace);
+void shape_query(quadtree_node_t *node, query_shape_t *shape,
+                 matched_records_t *records, int contained, FILE *trace);
+quadtree_node_t *get_child(quadtree_node_t *node, int quad);
+void set_child(quadtree_node_t *node, int quad, quadtree_node_t *child);
+quadtree_node_t *get_root(quadtree_t *quadtree);
+rectangle_t *get_root_rectangle(quadtree_t *quadtree);
+record_table_t *get_records(quadtree_t *quadtree);
+int tree_count_points(quadtree_node_t *node, int cap);
+void match_record_output(matched_records_t *records, FILE *output);
+matched_records_t *record_struct_create(record_table_t *table);
+void matched_record_insert(matched_records_t *records, record_id_t record);
+void matched_record_append(matched_records_t *records, record_id_t record);
+void matched_records_merge(matched_records_t *records,
+                           matched_records_t **parts, int num_parts);
+int matched_record_count(matched_records_t *records);
+footpath_t *matched_record_get(matched_records_t *records, int idx,
+                               footpath_t *buffer);
+record_id_t matched_record_id(matched_records_t *records, int idx);
+void matched_record_struct_free(matched_records_t *records);
+void free_quad_tree(quadtree_t *curr_quadtree);
+void free_tree_nodes(quadtree_node_t *tree_node);
+
 #endif
\ No newline at end of file
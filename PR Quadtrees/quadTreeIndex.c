@@ -0,0 +1,154 @@
+/* quadTreeIndex.c
+*
+* Created by Ke Liao
+*
+* This module is the PR quad tree backend of the spatial index interface. It
+* builds its own quad tree over the records and searches it without 
+* printing directions.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "spatialIndexInternal.h"
+#include "quadTreeIndex.h"
+#include "usefulConsts.h"
+
+// A child & the least distance from the query to its rectangle
+typedef struct child_bound{
+    quadtree_node_t *child;
+    long double bound;
+} child_bound_t;
+
+
+static void *quadtree_index_create(record_table_t *table, 
+                                   index_points_t *points, rectangle_t *area);
+static void quadtree_point_query(void *index, point_t *query,
+                                 matched_records_t *matches);
+static void quadtree_range_query(void *index, rectangle_t *query,
+                                 matched_records_t *matches);
+static void quadtree_knn_query(void *index, point_t *query, 
+                               knn_result_t *result);
+static void node_knn_query(quadtree_node_t *node, point_t *query,
+                           rectangle_t *query_rect, knn_result_t *result);
+static void quadtree_index_free(void *index);
+
+const index_backend_t quadtree_backend = {QUADTREE_INDEX, 
+    quadtree_index_create, quadtree_point_query, quadtree_range_query,
+    quadtree_knn_query, quadtree_index_free};
+
+
+/* Build a quad tree over the area holding every record of the table */
+static void *quadtree_index_create(record_table_t *table, 
+                                   index_points_t *points, rectangle_t *area){
+    point_t *bot_left = get_bottomleft(area);
+    point_t *top_right = get_topright(area);
+    quadtree_t *qtree = tree_create(table, 
+        point_creator(get_lon(bot_left), get_lat(bot_left)),
+        point_creator(get_lon(top_right), get_lat(top_right)));
+    int num_records = record_table_size(table);
+    for (record_id_t record = 0; record < num_records; record++){
+        add_record(qtree, record);
+    }
+    return qtree;
+}
+
+
+/* Walk down to the leaf the query is in, matching it if its point is the 
+query */
+static void quadtree_point_query(void *index, point_t *query,
+                                 matched_records_t *matches){
+    quadtree_t *qtree = index;
+    quadtree_node_t *node = qtree->root;
+    if (!in_rectangle(node->rectangle, query)){
+        return;
+    }
+    while (!is_leaf_node(node)){
+        node = get_child(node, determine_quadrant(node->rectangle, query));
+        if (node == NULL){
+            return;
+        }
+    }
+    if (node->dt_point != NULL && 
+            point_cmp(get_dt_point_loc(node->dt_point), query) == EQUALS){
+        record_id_t *records = get_record_list(node->dt_point);
+        for (int i = 0; i < get_num_stored(node->dt_point); i++){
+            matched_record_insert(matches, records[i]);
+        }
+    }
+}
+
+
+/* Range search of the tree, without the directions */
+static void quadtree_range_query(void *index, rectangle_t *query,
+                                 matched_records_t *matches){
+    quadtree_t *qtree = index;
+    if (rectangle_overlap(query, qtree->root->rectangle) && 
+            (!is_leaf_node(qtree->root) || qtree->root->dt_point != NULL)){
+        range_query(qtree->root, query, matches, NULL);
+    }
+}
+
+
+/* Search the tree for the nearest points, closest children first */
+static void quadtree_knn_query(void *index, point_t *query, 
+                               knn_result_t *result){
+    quadtree_t *qtree = index;
+    rectangle_t *query_rect = rectangle_create(
+        point_creator(get_lon(query), get_lat(query)),
+        point_creator(get_lon(query), get_lat(query)));
+    node_knn_query(qtree->root, query, query_rect, result);
+    rectangle_free(query_rect);
+}
+
+
+/* Offer the points under node to the result, skipping children further 
+away than the furthest of the k found so far */
+static void node_knn_query(quadtree_node_t *node, point_t *query,
+                           rectangle_t *query_rect, knn_result_t *result){
+    if (is_leaf_node(node)){
+        if (node->dt_point != NULL){
+            point_t *loc = get_dt_point_loc(node->dt_point);
+            knn_offer(result, haversine_distance(query, loc), get_lon(loc),
+                      get_lat(loc), get_record_list(node->dt_point),
+                      get_num_stored(node->dt_point));
+        }
+        return;
+    }
+
+    // Order the children by their distance, nearest first
+    child_bound_t children[4];
+    int num_children = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+        child_bound_t entry = {child, 
+            rectangle_min_distance(child->rectangle, query_rect)};
+        int i = num_children++;
+        while (i > 0 && children[i - 1].bound > entry.bound){
+            children[i] = children[i - 1];
+            i--;
+        }
+        children[i] = entry;
+    }
+    for (int i = 0; i < num_children; i++){
+        if (children[i].bound > knn_bound(result)){
+            return;
+        }
+        node_knn_query(children[i].child, query, query_rect, result);
+    }
+}
+
+
+/* Free the tree */
+static void quadtree_index_free(void *index){
+    free_quad_tree(index);
+}
@@ -0,0 +1,6 @@
+#ifndef _QUADTREEINDEX_H_
+#define _QUADTREEINDEX_H_
+#include "spatialIndexInternal.h"
+
+extern const index_backend_t quadtree_backend;
+#endif
@@ -0,0 +1,45 @@
+#ifndef _QUADTREEINTERNAL_H_
+#define _QUADTREEINTERNAL_H_
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "lazyQuadTree.h"
+
+/* Layout of the quad tree, shared by the modules that walk the tree 
+directly instead of through quadTree.h */
+
+// Tree Node
+struct quadtree_node{
+    rectangle_t *rectangle;
+    data_point_t *dt_point;
+    quadtree_node_t *NW;
+    quadtree_node_t *NE;
+    quadtree_node_t *SW;
+    quadtree_node_t *SE;
+
+    /* Compressed trees only: quadrants of the levels between the parent and
+    this node that were skipped as each had a single child */
+    char *skip_path;
+    int skipped;
+
+    // Lazy trees only: records waiting for this node to be built, or NULL
+    pending_bucket_t *pending;
+
+    // Concurrent insertion only: held while this leaf's point is changed
+    char lock;
+};
+
+
+// Quad Tree
+struct quadtree{
+    quadtree_node_t *root;
+    int compressed;   // TRUE if single child chains are collapsed
+    int lazy;         // TRUE if nodes are built when first searched
+    record_table_t *records;   // table the stored record ids refer to
+};
+
+// Direction names indexed by quadrant number
+extern const char *quadrant_names[];
+#endif
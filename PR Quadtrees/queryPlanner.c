@@ -0,0 +1,298 @@
+/* queryPlanner.c
+*
+* Created by Ke Liao
+*
+* This module chooses, for each range query, between walking the tree and
+* scanning a flat copy of the points. Walking the tree only visits the
+* nodes near the query so it wins for small areas, but each matched record
+* is then inserted into the sorted matches out of order. The scan reads
+* every point but in footpath id order, so each match is simply appended.
+*
+* The choice is made from an equi-depth histogram collected when the tree
+* is loaded: the points are split into columns holding the same number of
+* points by longitude, and each column into cells holding the same number
+* by latitude. The number of records in a query is estimated from the part
+* of each cell's bounding box the query covers.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "queryPlanner.h"
+#include "usefulConsts.h"
+
+#define HIST_COLUMNS 16
+#define HIST_ROWS 16
+
+/* Cost of walking down to a matched point, of comparing against one record
+already matched when inserting out of order & of testing one point in the
+scan(measured relative to each other on the example data)*/
+#define TREE_VISIT_COST 64.0
+#define INSERT_SHIFT_COST 4.0
+#define SCAN_POINT_COST 1.0
+
+const char *plan_names[] = {"tree", "scan"};
+
+// A point of a record inside the tree's area
+typedef struct {
+    int footpath_id;
+    record_id_t record;
+    double lon;
+    double lat;
+    double weight;
+} plan_point_t;
+
+// Bounding box of a cell's points & the records they stand for
+typedef struct {
+    double left, right, bot, top;
+    double weight;
+} hist_cell_t;
+
+struct query_planner{
+    quadtree_t *qtree;
+    record_table_t *table;
+
+    // Points in footpath id order, split by coordinate for the scan
+    int num_points;
+    double *lons;
+    double *lats;
+    record_id_t *records;
+
+    hist_cell_t cells[HIST_COLUMNS * HIST_ROWS];
+    int num_cells;
+};
+
+static int point_id_cmp(const void *a, const void *b);
+static int point_lon_cmp(const void *a, const void *b);
+static int point_lat_cmp(const void *a, const void *b);
+static void histogram_build(query_planner_t *planner, plan_point_t *points,
+                            int num_points);
+static double overlap_fraction(double low, double high, double query_low,
+                               double query_high);
+
+
+/* Collect the points of the tree's records & the histogram over them */
+query_planner_t *planner_create(quadtree_t *qtree){
+    query_planner_t *planner = malloc(sizeof(*planner));
+    assert(planner);
+    planner->qtree = qtree;
+    planner->table = get_records(qtree);
+    rectangle_t *area = get_root_rectangle(qtree);
+
+    /* Each record's points in the area, weighted so a record counts once
+    when all its points are in a query */
+    int num_records = record_table_size(planner->table);
+    plan_point_t *points = malloc(sizeof(*points) * (2 * num_records + 1));
+    assert(points);
+    int num_points = 0;
+    footpath_t *buffer = record_buffer_create();
+    for (record_id_t record = 0; record < num_records; record++){
+        footpath_t *footpath = record_table_get(planner->table, record,
+                                                buffer);
+        point_t *ends[2] = {get_start_point(footpath),
+                            get_end_point(footpath)};
+        int first = num_points;
+        for (int i = 0; i < 2; i++){
+            if (rectangle_contains(area, get_lon(ends[i]), get_lat(ends[i]))){
+                points[num_points].footpath_id = get_footpath_id(footpath);
+                points[num_points].record = record;
+                points[num_points].lon = get_lon(ends[i]);
+                points[num_points].lat = get_lat(ends[i]);
+                num_points++;
+            }
+            point_free(ends[i]);
+        }
+        for (int i = first; i < num_points; i++){
+            points[i].weight = 1.0 / (num_points - first);
+        }
+    }
+    record_buffer_free(buffer);
+
+    // Flat copy for the scan, in the order the matches are kept
+    qsort(points, num_points, sizeof(*points), point_id_cmp);
+    planner->num_points = num_points;
+    planner->lons = malloc(sizeof(double) * (num_points + 1));
+    planner->lats = malloc(sizeof(double) * (num_points + 1));
+    planner->records = malloc(sizeof(record_id_t) * (num_points + 1));
+    assert(planner->lons && planner->lats && planner->records);
+    for (int i = 0; i < num_points; i++){
+        planner->lons[i] = points[i].lon;
+        planner->lats[i] = points[i].lat;
+        planner->records[i] = points[i].record;
+    }
+
+    histogram_build(planner, points, num_points);
+    free(points);
+    return planner;
+}
+
+
+/* Split the points into equi-depth columns by longitude then each column
+into equi-depth cells by latitude */
+static void histogram_build(query_planner_t *planner, plan_point_t *points,
+                            int num_points){
+    planner->num_cells = 0;
+    qsort(points, num_points, sizeof(*points), point_lon_cmp);
+    for (int col = 0; col < HIST_COLUMNS; col++){
+        int col_start = (long)num_points * col / HIST_COLUMNS;
+        int col_end = (long)num_points * (col + 1) / HIST_COLUMNS;
+        int col_size = col_end - col_start;
+        qsort(points + col_start, col_size, sizeof(*points), point_lat_cmp);
+
+        for (int row = 0; row < HIST_ROWS; row++){
+            int start = col_start + (long)col_size * row / HIST_ROWS;
+            int end = col_start + (long)col_size * (row + 1) / HIST_ROWS;
+            if (start == end){
+                continue;
+            }
+            hist_cell_t *cell = &planner->cells[planner->num_cells++];
+            cell->left = cell->right = points[start].lon;
+            cell->bot = points[start].lat;
+            cell->top = points[end - 1].lat;
+            cell->weight = 0;
+            for (int i = start; i < end; i++){
+                if (points[i].lon < cell->left){
+                    cell->left = points[i].lon;
+                }else if (points[i].lon > cell->right){
+                    cell->right = points[i].lon;
+                }
+                cell->weight += points[i].weight;
+            }
+        }
+    }
+}
+
+
+/* Estimate the number of records with a point in the query, assuming the
+points are spread evenly over each cell's bounding box */
+double planner_estimate(query_planner_t *planner, rectangle_t *query){
+    double left = get_lon(get_bottomleft(query));
+    double right = get_lon(get_topright(query));
+    double bot = get_lat(get_bottomleft(query));
+    double top = get_lat(get_topright(query));
+
+    double estimate = 0;
+    for (int i = 0; i < planner->num_cells; i++){
+        hist_cell_t *cell = &planner->cells[i];
+        double fraction =
+            overlap_fraction(cell->left, cell->right, left, right) *
+            overlap_fraction(cell->bot, cell->top, bot, top);
+        estimate += cell->weight * fraction;
+    }
+    return estimate;
+}
+
+
+/* Part of [low, high] inside [query_low, query_high](all or nothing for a
+single value)*/
+static double overlap_fraction(double low, double high, double query_low,
+                               double query_high){
+    if (high < query_low || low > query_high){
+        return 0;
+    }
+    if (high == low){
+        return 1;
+    }
+    double covered_low = low > query_low ? low : query_low;
+    double covered_high = high < query_high ? high : query_high;
+    return (covered_high - covered_low) / (high - low);
+}
+
+
+/* Pick the cheaper plan for a query expected to match estimate records */
+int planner_choose(query_planner_t *planner, double estimate){
+    double tree_cost = estimate * (TREE_VISIT_COST +
+                                   estimate * INSERT_SHIFT_COST);
+    double scan_cost = planner->num_points * SCAN_POINT_COST;
+    return tree_cost <= scan_cost ? PLAN_TREE : PLAN_SCAN;
+}
+
+
+/* Answer the range query with the plan chosen, outputting the records to f
+& the plan with the estimated and actual number of records to stats.
+Returns the plan used */
+int planner_ranged_query(query_planner_t *planner, rectangle_t *query,
+                         FILE *f, FILE *stats){
+    double estimate = planner_estimate(planner, query);
+    int plan = planner_choose(planner, estimate);
+    matched_records_t *matches = record_struct_create(planner->table);
+
+    if (plan == PLAN_TREE){
+        rectangle_t *area = get_root_rectangle(planner->qtree);
+        if (rectangle_overlap(query, area)){
+            range_query(get_root(planner->qtree), query, matches, NULL);
+        }
+    }else{
+        double left = get_lon(get_bottomleft(query));
+        double right = get_lon(get_topright(query));
+        double bot = get_lat(get_bottomleft(query));
+        double top = get_lat(get_topright(query));
+
+        /* Same bounds as in_rectangle. Points come in footpath id order so
+        each match goes at the end */
+        double *lons = planner->lons;
+        double *lats = planner->lats;
+        for (int i = 0; i < planner->num_points; i++){
+            int inside = (lons[i] > left) & (lons[i] <= right) &
+                         (lats[i] >= bot) & (lats[i] < top);
+            if (inside){
+                matched_record_append(matches, planner->records[i]);
+            }
+        }
+    }
+
+    match_record_output(matches, f);
+    fprintf(stats, "%s (estimated %.0f, actual %d)", plan_names[plan],
+            estimate, matched_record_count(matches));
+    matched_record_struct_free(matches);
+    return plan;
+}
+
+
+/* Order points by footpath id, then record */
+static int point_id_cmp(const void *a, const void *b){
+    const plan_point_t *point1 = a, *point2 = b;
+    if (point1->footpath_id != point2->footpath_id){
+        return point1->footpath_id < point2->footpath_id ? SMALLER_THAN :
+                                                           GREATER_THAN;
+    }
+    if (point1->record != point2->record){
+        return point1->record < point2->record ? SMALLER_THAN : GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Order points by longitude */
+static int point_lon_cmp(const void *a, const void *b){
+    const plan_point_t *point1 = a, *point2 = b;
+    if (point1->lon != point2->lon){
+        return point1->lon < point2->lon ? SMALLER_THAN : GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Order points by latitude */
+static int point_lat_cmp(const void *a, const void *b){
+    const plan_point_t *point1 = a, *point2 = b;
+    if (point1->lat != point2->lat){
+        return point1->lat < point2->lat ? SMALLER_THAN : GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Free the planner(the tree is left alone) */
+void planner_free(query_planner_t *planner){
+    free(planner->lons);
+    free(planner->lats);
+    free(planner->records);
+    free(planner);
+}
@@ -0,0 +1,18 @@
+#ifndef _QUERYPLANNER_H_
+#define _QUERYPLANNER_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+#define PLAN_TREE 0
+#define PLAN_SCAN 1
+
+typedef struct query_planner query_planner_t;
+
+query_planner_t *planner_create(quadtree_t *qtree);
+double planner_estimate(query_planner_t *planner, rectangle_t *query);
+int planner_choose(query_planner_t *planner, double estimate);
+int planner_ranged_query(query_planner_t *planner, rectangle_t *query,
+                         FILE *f, FILE *stats);
+void planner_free(query_planner_t *planner);
+#endif
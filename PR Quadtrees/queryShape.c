@@ -0,0 +1,237 @@
+/* queryShape.c
+*
+* Created by Ke Liao
+*
+* This module contains functions for the construction of query shapes which
+* are not rectangles: circles(radius in metres around a centre point, using
+* haversine distance) and simple polygons(given by their vertices). Besides
+* testing whether a point is in the shape, this module also classifies a
+* rectangle as disjoint from, intersecting or fully contained in the shape,
+* which lets the quad tree prune or accept whole cells.
+*
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "queryShape.h"
+#include "usefulConsts.h"
+
+#define CIRCLE 0
+#define POLYGON 1
+#define CIRCLE_SLACK 1e-6L  // Relative slack on the cell/circle distance bounds
+
+// A circle or a simple polygon
+struct query_shape{
+    int type;
+    point_t *centre;   // circle only
+    long double radius;    // circle only, in metres
+    long double *lons;     // polygon only, vertex longitudes
+    long double *lats;     // polygon only, vertex latitudes
+    int num_vertices;
+    long double left, bot, right, top;  // bounding box of the shape
+};
+
+
+static int segment_hits_rectangle(long double x1, long double y1,
+                                  long double x2, long double y2,
+                                  long double left, long double bot,
+                                  long double right, long double top);
+static int in_polygon(query_shape_t *shape, long double lon, long double lat);
+
+
+/* Create a circle of radius(metres) around the centre point */
+query_shape_t *circle_shape_create(point_t *centre, long double radius){
+    query_shape_t *shape = malloc(sizeof(*shape));
+    assert(shape != NULL);
+    shape->type = CIRCLE;
+    shape->centre = centre;
+    shape->radius = radius;
+    shape->lons = shape->lats = NULL;
+    shape->num_vertices = 0;
+    shape->left = shape->right = get_lon(centre);
+    shape->bot = shape->top = get_lat(centre);
+    return shape;
+}
+
+
+/* Create a simple polygon from its vertices. The shape takes ownership of the
+vertex arrays*/
+query_shape_t *polygon_shape_create(long double *lons, long double *lats,
+                                    int num_vertices){
+    assert(num_vertices >= 3);
+    query_shape_t *shape = malloc(sizeof(*shape));
+    assert(shape != NULL);
+    shape->type = POLYGON;
+    shape->centre = NULL;
+    shape->radius = 0;
+    shape->lons = lons;
+    shape->lats = lats;
+    shape->num_vertices = num_vertices;
+
+    // Bounding box lets most cells be rejected without the edge tests
+    shape->left = shape->right = lons[0];
+    shape->bot = shape->top = lats[0];
+    for (int i = 1; i < num_vertices; i++){
+        if (lons[i] < shape->left) shape->left = lons[i];
+        if (lons[i] > shape->right) shape->right = lons[i];
+        if (lats[i] < shape->bot) shape->bot = lats[i];
+        if (lats[i] > shape->top) shape->top = lats[i];
+    }
+    return shape;
+}
+
+
+/* Check if the point is inside the shape */
+int in_shape(query_shape_t *shape, point_t *point){
+    if (shape->type == CIRCLE){
+        if (haversine_distance(shape->centre, point) <= shape->radius){
+            return TRUE;
+        }
+        return FALSE;
+    }
+    return in_polygon(shape, get_lon(point), get_lat(point));
+}
+
+
+/* Determine whether the rectangle is disjoint from, intersects or is fully 
+contained in the shape */
+int shape_rectangle_relation(query_shape_t *shape, rectangle_t *rectangle){
+    long double left = get_lon(get_bottomleft(rectangle));
+    long double bot = get_lat(get_bottomleft(rectangle));
+    long double right = get_lon(get_topright(rectangle));
+    long double top = get_lat(get_topright(rectangle));
+
+    if (shape->type == CIRCLE){
+        
+        /* Lower bound on the distance from the centre to any point of the
+        rectangle(from the gaps in degrees at the latitude furthest from 
+        the equator), since the point of the rectangle nearest in degrees 
+        isn't always the nearest on the sphere */
+        long double lon = get_lon(shape->centre);
+        long double lat = get_lat(shape->centre);
+        long double lon_gap = lon < left ? left - lon : 
+                              (lon > right ? lon - right : 0);
+        long double lat_gap = lat < bot ? bot - lat : 
+                              (lat > top ? lat - top : 0);
+        long double max_lat = fabsl(lat);
+        if (fabsl(bot) > max_lat){
+            max_lat = fabsl(bot);
+        }
+        if (fabsl(top) > max_lat){
+            max_lat = fabsl(top);
+        }
+        long double near_dist = haversine_lower_bound(lon_gap, lat_gap,
+                                                      max_lat);
+        if (near_dist > shape->radius * (1 + CIRCLE_SLACK)){
+            return SHAPE_DISJOINT;
+        }
+
+        // Rectangle is contained when all its corners are
+        long double corner_lons[] = {left, left, right, right};
+        long double corner_lats[] = {bot, top, top, bot};
+        for (int i = 0; i < 4; i++){
+            point_t *corner = point_creator(corner_lons[i], corner_lats[i]);
+            long double dist = haversine_distance(shape->centre, corner);
+            point_free(corner);
+            if (dist > shape->radius * (1 - CIRCLE_SLACK)){
+                return SHAPE_INTERSECTS;
+            }
+        }
+        return SHAPE_CONTAINS;
+    }
+
+    // Polygon: reject on bounding box first
+    if ((shape->top < bot) || (shape->bot > top)){
+        return SHAPE_DISJOINT;
+    }else if ((shape->right < left) || (shape->left > right)){
+        return SHAPE_DISJOINT;
+    }
+
+    // Any edge touching the rectangle means the boundary passes through it
+    int n = shape->num_vertices;
+    for (int i = 0, j = n - 1; i < n; j = i++){
+        if (segment_hits_rectangle(shape->lons[j], shape->lats[j],
+                shape->lons[i], shape->lats[i], left, bot, right, top)){
+            return SHAPE_INTERSECTS;
+        }
+    }
+
+    /* No edge crosses the rectangle, so the rectangle is either completely
+    inside or completely outside the polygon */
+    if (in_polygon(shape, left, bot)){
+        return SHAPE_CONTAINS;
+    }
+    return SHAPE_DISJOINT;
+}
+
+
+/* Free the shape */
+void shape_free(query_shape_t *shape){
+    assert(shape != NULL);
+    if (shape->centre != NULL){
+        point_free(shape->centre);
+    }
+    free(shape->lons);
+    free(shape->lats);
+    free(shape);
+}
+
+
+/* Even-odd ray casting test of the point against the polygon */
+static int in_polygon(query_shape_t *shape, long double lon, long double lat){
+    if ((lon < shape->left) || (lon > shape->right)){
+        return FALSE;
+    }else if ((lat < shape->bot) || (lat > shape->top)){
+        return FALSE;
+    }
+
+    int inside = FALSE;
+    long double *x = shape->lons;
+    long double *y = shape->lats;
+    int n = shape->num_vertices;
+    for (int i = 0, j = n - 1; i < n; j = i++){
+        if (((y[i] > lat) != (y[j] > lat)) &&
+            (lon < (x[j] - x[i]) * (lat - y[i]) / (y[j] - y[i]) + x[i])){
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+
+/* Check if the segment touches the closed rectangle(Liang-Barsky clipping) */
+static int segment_hits_rectangle(long double x1, long double y1,
+                                  long double x2, long double y2,
+                                  long double left, long double bot,
+                                  long double right, long double top){
+    long double dx = x2 - x1;
+    long double dy = y2 - y1;
+    long double p[] = {-dx, dx, -dy, dy};
+    long double q[] = {x1 - left, right - x1, y1 - bot, top - y1};
+    long double t_enter = 0;
+    long double t_exit = 1;
+
+    for (int i = 0; i < 4; i++){
+        if (p[i] == 0){
+            // Segment parallel to this side, and outside of it
+            if (q[i] < 0){
+                return FALSE;
+            }
+        }else{
+            long double t = q[i] / p[i];
+            if (p[i] < 0){
+                if (t > t_exit) return FALSE;
+                if (t > t_enter) t_enter = t;
+            }else{
+                if (t < t_enter) return FALSE;
+                if (t < t_exit) t_exit = t;
+            }
+        }
+    }
+    return TRUE;
+}
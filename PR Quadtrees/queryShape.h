@@ -0,0 +1,19 @@
+#ifndef _QUERYSHAPE_H_
+#define _QUERYSHAPE_H_
+#include "point2D.h"
+#include "rectangle.h"
+
+// Relation of a shape to a rectangle
+#define SHAPE_DISJOINT 0
+#define SHAPE_INTERSECTS 1
+#define SHAPE_CONTAINS 2
+
+typedef struct query_shape query_shape_t;
+
+query_shape_t *circle_shape_create(point_t *centre, long double radius);
+query_shape_t *polygon_shape_create(long double *lons, long double *lats,
+                                    int num_vertices);
+int in_shape(query_shape_t *shape, point_t *point);
+int shape_rectangle_relation(query_shape_t *shape, rectangle_t *rectangle);
+void shape_free(query_shape_t *shape);
+#endif
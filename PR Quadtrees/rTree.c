@@ -0,0 +1,371 @@
+/* rTree.c
+*
+* Created by Ke Liao
+*
+* This module is the R-tree backend of the spatial index interface. The tree
+* is bulk loaded with Sort-Tile-Recursive packing: the entries are sorted by
+* longitude and cut into vertical slices, each slice is sorted by latitude 
+* and cut into nodes of NODE_CAPACITY entries, and the same is done with 
+* the nodes until a single root is left. Nodes of a level are stored in one 
+* array, with the children of a node next to each other in the level below,
+* so the tree adapts to clustered data without any pointers.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "quadTree.h"
+#include "spatialIndexInternal.h"
+#include "rTree.h"
+#include "usefulConsts.h"
+
+#define NODE_CAPACITY 16
+
+// Bounding box of a node & where its children are in the level below
+typedef struct rtree_node{
+    long double left;
+    long double bot;
+    long double right;
+    long double top;
+    int first_child;   // into the level below, or into order for leaves
+    int num_children;
+} rtree_node_t;
+
+typedef struct rtree{
+    index_points_t *points;
+    int *order;            // points in the order of the leaves
+    rtree_node_t **levels; // levels[0] are the leaves
+    int *level_sizes;
+    int num_levels;
+} rtree_t;
+
+// An entry being packed: its centre & what it is
+typedef struct pack_entry{
+    long double x;
+    long double y;
+    int idx;
+} pack_entry_t;
+
+
+static void *rtree_create(record_table_t *table, index_points_t *points,
+                          rectangle_t *area);
+static void str_sort(pack_entry_t *entries, int num_entries);
+static int pack_x_cmp(const void *entry1, const void *entry2);
+static int pack_y_cmp(const void *entry1, const void *entry2);
+static void rtree_point_query(void *index, point_t *query,
+                              matched_records_t *matches);
+static void node_point_query(rtree_t *rtree, int level, int node, 
+                             point_t *query, matched_records_t *matches);
+static void rtree_range_query(void *index, rectangle_t *query,
+                              matched_records_t *matches);
+static void node_range_query(rtree_t *rtree, int level, int node,
+                             rectangle_t *query, long double *bounds,
+                             matched_records_t *matches);
+static void rtree_knn_query(void *index, point_t *query, 
+                            knn_result_t *result);
+static void node_knn_query(rtree_t *rtree, int level, int node, 
+                           point_t *query, knn_result_t *result);
+static long double node_min_distance(rtree_node_t *node, point_t *query,
+                                     knn_result_t *result);
+static void rtree_free(void *index);
+
+const index_backend_t rtree_backend = {"rtree", rtree_create, 
+    rtree_point_query, rtree_range_query, rtree_knn_query, rtree_free};
+
+
+/* Bulk load the tree over the locations */
+static void *rtree_create(record_table_t *table, index_points_t *points,
+                          rectangle_t *area){
+    rtree_t *rtree = malloc(sizeof(*rtree));
+    assert(rtree != NULL);
+    rtree->points = points;
+    int num_points = points->num_points;
+
+    // Pack the points into leaves
+    pack_entry_t *entries = malloc(sizeof(pack_entry_t) * (num_points + 1));
+    assert(entries != NULL);
+    for (int i = 0; i < num_points; i++){
+        entries[i].x = points->lons[i];
+        entries[i].y = points->lats[i];
+        entries[i].idx = i;
+    }
+    str_sort(entries, num_points);
+    rtree->order = malloc(sizeof(int) * (num_points + 1));
+    assert(rtree->order != NULL);
+    for (int i = 0; i < num_points; i++){
+        rtree->order[i] = entries[i].idx;
+    }
+
+    int max_levels = 1;
+    for (int size = num_points; size > 1; size /= 2){
+        max_levels++;
+    }
+    rtree->levels = malloc(sizeof(rtree_node_t*) * max_levels);
+    rtree->level_sizes = malloc(sizeof(int) * max_levels);
+    assert(rtree->levels != NULL && rtree->level_sizes != NULL);
+
+    // Each level groups the entries below into nodes until one is left
+    int num_below = num_points;
+    rtree_node_t *below = NULL;
+    rtree->num_levels = 0;
+    do {
+        int num_nodes = (num_below + NODE_CAPACITY - 1) / NODE_CAPACITY;
+        if (num_nodes == 0){
+            num_nodes = 1;    // an empty root
+        }
+        rtree_node_t *nodes = malloc(sizeof(rtree_node_t) * num_nodes);
+        assert(nodes != NULL);
+        for (int node = 0; node < num_nodes; node++){
+            nodes[node].first_child = node * NODE_CAPACITY;
+            nodes[node].num_children = NODE_CAPACITY;
+            if (nodes[node].first_child + NODE_CAPACITY > num_below){
+                nodes[node].num_children = num_below - 
+                                           nodes[node].first_child;
+            }
+            nodes[node].left = nodes[node].bot = INFINITY;
+            nodes[node].right = nodes[node].top = -INFINITY;
+            for (int i = 0; i < nodes[node].num_children; i++){
+                int child = nodes[node].first_child + i;
+                long double left, bot, right, top;
+                if (below == NULL){
+                    left = right = points->lons[rtree->order[child]];
+                    bot = top = points->lats[rtree->order[child]];
+                }else{
+                    left = below[child].left;
+                    bot = below[child].bot;
+                    right = below[child].right;
+                    top = below[child].top;
+                }
+                nodes[node].left = fminl(nodes[node].left, left);
+                nodes[node].bot = fminl(nodes[node].bot, bot);
+                nodes[node].right = fmaxl(nodes[node].right, right);
+                nodes[node].top = fmaxl(nodes[node].top, top);
+            }
+        }
+
+        // Pack the new nodes for the next level up, reordering them
+        if (num_nodes > 1){
+            for (int node = 0; node < num_nodes; node++){
+                entries[node].x = (nodes[node].left + nodes[node].right) / 2;
+                entries[node].y = (nodes[node].bot + nodes[node].top) / 2;
+                entries[node].idx = node;
+            }
+            str_sort(entries, num_nodes);
+            rtree_node_t *packed = malloc(sizeof(rtree_node_t) * num_nodes);
+            assert(packed != NULL);
+            for (int node = 0; node < num_nodes; node++){
+                packed[node] = nodes[entries[node].idx];
+            }
+            free(nodes);
+            nodes = packed;
+        }
+        rtree->levels[rtree->num_levels] = nodes;
+        rtree->level_sizes[rtree->num_levels] = num_nodes;
+        rtree->num_levels++;
+        below = nodes;
+        num_below = num_nodes;
+    } while (num_below > 1);
+
+    free(entries);
+    return rtree;
+}
+
+
+/* Sort the entries into Sort-Tile-Recursive order: vertical slices by 
+longitude, each sorted by latitude */
+static void str_sort(pack_entry_t *entries, int num_entries){
+    int num_nodes = (num_entries + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    int num_slices = (int)ceil(sqrt((double)num_nodes));
+    if (num_slices < 1){
+        num_slices = 1;
+    }
+    int slice_size = ((num_nodes + num_slices - 1) / num_slices) * 
+                     NODE_CAPACITY;
+
+    qsort(entries, num_entries, sizeof(pack_entry_t), pack_x_cmp);
+    for (int start = 0; start < num_entries; start += slice_size){
+        int size = slice_size;
+        if (start + size > num_entries){
+            size = num_entries - start;
+        }
+        qsort(entries + start, size, sizeof(pack_entry_t), pack_y_cmp);
+    }
+}
+
+
+/* Order pack entries by x, then y & index so the order is always the same */
+static int pack_x_cmp(const void *entry1, const void *entry2){
+    const pack_entry_t *pack1 = entry1;
+    const pack_entry_t *pack2 = entry2;
+    if (pack1->x != pack2->x){
+        return pack1->x < pack2->x ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (pack1->y != pack2->y){
+        return pack1->y < pack2->y ? SMALLER_THAN : GREATER_THAN;
+    }
+    return pack1->idx - pack2->idx;
+}
+
+
+/* Order pack entries by y, then x & index */
+static int pack_y_cmp(const void *entry1, const void *entry2){
+    const pack_entry_t *pack1 = entry1;
+    const pack_entry_t *pack2 = entry2;
+    if (pack1->y != pack2->y){
+        return pack1->y < pack2->y ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (pack1->x != pack2->x){
+        return pack1->x < pack2->x ? SMALLER_THAN : GREATER_THAN;
+    }
+    return pack1->idx - pack2->idx;
+}
+
+
+/* Find the location equal to the query */
+static void rtree_point_query(void *index, point_t *query,
+                              matched_records_t *matches){
+    rtree_t *rtree = index;
+    node_point_query(rtree, rtree->num_levels - 1, 0, query, matches);
+}
+
+
+/* Search the node's children whose box holds the query point */
+static void node_point_query(rtree_t *rtree, int level, int node, 
+                             point_t *query, matched_records_t *matches){
+    rtree_node_t *curr = &rtree->levels[level][node];
+    long double lon = get_lon(query), lat = get_lat(query);
+    if (lon < curr->left || lon > curr->right || lat < curr->bot || 
+            lat > curr->top){
+        return;
+    }
+    for (int i = 0; i < curr->num_children; i++){
+        int child = curr->first_child + i;
+        if (level > 0){
+            node_point_query(rtree, level - 1, child, query, matches);
+        }else{
+            int point = rtree->order[child];
+            if (rtree->points->lons[point] == lon && 
+                    rtree->points->lats[point] == lat){
+                point_records_match(rtree->points, point, matches);
+            }
+        }
+    }
+}
+
+
+/* Find the locations in the query rectangle */
+static void rtree_range_query(void *index, rectangle_t *query,
+                              matched_records_t *matches){
+    rtree_t *rtree = index;
+    long double bounds[] = {get_lon(get_bottomleft(query)), 
+        get_lat(get_bottomleft(query)), get_lon(get_topright(query)),
+        get_lat(get_topright(query))};
+    node_range_query(rtree, rtree->num_levels - 1, 0, query, bounds, 
+                     matches);
+}
+
+
+/* Search the children of a node whose box overlaps the query(with bounds 
+left, bot, right, top) */
+static void node_range_query(rtree_t *rtree, int level, int node,
+                             rectangle_t *query, long double *bounds,
+                             matched_records_t *matches){
+    rtree_node_t *curr = &rtree->levels[level][node];
+    if (curr->right <= bounds[0] || curr->left > bounds[2] ||
+            curr->top < bounds[1] || curr->bot >= bounds[3]){
+        return;
+    }
+    for (int i = 0; i < curr->num_children; i++){
+        int child = curr->first_child + i;
+        if (level > 0){
+            node_range_query(rtree, level - 1, child, query, bounds, 
+                             matches);
+        }else{
+            int point = rtree->order[child];
+            if (rectangle_contains(query, rtree->points->lons[point],
+                                   rtree->points->lats[point])){
+                point_records_match(rtree->points, point, matches);
+            }
+        }
+    }
+}
+
+
+/* Search for the nearest locations, closest nodes first */
+static void rtree_knn_query(void *index, point_t *query, 
+                            knn_result_t *result){
+    rtree_t *rtree = index;
+    node_knn_query(rtree, rtree->num_levels - 1, 0, query, result);
+}
+
+
+/* Offer the locations under the node to the result, visiting children in 
+order of distance and skipping those further than the k found so far */
+static void node_knn_query(rtree_t *rtree, int level, int node, 
+                           point_t *query, knn_result_t *result){
+    rtree_node_t *curr = &rtree->levels[level][node];
+    if (level == 0){
+        for (int i = 0; i < curr->num_children; i++){
+            int point = rtree->order[curr->first_child + i];
+            long double lon = rtree->points->lons[point];
+            long double lat = rtree->points->lats[point];
+            long double dist = haversine_coords(get_lon(query), 
+                                                get_lat(query), lon, lat);
+            knn_offer(result, dist, lon, lat, rtree->points->records + 
+                      rtree->points->first_record[point],
+                      rtree->points->first_record[point + 1] - 
+                      rtree->points->first_record[point]);
+        }
+        return;
+    }
+
+    // Order the children by their distance, nearest first
+    int children[NODE_CAPACITY];
+    long double child_bounds[NODE_CAPACITY];
+    for (int i = 0; i < curr->num_children; i++){
+        int child = curr->first_child + i;
+        long double bound = node_min_distance(&rtree->levels[level - 1][child],
+                                              query, result);
+        int j = i;
+        while (j > 0 && child_bounds[j - 1] > bound){
+            children[j] = children[j - 1];
+            child_bounds[j] = child_bounds[j - 1];
+            j--;
+        }
+        children[j] = child;
+        child_bounds[j] = bound;
+    }
+    for (int i = 0; i < curr->num_children; i++){
+        if (child_bounds[i] > knn_bound(result)){
+            return;
+        }
+        node_knn_query(rtree, level - 1, children[i], query, result);
+    }
+}
+
+
+/* Least distance in metres from the query to the node's box */
+static long double node_min_distance(rtree_node_t *node, point_t *query,
+                                     knn_result_t *result){
+    long double lon = get_lon(query), lat = get_lat(query);
+    long double lon_gap = fmaxl(0, fmaxl(node->left - lon, lon - node->right));
+    long double lat_gap = fmaxl(0, fmaxl(node->bot - lat, lat - node->top));
+    return haversine_lower_bound(lon_gap, lat_gap, result->max_abs_lat);
+}
+
+
+/* Free the tree, the locations belong to the interface */
+static void rtree_free(void *index){
+    rtree_t *rtree = index;
+    for (int level = 0; level < rtree->num_levels; level++){
+        free(rtree->levels[level]);
+    }
+    free(rtree->levels);
+    free(rtree->level_sizes);
+    free(rtree->order);
+    free(rtree);
+}
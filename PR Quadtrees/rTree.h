@@ -0,0 +1,6 @@
+#ifndef _RTREE_H_
+#define _RTREE_H_
+#include "spatialIndexInternal.h"
+
+extern const index_backend_t rtree_backend;
+#endif
@@ -0,0 +1,358 @@
+/* rangeCursor.c
+*
+* Created by Ke Liao
+*
+* This module contains an iterator over the footpath records within a query
+* rectangle, which hands out one record at a time instead of collecting all
+* matches first, and supports skipping(offset) and capping(limit) the 
+* records returned. Records either come out in spatial order, straight from
+* the tree walk, or sorted by footpath id a batch at a time: each batch is
+* the next smallest footpath ids after the last returned, found by walking
+* the tree again with a bounded heap. Batches start small, so the first
+* records come quickly, & double up to ID_BATCH_MAX, so a large query needs
+* few walks. Either way memory is bounded by the tree depth & the largest
+* batch, never by the number of records or matching leaves. Each record is
+* returned once even if both of its points are in the query.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "dataPoint.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "rangeCursor.h"
+#include "usefulConsts.h"
+
+#define ID_BATCH_MIN 1024     // records found by the first walk in id order
+#define ID_BATCH_MAX 65536    // most records found by a walk
+
+// Record of an id order batch, with its footpath id to compare on
+typedef struct batch_entry{
+    int footpath_id;
+    record_id_t record;
+} batch_entry_t;
+
+struct range_cursor{
+    quadtree_t *quadtree;
+    rectangle_t *query;
+    int order;
+    int to_skip;     // records still to be skipped for the offset
+    int remaining;   // records still to be returned, NO_LIMIT if uncapped
+
+    // Spatial order: stack of nodes still to visit & the leaf being read
+    quadtree_node_t **stack;
+    int stack_size, stack_max;
+    data_point_t *curr_leaf;
+    int curr_idx;
+
+    /* Id order: the batch being returned(a max heap while it's found, then
+    sorted) & the largest footpath id of the batches before */
+    batch_entry_t *batch;
+    int batch_size, batch_next, batch_max;
+    int last_id;
+    int any_returned;
+
+    footpath_t *buffer;  // the record returned, if the table is compact
+};
+
+
+static void stack_push(range_cursor_t *cursor, quadtree_node_t *node);
+static footpath_t *spatial_next(range_cursor_t *cursor);
+static footpath_t *id_order_next(range_cursor_t *cursor);
+static int owns_record(range_cursor_t *cursor, data_point_t *dt_point,
+                       footpath_t *record);
+static void batch_fill(range_cursor_t *cursor);
+static void batch_collect(range_cursor_t *cursor, quadtree_node_t *node);
+static void batch_offer(range_cursor_t *cursor, batch_entry_t entry);
+static void batch_sift_down(range_cursor_t *cursor, int idx);
+static int batch_entry_cmp(const void *entry1, const void *entry2);
+
+
+/* Create a cursor over the records of the tree within the query rectangle,
+skipping the first offset records and returning at most limit records*/
+range_cursor_t *range_cursor_create(quadtree_t *quadtree, rectangle_t *query,
+                                    int order, int offset, int limit){
+    range_cursor_t *cursor = malloc(sizeof(*cursor));
+    assert(cursor != NULL);
+    cursor->quadtree = quadtree;
+    cursor->query = query;
+    cursor->order = order;
+    cursor->to_skip = offset > 0 ? offset : 0;
+    cursor->remaining = limit;
+    cursor->stack_size = 0;
+    cursor->stack_max = 1;
+    cursor->stack = malloc(sizeof(quadtree_node_t*) * cursor->stack_max);
+    assert(cursor->stack != NULL);
+    cursor->batch = NULL;
+    cursor->batch_size = cursor->batch_next = cursor->batch_max = 0;
+    cursor->curr_leaf = NULL;
+    cursor->curr_idx = 0;
+    cursor->last_id = 0;
+    cursor->any_returned = FALSE;
+    cursor->buffer = record_buffer_create();
+
+    if (rectangle_overlap(query, quadtree->root->rectangle) == FALSE){
+        cursor->remaining = 0;  // Nothing to find
+    }else if (order == CURSOR_ID_ORDER){
+        cursor->batch_max = ID_BATCH_MIN;
+        cursor->batch = malloc(sizeof(batch_entry_t) * cursor->batch_max);
+        assert(cursor->batch != NULL);
+    }else{
+        stack_push(cursor, quadtree->root);
+    }
+    return cursor;
+}
+
+
+/* Get the next record of the cursor, or NULL once there are no more. If the
+table is compact the record is only valid until the next call */
+footpath_t *range_cursor_next(range_cursor_t *cursor){
+    while (cursor->remaining != 0){
+        footpath_t *record;
+        if (cursor->order == CURSOR_ID_ORDER){
+            record = id_order_next(cursor);
+        }else{
+            record = spatial_next(cursor);
+        }
+        if (record == NULL){
+            cursor->remaining = 0;
+            break;
+        }
+
+        if (cursor->to_skip > 0){
+            cursor->to_skip--;
+            continue;
+        }
+        if (cursor->remaining > 0){
+            cursor->remaining--;
+        }
+        return record;
+    }
+    return NULL;
+}
+
+
+/* Free the cursor(but not the tree or query it was created with) */
+void range_cursor_free(range_cursor_t *cursor){
+    free(cursor->stack);
+    free(cursor->batch);
+    record_buffer_free(cursor->buffer);
+    free(cursor);
+}
+
+
+/* Add a node to the stack of nodes still to be visited */
+static void stack_push(range_cursor_t *cursor, quadtree_node_t *node){
+    if (cursor->stack_size == cursor->stack_max){
+        cursor->stack_max *= 2;
+        cursor->stack = realloc(cursor->stack,
+            sizeof(quadtree_node_t*) * cursor->stack_max);
+        assert(cursor->stack != NULL);
+    }
+    cursor->stack[cursor->stack_size++] = node;
+}
+
+
+/* Next record in spatial order, continuing the depth first walk of the tree
+from where it was left off */
+static footpath_t *spatial_next(range_cursor_t *cursor){
+    while (TRUE){
+
+        // Finish reading the current leaf first
+        if (cursor->curr_leaf != NULL){
+            record_id_t *records = get_record_list(cursor->curr_leaf);
+            int num_records = get_num_stored(cursor->curr_leaf);
+            while (cursor->curr_idx < num_records){
+                footpath_t *record = record_table_get(
+                    cursor->quadtree->records, records[cursor->curr_idx++],
+                    cursor->buffer);
+                if (owns_record(cursor, cursor->curr_leaf, record)){
+                    return record;
+                }
+            }
+            cursor->curr_leaf = NULL;
+        }
+
+        if (cursor->stack_size == 0){
+            return NULL;
+        }
+        quadtree_node_t *node = cursor->stack[--cursor->stack_size];
+        if (is_leaf_node(node)){
+            if (node->dt_point != NULL && in_rectangle(cursor->query,
+                    get_dt_point_loc(node->dt_point)) == TRUE){
+                cursor->curr_leaf = node->dt_point;
+                cursor->curr_idx = 0;
+            }
+            continue;
+        }
+
+        // Push in reverse so the quadrants are visited SW, NW, NE, SE
+        for (int quad = SE_QUADRANT; quad >= SW_QUADRANT; quad--){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child != NULL &&
+                    rectangle_overlap(cursor->query, child->rectangle)){
+                stack_push(cursor, child);
+            }
+        }
+    }
+}
+
+
+/* A record is returned at its start point, or at its end point if the start
+point isn't matched by the query */
+static int owns_record(range_cursor_t *cursor, data_point_t *dt_point,
+                       footpath_t *record){
+    point_t *start_point = get_start_point(record);
+    int owns = point_cmp(start_point, get_dt_point_loc(dt_point)) == EQUALS;
+    if (!owns){
+        owns = !(in_rectangle(cursor->quadtree->root->rectangle, start_point)
+                 && in_rectangle(cursor->query, start_point));
+    }
+    point_free(start_point);
+    return owns;
+}
+
+
+/* Next record in footpath id order, finding the next batch once the one
+being returned runs out */
+static footpath_t *id_order_next(range_cursor_t *cursor){
+    if (cursor->batch_next == cursor->batch_size){
+        batch_fill(cursor);
+        if (cursor->batch_size == 0){
+            return NULL;
+        }
+    }
+    batch_entry_t *entry = &cursor->batch[cursor->batch_next++];
+    return record_table_get(cursor->quadtree->records, entry->record,
+                            cursor->buffer);
+}
+
+
+/* Find the batch_max smallest footpath ids in the query after the last
+batch, sorted & each only once. The batch after is twice as large */
+static void batch_fill(range_cursor_t *cursor){
+    if (cursor->any_returned && cursor->batch_max < ID_BATCH_MAX){
+        cursor->batch_max *= 2;
+        cursor->batch = realloc(cursor->batch,
+                                sizeof(batch_entry_t) * cursor->batch_max);
+        assert(cursor->batch != NULL);
+    }
+    cursor->batch_size = cursor->batch_next = 0;
+    batch_collect(cursor, cursor->quadtree->root);
+    qsort(cursor->batch, cursor->batch_size, sizeof(batch_entry_t),
+          batch_entry_cmp);
+
+    // A record with both points in the query is found twice
+    int num_unique = 0;
+    for (int i = 0; i < cursor->batch_size; i++){
+        if (num_unique == 0 || cursor->batch[i].footpath_id !=
+                cursor->batch[num_unique - 1].footpath_id){
+            cursor->batch[num_unique++] = cursor->batch[i];
+        }
+    }
+    cursor->batch_size = num_unique;
+    if (num_unique > 0){
+        cursor->last_id = cursor->batch[num_unique - 1].footpath_id;
+        cursor->any_returned = TRUE;
+    }
+}
+
+
+/* Offer the records of every leaf in the query under the node to the batch,
+starting each leaf's(sorted) list after the last batch */
+static void batch_collect(range_cursor_t *cursor, quadtree_node_t *node){
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL || !in_rectangle(cursor->query,
+                get_dt_point_loc(node->dt_point))){
+            return;
+        }
+        record_table_t *table = cursor->quadtree->records;
+        record_id_t *records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+
+        // Binary search for the first record after the last batch
+        int lo = 0, hi = num_records;
+        while (cursor->any_returned && lo < hi){
+            int mid = (lo + hi) / 2;
+            if (record_table_footpath_id(table, records[mid]) <= 
+                    cursor->last_id){
+                lo = mid + 1;
+            }else{
+                hi = mid;
+            }
+        }
+        for (int i = lo; i < num_records; i++){
+            batch_entry_t entry = {record_table_footpath_id(table, records[i]),
+                                   records[i]};
+            if (cursor->batch_size == cursor->batch_max &&
+                    entry.footpath_id >= cursor->batch[0].footpath_id){
+                break;  // The rest of the leaf is larger still
+            }
+            batch_offer(cursor, entry);
+        }
+        return;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL &&
+                rectangle_overlap(cursor->query, child->rectangle)){
+            batch_collect(cursor, child);
+        }
+    }
+}
+
+
+/* Add the entry to the batch's max heap, replacing the largest if full */
+static void batch_offer(range_cursor_t *cursor, batch_entry_t entry){
+    if (cursor->batch_size < cursor->batch_max){
+        int idx = cursor->batch_size++;
+        while (idx > 0 && cursor->batch[(idx - 1) / 2].footpath_id <
+                          entry.footpath_id){
+            cursor->batch[idx] = cursor->batch[(idx - 1) / 2];
+            idx = (idx - 1) / 2;
+        }
+        cursor->batch[idx] = entry;
+        return;
+    }
+    cursor->batch[0] = entry;
+    batch_sift_down(cursor, 0);
+}
+
+
+/* Move the batch entry at idx down until the max heap is in order again */
+static void batch_sift_down(range_cursor_t *cursor, int idx){
+    while (TRUE){
+        int largest = idx;
+        int left = 2 * idx + 1;
+        int right = left + 1;
+        if (left < cursor->batch_size && cursor->batch[left].footpath_id >
+                cursor->batch[largest].footpath_id){
+            largest = left;
+        }
+        if (right < cursor->batch_size && cursor->batch[right].footpath_id >
+                cursor->batch[largest].footpath_id){
+            largest = right;
+        }
+        if (largest == idx){
+            return;
+        }
+        batch_entry_t temp = cursor->batch[idx];
+        cursor->batch[idx] = cursor->batch[largest];
+        cursor->batch[largest] = temp;
+        idx = largest;
+    }
+}
+
+
+/* Compare batch entries by footpath id */
+static int batch_entry_cmp(const void *entry1, const void *entry2){
+    int id1 = ((const batch_entry_t*)entry1)->footpath_id;
+    int id2 = ((const batch_entry_t*)entry2)->footpath_id;
+    return (id1 > id2) - (id1 < id2);
+}
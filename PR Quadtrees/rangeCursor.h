@@ -0,0 +1,17 @@
+#ifndef _RANGECURSOR_H_
+#define _RANGECURSOR_H_
+#include "quadTree.h"
+#include "rectangle.h"
+
+// Orders the records of a cursor can come out in
+#define CURSOR_SPATIAL_ORDER 0  // as the leaves are reached(streams at once)
+#define CURSOR_ID_ORDER 1   // sorted by footpath id, like tree_ranged_query
+#define NO_LIMIT -1
+
+typedef struct range_cursor range_cursor_t;
+
+range_cursor_t *range_cursor_create(quadtree_t *quadtree, rectangle_t *query,
+                                    int order, int offset, int limit);
+footpath_t *range_cursor_next(range_cursor_t *cursor);
+void range_cursor_free(range_cursor_t *cursor);
+#endif
@@ -0,0 +1,195 @@
+/* recordTable.c
+*
+* Created by Ke Liao
+*
+* This module contains functions for the construction of the table holding
+* all footpath records in one contiguous, growable array. Everything else 
+* refers to a record by its 32 bit index in the table rather than by a 
+* pointer, which keeps references small and the index free of pointers to 
+* records. This module also keeps arrays of record ids sorted by footpath id.
+*
+* A table read with record_table_read_compact keeps its records packed
+* instead(see compactRecords.c), for datasets too large to hold as structs.
+* Such a table can't be added to, & a record got from it is unpacked into a
+* buffer from record_buffer_create, which holds it until the buffer is reused.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "footpathData.h"
+#include "recordTable.h"
+#include "compactRecords.h"
+#include "usefulConsts.h"
+
+struct record_table{
+    footpath_t *records;  // contiguous array of records
+    int num_ele;    // number of records in the table
+    int max_size;   // max array size
+    compact_records_t *compact;  // packed records instead, or NULL
+};
+
+
+/* Create an empty record table */
+record_table_t *record_table_create(){
+    record_table_t *table = malloc(sizeof(*table));
+    assert(table != NULL);
+    table->max_size = 1;
+    table->num_ele = 0;
+    table->records = footpath_array_resize(NULL, table->max_size);
+    table->compact = NULL;
+    return table;
+}
+
+
+/* Read every remaining footpath record of the csv file into a new table*/
+record_table_t *record_table_read(FILE *data_file){
+    record_table_t *table = record_table_create();
+    while (TRUE){
+
+        // Read straight into the next free slot, growing as required
+        if (table->num_ele == table->max_size){
+            table->max_size *= 2;
+            table->records = footpath_array_resize(table->records,
+                                                   table->max_size);
+        }
+        footpath_t *slot = footpath_array_get(table->records, table->num_ele);
+        if (footpath_read_into(data_file, slot) == FALSE){
+            break;
+        }
+        table->num_ele++;
+    }
+    return table;
+}
+
+
+/* Read every remaining footpath record of the csv file into a new table
+keeping them packed, so only one record is ever held as a struct */
+record_table_t *record_table_read_compact(FILE *data_file){
+    record_table_t *table = record_table_create();
+    table->compact = compact_records_create();
+    footpath_t *footpath;
+    while ((footpath = footpath_read(data_file)) != NULL){
+        compact_records_add(table->compact, footpath);
+        data_free(footpath);
+    }
+    return table;
+}
+
+
+/* Move a record read by footpath_read into the table, returning its id. The
+record passed in is freed, but not the strings now held by the table*/
+record_id_t record_table_add(record_table_t *table, footpath_t *record){
+    assert(table->compact == NULL);
+    if (table->num_ele == table->max_size){
+        table->max_size *= 2;
+        table->records = footpath_array_resize(table->records,
+                                               table->max_size);
+    }
+    footpath_t *slot = footpath_array_get(table->records, table->num_ele);
+    footpath_move(slot, record);
+    return table->num_ele++;
+}
+
+
+/* Get the record with the id. The pointer is valid until the table grows,
+or if the table is compact, it's unpacked into the buffer & is valid until
+the buffer is reused */
+footpath_t *record_table_get(record_table_t *table, record_id_t id,
+                             footpath_t *buffer){
+    if (table->compact != NULL){
+        return compact_records_get(table->compact, id, buffer);
+    }
+    assert(id < (record_id_t)table->num_ele);
+    return footpath_array_get(table->records, id);
+}
+
+
+/* Create a buffer to get records into. Its strings belong to the table, so
+it's freed with record_buffer_free rather than data_free */
+footpath_t *record_buffer_create(){
+    return footpath_array_resize(NULL, 1);
+}
+
+
+/* Free a buffer made by record_buffer_create */
+void record_buffer_free(footpath_t *buffer){
+    free(buffer);
+}
+
+
+/* Get the number of records in the table */
+int record_table_size(record_table_t *table){
+    if (table->compact != NULL){
+        return compact_records_size(table->compact);
+    }
+    return table->num_ele;
+}
+
+
+/* Get the footpath id of the record with the id(without unpacking it if 
+the table is compact) */
+int record_table_footpath_id(record_table_t *table, record_id_t id){
+    if (table->compact != NULL){
+        return compact_records_footpath_id(table->compact, id);
+    }
+    assert(id < (record_id_t)table->num_ele);
+    return get_footpath_id(footpath_array_get(table->records, id));
+}
+
+
+/* Compare the footpath ids of the two records */
+int record_id_cmp(record_table_t *table, record_id_t id1, record_id_t id2){
+    int footpath_id1 = record_table_footpath_id(table, id1);
+    int footpath_id2 = record_table_footpath_id(table, id2);
+    if (footpath_id1 == footpath_id2){
+        return EQUALS;
+    }
+    return footpath_id1 < footpath_id2 ? SMALLER_THAN : GREATER_THAN;
+}
+
+
+/* Add record to an array of record ids, ensuring its sorted by the footpath 
+id. The array must have space for one more element */
+int sorted_record_add(record_table_t *table, record_id_t *arr, 
+                      record_id_t record, int num_ele){
+    
+    // Find insert index
+    int insert_idx = UNDEFINED;
+    for (int i=0; i < num_ele; i++){
+        int cmp = record_id_cmp(table, record, arr[i]);
+        if (cmp == SMALLER_THAN){
+            insert_idx = i;
+            break;
+        }else if (cmp == EQUALS){
+            return INSERT_FAILURE; // don't insert duplicates
+        }
+    }
+
+    // For if records is to be inserted at last element
+    if (insert_idx == UNDEFINED){
+        insert_idx = num_ele;
+    }
+
+    // Move the elements after the insert index to the right
+    for (int i = num_ele; i > insert_idx; i--){
+        arr[i] = arr[i - 1];
+    }
+    arr[insert_idx] = record;
+    return INSERT_SUCCESS;
+}
+
+
+/* Free the table along with the records in it */
+void record_table_free(record_table_t *table){
+    assert(table != NULL);
+    for (int i = 0; i < table->num_ele; i++){
+        data_fields_free(footpath_array_get(table->records, i));
+    }
+    free(table->records);
+    if (table->compact != NULL){
+        compact_records_free(table->compact);
+    }
+    free(table);
+}
@@ -0,0 +1,26 @@
+#ifndef _RECORDTABLE_H_
+#define _RECORDTABLE_H_
+#include <stdio.h>
+#include <stdint.h>
+#include "footpathData.h"
+
+// Records are referred to by their index in the table
+typedef uint32_t record_id_t;
+
+typedef struct record_table record_table_t;
+
+record_table_t *record_table_create();
+record_table_t *record_table_read(FILE *data_file);
+record_table_t *record_table_read_compact(FILE *data_file);
+record_id_t record_table_add(record_table_t *table, footpath_t *record);
+footpath_t *record_table_get(record_table_t *table, record_id_t id,
+                             footpath_t *buffer);
+footpath_t *record_buffer_create();
+void record_buffer_free(footpath_t *buffer);
+int record_table_size(record_table_t *table);
+int record_table_footpath_id(record_table_t *table, record_id_t id);
+int record_id_cmp(record_table_t *table, record_id_t id1, record_id_t id2);
+int sorted_record_add(record_table_t *table, record_id_t *arr, 
+                      record_id_t record, int num_ele);
+void record_table_free(record_table_t *table);
+#endif
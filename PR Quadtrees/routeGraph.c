@@ -0,0 +1,484 @@
+/* routeGraph.c
+*
+* Created by Ke Liao
+*
+* This module treats the footpaths as a network to route over. Each distinct
+* start or end point is a junction(the footpaths of a data point all meet
+* there) & each footpath an edge between its two junctions, walkable both
+* ways. The edges of each junction are stored together in compressed sparse
+* row form: the edges of junction j are first_edge[j] to first_edge[j + 1].
+*
+* An edge costs its distance, never less than the straight line between its
+* ends, times 1 + slope_penalty / grade1in(footpaths with no grade aren't
+* penalised). Routes are found with A*, estimating the rest of the route
+* by the straight line through the earth to the destination: it's never
+* longer than the haversine distance, so never more than the cost of the
+* rest of the route, & only needs a square root from each junction's
+* position in 3D(kept beside its longitude & latitude).
+*
+* The origin & destination of a route are snapped to the nearest point in
+* the tree, so routes start & end at junctions in the tree's area.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "routeGraph.h"
+#include "usefulConsts.h"
+
+#define INITIAL_SIZE 64
+
+// Junction waiting to be searched, by cost so far + estimate of the rest
+typedef struct {
+    double estimate;
+    double cost;
+    int junction;
+} open_entry_t;
+
+struct route_graph{
+    quadtree_t *qtree;
+    record_table_t *table;
+
+    // Junctions, sorted by longitude then latitude
+    int num_junctions;
+    double *lons, *lats;
+    double *xs, *ys, *zs;     // position on a sphere of the earth's radius
+
+    // Edges in compressed sparse row form
+    int *first_edge;
+    int *targets;
+    double *costs, *lengths;
+    record_id_t *edge_records;
+
+    // Search state, only valid for junctions reached in the current search
+    int search_num;
+    int *reached;       // number of the last search to reach the junction
+    double *best_costs;
+    int *via_edges;     // edge the best route so far arrived by
+    int *via_junctions;
+    open_entry_t *open;
+    int open_size, num_open;
+};
+
+static int coord_cmp(const void *coord1, const void *coord2);
+static int junction_find(route_graph_t *graph, double lon, double lat);
+static double straight_line(route_graph_t *graph, int junction1,
+                            int junction2);
+static double edge_length(footpath_t *footpath, double start_lon,
+                          double start_lat, double end_lon, double end_lat);
+static int nearest_junction(route_graph_t *graph, point_t *query);
+static void node_nearest(quadtree_node_t *node, point_t *query,
+                         rectangle_t *query_rect, data_point_t **nearest,
+                         long double *nearest_dist);
+static int route_search(route_graph_t *graph, int origin, int destination,
+                        int *num_searched);
+static void open_push(route_graph_t *graph, double estimate, double cost,
+                      int junction);
+static open_entry_t open_pop(route_graph_t *graph);
+
+
+/* Build the network of the tree's records */
+route_graph_t *route_graph_create(quadtree_t *qtree, double slope_penalty){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+    route_graph_t *graph = malloc(sizeof(*graph));
+    assert(graph);
+    graph->qtree = qtree;
+    graph->table = qtree->records;
+    int num_records = record_table_size(graph->table);
+
+    // Ends of every record as (lon, lat) pairs
+    double *ends = malloc(sizeof(double) * 4 * (num_records + 1));
+    footpath_t *buffer = record_buffer_create();
+    assert(ends);
+    for (record_id_t record = 0; record < num_records; record++){
+        footpath_t *footpath = record_table_get(graph->table, record, buffer);
+        point_t *start = get_start_point(footpath);
+        point_t *end = get_end_point(footpath);
+        ends[4 * record] = get_lon(start);
+        ends[4 * record + 1] = get_lat(start);
+        ends[4 * record + 2] = get_lon(end);
+        ends[4 * record + 3] = get_lat(end);
+        point_free(start);
+        point_free(end);
+    }
+
+    // Distinct ends are the junctions
+    double *coords = malloc(sizeof(double) * 4 * (num_records + 1));
+    assert(coords);
+    for (int i = 0; i < 4 * num_records; i++){
+        coords[i] = ends[i];
+    }
+    qsort(coords, 2 * num_records, sizeof(double) * 2, coord_cmp);
+    graph->lons = malloc(sizeof(double) * (2 * num_records + 1));
+    graph->lats = malloc(sizeof(double) * (2 * num_records + 1));
+    assert(graph->lons && graph->lats);
+    graph->num_junctions = 0;
+    for (int i = 0; i < 2 * num_records; i++){
+        if (i > 0 &&
+                coord_cmp(&coords[2 * i], &coords[2 * (i - 1)]) == EQUALS){
+            continue;
+        }
+        graph->lons[graph->num_junctions] = coords[2 * i];
+        graph->lats[graph->num_junctions++] = coords[2 * i + 1];
+    }
+    free(coords);
+    graph->xs = malloc(sizeof(double) * (graph->num_junctions + 1));
+    graph->ys = malloc(sizeof(double) * (graph->num_junctions + 1));
+    graph->zs = malloc(sizeof(double) * (graph->num_junctions + 1));
+    assert(graph->xs && graph->ys && graph->zs);
+    for (int j = 0; j < graph->num_junctions; j++){
+        double lon = graph->lons[j] * DEG_TO_RAD;
+        double lat = graph->lats[j] * DEG_TO_RAD;
+        graph->xs[j] = EARTH_RADIUS * cos(lat) * cos(lon);
+        graph->ys[j] = EARTH_RADIUS * cos(lat) * sin(lon);
+        graph->zs[j] = EARTH_RADIUS * sin(lat);
+    }
+
+    // Junctions of each record(a record starting where it ends is no edge)
+    int num_junctions = graph->num_junctions;
+    int *record_ends = malloc(sizeof(int) * 2 * (num_records + 1));
+    graph->first_edge = calloc(num_junctions + 1, sizeof(int));
+    assert(record_ends && graph->first_edge);
+    for (record_id_t record = 0; record < num_records; record++){
+        int start = junction_find(graph, ends[4 * record],
+                                  ends[4 * record + 1]);
+        int end = junction_find(graph, ends[4 * record + 2],
+                                ends[4 * record + 3]);
+        record_ends[2 * record] = start;
+        record_ends[2 * record + 1] = end;
+        if (start != end){
+            graph->first_edge[start + 1]++;
+            graph->first_edge[end + 1]++;
+        }
+    }
+    for (int j = 0; j < num_junctions; j++){
+        graph->first_edge[j + 1] += graph->first_edge[j];
+    }
+
+    // Fill in each junction's edges, in record order
+    int num_edges = graph->first_edge[num_junctions];
+    graph->targets = malloc(sizeof(int) * (num_edges + 1));
+    graph->costs = malloc(sizeof(double) * (num_edges + 1));
+    graph->lengths = malloc(sizeof(double) * (num_edges + 1));
+    graph->edge_records = malloc(sizeof(record_id_t) * (num_edges + 1));
+    int *next_edge = malloc(sizeof(int) * (num_junctions + 1));
+    assert(graph->targets && graph->costs && graph->lengths &&
+           graph->edge_records && next_edge);
+    for (int j = 0; j < num_junctions; j++){
+        next_edge[j] = graph->first_edge[j];
+    }
+    for (record_id_t record = 0; record < num_records; record++){
+        int start = record_ends[2 * record], end = record_ends[2 * record + 1];
+        if (start == end){
+            continue;
+        }
+        footpath_t *footpath = record_table_get(graph->table, record, buffer);
+        double length = edge_length(footpath, ends[4 * record],
+                                    ends[4 * record + 1], ends[4 * record + 2],
+                                    ends[4 * record + 3]);
+        double cost = length;
+        if (get_grade1in(footpath) > 0){
+            cost *= 1 + slope_penalty / get_grade1in(footpath);
+        }
+        int ends_of_edge[2] = {start, end};
+        for (int side = 0; side < 2; side++){
+            int edge = next_edge[ends_of_edge[side]]++;
+            graph->targets[edge] = ends_of_edge[1 - side];
+            graph->costs[edge] = cost;
+            graph->lengths[edge] = length;
+            graph->edge_records[edge] = record;
+        }
+    }
+    record_buffer_free(buffer);
+    free(next_edge);
+    free(record_ends);
+    free(ends);
+
+    graph->search_num = 0;
+    graph->reached = calloc(num_junctions + 1, sizeof(int));
+    graph->best_costs = malloc(sizeof(double) * (num_junctions + 1));
+    graph->via_edges = malloc(sizeof(int) * (num_junctions + 1));
+    graph->via_junctions = malloc(sizeof(int) * (num_junctions + 1));
+    graph->open_size = INITIAL_SIZE;
+    graph->num_open = 0;
+    graph->open = malloc(sizeof(open_entry_t) * graph->open_size);
+    assert(graph->reached && graph->best_costs && graph->via_edges &&
+           graph->via_junctions && graph->open);
+    return graph;
+}
+
+
+/* Compare (lon, lat) pairs by longitude then latitude */
+static int coord_cmp(const void *coord1, const void *coord2){
+    const double *c1 = coord1, *c2 = coord2;
+    for (int i = 0; i < 2; i++){
+        if (c1[i] < c2[i]){
+            return SMALLER_THAN;
+        }else if (c1[i] > c2[i]){
+            return GREATER_THAN;
+        }
+    }
+    return EQUALS;
+}
+
+
+/* Number of the junction at the location, or UNDEFINED */
+static int junction_find(route_graph_t *graph, double lon, double lat){
+    double coord[2] = {lon, lat};
+    int low = 0, high = graph->num_junctions - 1;
+    while (low <= high){
+        int mid = (low + high) / 2;
+        double junction[2] = {graph->lons[mid], graph->lats[mid]};
+        int cmp = coord_cmp(coord, junction);
+        if (cmp == EQUALS){
+            return mid;
+        }else if (cmp == SMALLER_THAN){
+            high = mid - 1;
+        }else{
+            low = mid + 1;
+        }
+    }
+    return UNDEFINED;
+}
+
+
+/* Distance through the earth between the junctions */
+static double straight_line(route_graph_t *graph, int junction1,
+                            int junction2){
+    double dx = graph->xs[junction1] - graph->xs[junction2];
+    double dy = graph->ys[junction1] - graph->ys[junction2];
+    double dz = graph->zs[junction1] - graph->zs[junction2];
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+
+/* Length of the footpath, at least the straight line between its ends(some
+records have a distance of 0) */
+static double edge_length(footpath_t *footpath, double start_lon,
+                          double start_lat, double end_lon, double end_lat){
+    double straight = haversine_coords(start_lon, start_lat, end_lon, end_lat);
+    return fmax(get_distance(footpath), straight);
+}
+
+
+/* Output to f the footpaths of the cheapest route between the junctions
+nearest the origin & destination, in order, & the number of footpaths, the
+length & the junctions searched to summary */
+void route_query(route_graph_t *graph, point_t *origin, point_t *destination,
+                 FILE *f, FILE *summary){
+    int from = nearest_junction(graph, origin);
+    int to = nearest_junction(graph, destination);
+    int num_searched = 0;
+    if (from == UNDEFINED || to == UNDEFINED ||
+            !route_search(graph, from, to, &num_searched)){
+        fprintf(summary, " no route, %d junctions searched", num_searched);
+        return;
+    }
+
+    // Walk back from the destination, then output from the origin
+    int num_steps = 0;
+    double length = 0;
+    for (int j = to; j != from; j = graph->via_junctions[j]){
+        num_steps++;
+    }
+    int *steps = malloc(sizeof(int) * (num_steps + 1));
+    assert(steps);
+    int step = num_steps;
+    for (int j = to; j != from; j = graph->via_junctions[j]){
+        steps[--step] = graph->via_edges[j];
+    }
+    footpath_t *buffer = record_buffer_create();
+    for (step = 0; step < num_steps; step++){
+        length += graph->lengths[steps[step]];
+        data_print(record_table_get(graph->table,
+                                    graph->edge_records[steps[step]], buffer),
+                   f);
+    }
+    record_buffer_free(buffer);
+    free(steps);
+    fprintf(summary, " %d footpaths, %.2f m, %d junctions searched",
+            num_steps, length, num_searched);
+}
+
+
+/* Junction of the point in the tree nearest the query, or UNDEFINED if the
+tree is empty */
+static int nearest_junction(route_graph_t *graph, point_t *query){
+    rectangle_t *query_rect = rectangle_create(
+        point_creator(get_lon(query), get_lat(query)),
+        point_creator(get_lon(query), get_lat(query)));
+    data_point_t *nearest = NULL;
+    long double nearest_dist = INFINITY;
+    node_nearest(graph->qtree->root, query, query_rect, &nearest,
+                 &nearest_dist);
+    rectangle_free(query_rect);
+    if (nearest == NULL){
+        return UNDEFINED;
+    }
+    point_t *loc = get_dt_point_loc(nearest);
+    return junction_find(graph, get_lon(loc), get_lat(loc));
+}
+
+
+/* Search the node for a point nearer than nearest_dist, nearest child
+first */
+static void node_nearest(quadtree_node_t *node, point_t *query,
+                         rectangle_t *query_rect, data_point_t **nearest,
+                         long double *nearest_dist){
+    if (is_leaf_node(node)){
+        if (node->dt_point != NULL){
+            long double dist = haversine_distance(query,
+                get_dt_point_loc(node->dt_point));
+            if (dist < *nearest_dist){
+                *nearest_dist = dist;
+                *nearest = node->dt_point;
+            }
+        }
+        return;
+    }
+
+    quadtree_node_t *children[4];
+    long double bounds[4];
+    int num_children = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+        long double bound = rectangle_min_distance(child->rectangle,
+                                                   query_rect);
+        int i = num_children++;
+        while (i > 0 && bounds[i - 1] > bound){
+            children[i] = children[i - 1];
+            bounds[i] = bounds[i - 1];
+            i--;
+        }
+        children[i] = child;
+        bounds[i] = bound;
+    }
+    for (int i = 0; i < num_children; i++){
+        if (bounds[i] >= *nearest_dist){
+            return;
+        }
+        node_nearest(children[i], query, query_rect, nearest, nearest_dist);
+    }
+}
+
+
+/* A* from origin to destination, leaving the best route in via_edges &
+via_junctions. Returns FALSE if there's no route */
+static int route_search(route_graph_t *graph, int origin, int destination,
+                        int *num_searched){
+    int search = ++graph->search_num;
+    graph->num_open = 0;
+    graph->reached[origin] = search;
+    graph->best_costs[origin] = 0;
+    open_push(graph, 0, 0, origin);
+
+    while (graph->num_open > 0){
+        open_entry_t entry = open_pop(graph);
+        int junction = entry.junction;
+        if (entry.cost > graph->best_costs[junction]){
+            continue;   // a cheaper route here was found after this one
+        }
+        (*num_searched)++;
+        if (junction == destination){
+            return TRUE;
+        }
+
+        for (int edge = graph->first_edge[junction];
+                edge < graph->first_edge[junction + 1]; edge++){
+            int target = graph->targets[edge];
+            double cost = entry.cost + graph->costs[edge];
+            if (graph->reached[target] == search &&
+                    cost >= graph->best_costs[target]){
+                continue;
+            }
+            graph->reached[target] = search;
+            graph->best_costs[target] = cost;
+            graph->via_edges[target] = edge;
+            graph->via_junctions[target] = junction;
+            open_push(graph, cost + straight_line(graph, target, destination),
+                      cost, target);
+        }
+    }
+    return FALSE;
+}
+
+
+/* Add a junction to the open heap */
+static void open_push(route_graph_t *graph, double estimate, double cost,
+                      int junction){
+    if (graph->num_open == graph->open_size){
+        graph->open_size *= 2;
+        graph->open = realloc(graph->open,
+                              sizeof(open_entry_t) * graph->open_size);
+        assert(graph->open);
+    }
+    open_entry_t entry = {estimate, cost, junction};
+    int idx = graph->num_open++;
+    while (idx > 0 && graph->open[(idx - 1) / 2].estimate > estimate){
+        graph->open[idx] = graph->open[(idx - 1) / 2];
+        idx = (idx - 1) / 2;
+    }
+    graph->open[idx] = entry;
+}
+
+
+/* Take the junction with the smallest estimate off the open heap */
+static open_entry_t open_pop(route_graph_t *graph){
+    open_entry_t *open = graph->open;
+    open_entry_t top = open[0];
+    open_entry_t last = open[--graph->num_open];
+    int idx = 0;
+    while (TRUE){
+        int child = 2 * idx + 1;
+        if (child >= graph->num_open){
+            break;
+        }
+        if (child + 1 < graph->num_open &&
+                open[child + 1].estimate < open[child].estimate){
+            child++;
+        }
+        if (open[child].estimate >= last.estimate){
+            break;
+        }
+        open[idx] = open[child];
+        idx = child;
+    }
+    open[idx] = last;
+    return top;
+}
+
+
+/* Free the graph(the tree is left alone)*/
+void route_graph_free(route_graph_t *graph){
+    free(graph->lons);
+    free(graph->lats);
+    free(graph->xs);
+    free(graph->ys);
+    free(graph->zs);
+    free(graph->first_edge);
+    free(graph->targets);
+    free(graph->costs);
+    free(graph->lengths);
+    free(graph->edge_records);
+    free(graph->reached);
+    free(graph->best_costs);
+    free(graph->via_edges);
+    free(graph->via_junctions);
+    free(graph->open);
+    free(graph);
+}
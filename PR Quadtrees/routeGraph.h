@@ -0,0 +1,13 @@
+#ifndef _ROUTEGRAPH_H_
+#define _ROUTEGRAPH_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "point2D.h"
+
+typedef struct route_graph route_graph_t;
+
+route_graph_t *route_graph_create(quadtree_t *qtree, double slope_penalty);
+void route_query(route_graph_t *graph, point_t *origin, point_t *destination,
+                 FILE *f, FILE *summary);
+void route_graph_free(route_graph_t *graph);
+#endif
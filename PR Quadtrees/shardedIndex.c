@@ -0,0 +1,667 @@
+/* shardedIndex.c
+*
+* Created by Ke Liao
+*
+* This module splits the area covered by the quad tree into tiles(the
+* quadrants of the tree at a fixed depth) and has a separate worker process
+* build and query the quad tree of each tile. The coordinator process reads
+* the dataset once & sends each record down a pipe to the workers of the
+* tiles holding its points, then talks to the workers over another pair of
+* pipes: point queries are sent to the one shard
+* holding the point, and range queries only to the shards they overlap, with
+* the sorted partial results merged by footpath id. The coordinator walks the
+* levels above the tiles itself, so the directions printed and the records
+* output are the same as for a single quad tree over the whole area.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "footpathInternal.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "shardedIndex.h"
+#include "compressedInput.h"
+#include "usefulConsts.h"
+
+// Requests the coordinator sends to the workers
+#define OP_POINT 0
+#define OP_RANGE 1
+#define OP_QUIT 2
+
+// Walks of the levels above the tiles are done twice for range queries
+#define PHASE_SEND 0
+#define PHASE_RECEIVE 1
+
+// A tile holding two points is always an internal node of the tree
+#define POINT_CAP 2
+
+// Strings of a record, sent down the pipe after its struct
+#define NUM_TEXTS 4
+
+// Fixed size request sent down the pipe to a worker
+typedef struct shard_request{
+    int op;
+    double coords[4];  // point query: lon, lat. range query: l, b, r, t
+} shard_request_t;
+
+// Response of a worker: the directions it printed and the records it found
+typedef struct shard_result{
+    char *trace;
+    uint32_t trace_len;
+    int num_records;
+    int *ids;     // footpath id of each record, sorted
+    char **texts;  // each record as printed to the output file
+} shard_result_t;
+
+// A worker process and the tile it is responsible for
+typedef struct shard{
+    rectangle_t *tile;
+    pid_t pid;
+    int request_fd;   // coordinator writes requests here
+    int response_fd;  // coordinator reads responses here
+    int record_fd;    // coordinator sends the tile's records here, then closes
+    int num_points;   // data points in the tile, capped at POINT_CAP
+    shard_result_t result;
+} shard_t;
+
+struct sharded_index{
+    rectangle_t *bounds;
+    int num_shards;   // always a power of four
+    shard_t *shards;  // tiles in the order the tree is explored(SW NW NE SE)
+};
+
+static const char *quadrant_names[] = {"SW", "NW", "NE", "SE"};
+
+static void tiles_assign(sharded_index_t *index, rectangle_t *cell, int depth,
+                         int *next_tile);
+static void shard_start(sharded_index_t *index, int shard_idx);
+static void shard_worker_run(shard_t *shard);
+static void records_route(sharded_index_t *index, char *input_path);
+static void record_send(FILE *f, footpath_t *record);
+static footpath_t *record_receive(FILE *f);
+static int cell_points(sharded_index_t *index, int first, int span);
+static int single_point_tile(sharded_index_t *index, int first, int span);
+static void range_walk(sharded_index_t *index, rectangle_t *cell, int first,
+                       int span, rectangle_t *query, int phase, FILE *trace);
+static void request_send(shard_t *shard, int op, double *coords, int num);
+static void result_receive(shard_t *shard);
+static void result_clear(shard_result_t *result);
+static void write_full(int fd, const void *buf, size_t len);
+static int read_full(int fd, void *buf, size_t len);
+
+
+/* Create the sharded index over the defined bot_left & top_right points, 
+starting a worker process for each tile. num_shards is rounded up to a power
+of four so the tiles line up with quadrants of the tree */
+sharded_index_t *sharded_index_create(char *input_path, point_t *bot_left,
+                                      point_t *top_right, int num_shards){
+    sharded_index_t *index = malloc(sizeof(*index));
+    assert(index != NULL);
+    index->bounds = rectangle_create(bot_left, top_right);
+
+    int depth = 0;
+    index->num_shards = 1;
+    while (index->num_shards < num_shards){
+        index->num_shards *= 4;
+        depth++;
+    }
+    index->shards = malloc(sizeof(shard_t) * index->num_shards);
+    assert(index->shards != NULL);
+
+    int next_tile = 0;
+    tiles_assign(index, index->bounds, depth, &next_tile);
+
+    // Start all workers before sending any records so the tiles build in
+    // parallel
+    for (int i = 0; i < index->num_shards; i++){
+        shard_start(index, i);
+    }
+    records_route(index, input_path);
+    for (int i = 0; i < index->num_shards; i++){
+        int num_points;
+        int got = read_full(index->shards[i].response_fd, &num_points,
+                            sizeof(num_points));
+        assert(got == TRUE);
+        index->shards[i].num_points = num_points;
+    }
+    return index;
+}
+
+
+/* Search the shards for the point query, printing out associated outputs to
+f & the directions taken to trace */
+void sharded_point_query(sharded_index_t *index, point_t *query, FILE *f,
+                         FILE *trace){
+    if (!in_rectangle(index->bounds, query)){
+        return;
+    }
+
+    // Walk the levels above the tiles like tree_node_query would
+    rectangle_t *cell = index->bounds;
+    int first = 0;
+    int span = index->num_shards;
+    shard_t *target = NULL;
+    int op = OP_POINT;
+    while (target == NULL){
+        int points = cell_points(index, first, span);
+        if (points == 0){
+            break;  // Nothing stored here
+        }else if (points == 1){
+
+            // This cell is a leaf of the tree, output its single data point
+            target = &index->shards[single_point_tile(index, first, span)];
+            op = OP_RANGE;
+        }else if (span == 1){
+            target = &index->shards[first];
+        }else{
+            int quad = determine_quadrant(cell, query);
+            fprintf(trace, " %s", quadrant_names[quad]);
+            span /= 4;
+            first += quad * span;
+            rectangle_t *next_cell = quadrant_assign(cell, quad);
+            if (cell != index->bounds){
+                rectangle_free(cell);
+            }
+            cell = next_cell;
+        }
+    }
+
+    if (target != NULL){
+        if (op == OP_RANGE){
+            // The whole tile covers the point no matter where it is in it
+            point_t *tile_bl = get_bottomleft(target->tile);
+            point_t *tile_tr = get_topright(target->tile);
+            double coords[] = {get_lon(tile_bl), get_lat(tile_bl),
+                               get_lon(tile_tr), get_lat(tile_tr)};
+            request_send(target, OP_RANGE, coords, 4);
+        }else{
+            double coords[] = {get_lon(query), get_lat(query)};
+            request_send(target, OP_POINT, coords, 2);
+        }
+        result_receive(target);
+        fwrite(target->result.trace, 1, target->result.trace_len, trace);
+        for (int i = 0; i < target->result.num_records; i++){
+            fputs(target->result.texts[i], f);
+        }
+        result_clear(&target->result);
+    }
+    if (cell != index->bounds){
+        rectangle_free(cell);
+    }
+}
+
+
+/* Find all footpath records within the query rectangle on the shards that 
+overlap it, and output the merged results to file and directions to trace*/
+void sharded_range_query(sharded_index_t *index, rectangle_t *query, FILE *f,
+                         FILE *trace){
+    if (rectangle_overlap(query, index->bounds) == FALSE){
+        return;
+    }
+    
+    /* Send every request first so the shards search in parallel, then walk
+    again printing directions and collecting the results in order */
+    range_walk(index, index->bounds, 0, index->num_shards, query, PHASE_SEND,
+               trace);
+    range_walk(index, index->bounds, 0, index->num_shards, query,
+               PHASE_RECEIVE, trace);
+
+    // Merge the sorted results, records in more than one tile output once
+    int *next = calloc(index->num_shards, sizeof(int));
+    assert(next != NULL);
+    int last_id = 0;
+    int any_written = FALSE;
+    while (TRUE){
+        int best = UNDEFINED;
+        for (int i = 0; i < index->num_shards; i++){
+            shard_result_t *result = &index->shards[i].result;
+            if (next[i] == result->num_records){
+                continue;
+            }
+            if (best == UNDEFINED || result->ids[next[i]] <
+                    index->shards[best].result.ids[next[best]]){
+                best = i;
+            }
+        }
+        if (best == UNDEFINED){
+            break;
+        }
+
+        shard_result_t *result = &index->shards[best].result;
+        int id = result->ids[next[best]];
+        if (!any_written || id != last_id){
+            fputs(result->texts[next[best]], f);
+            last_id = id;
+            any_written = TRUE;
+        }
+        next[best]++;
+    }
+
+    for (int i = 0; i < index->num_shards; i++){
+        result_clear(&index->shards[i].result);
+    }
+    free(next);
+}
+
+
+/* Stop the workers and free the sharded index */
+void sharded_index_free(sharded_index_t *index){
+    for (int i = 0; i < index->num_shards; i++){
+        shard_t *shard = &index->shards[i];
+        request_send(shard, OP_QUIT, NULL, 0);
+        close(shard->request_fd);
+        close(shard->response_fd);
+        waitpid(shard->pid, NULL, 0);
+        rectangle_free(shard->tile);
+    }
+    free(index->shards);
+    rectangle_free(index->bounds);
+    free(index);
+}
+
+
+/* Assign the quadrants depth levels below cell to the shards, in the order 
+the tree is explored */
+static void tiles_assign(sharded_index_t *index, rectangle_t *cell, int depth,
+                         int *next_tile){
+    if (depth == 0){
+        point_t *bot_left = get_bottomleft(cell);
+        point_t *top_right = get_topright(cell);
+        shard_t *shard = &index->shards[*next_tile];
+        shard->tile = rectangle_create(
+            point_creator(get_lon(bot_left), get_lat(bot_left)),
+            point_creator(get_lon(top_right), get_lat(top_right)));
+        shard->result.num_records = 0;
+        shard->result.trace_len = 0;
+        shard->result.trace = NULL;
+        shard->result.ids = NULL;
+        shard->result.texts = NULL;
+        (*next_tile)++;
+        return;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        rectangle_t *quadrant = quadrant_assign(cell, quad);
+        tiles_assign(index, quadrant, depth - 1, next_tile);
+        rectangle_free(quadrant);
+    }
+}
+
+
+/* Fork the worker process of a shard and connect it with pipes */
+static void shard_start(sharded_index_t *index, int shard_idx){
+    shard_t *shard = &index->shards[shard_idx];
+    int request_pipe[2], response_pipe[2], record_pipe[2];
+    int ok = (pipe(request_pipe) == 0) && (pipe(response_pipe) == 0) &&
+             (pipe(record_pipe) == 0);
+    assert(ok);
+
+    fflush(NULL);  // Otherwise buffered output would be written twice
+    shard->pid = fork();
+    assert(shard->pid >= 0);
+    if (shard->pid == 0){
+        
+        // Worker doesn't need the pipes of the shards started before it
+        for (int i = 0; i < shard_idx; i++){
+            close(index->shards[i].request_fd);
+            close(index->shards[i].response_fd);
+            close(index->shards[i].record_fd);
+        }
+        close(request_pipe[1]);
+        close(response_pipe[0]);
+        close(record_pipe[1]);
+        shard->request_fd = request_pipe[0];
+        shard->response_fd = response_pipe[1];
+        shard->record_fd = record_pipe[0];
+        shard_worker_run(shard);
+        _exit(EXIT_SUCCESS);  // Don't flush stdio buffers of the coordinator
+    }
+
+    close(request_pipe[0]);
+    close(response_pipe[1]);
+    close(record_pipe[0]);
+    shard->request_fd = request_pipe[1];
+    shard->response_fd = response_pipe[0];
+    shard->record_fd = record_pipe[1];
+}
+
+
+/* Read the dataset once, sending each record to the shards whose tile holds
+one of its points. Closing the pipes tells the workers they have them all */
+static void records_route(sharded_index_t *index, char *input_path){
+    FILE *input_file = compressed_input_open(input_path);
+    assert(input_file != NULL);
+    FILE **streams = malloc(sizeof(FILE*) * index->num_shards);
+    assert(streams != NULL);
+    for (int i = 0; i < index->num_shards; i++){
+        streams[i] = fdopen(index->shards[i].record_fd, "w");
+        assert(streams[i] != NULL);
+    }
+
+    // Skip the first line as headers don't contain data
+    int a;
+    while((a = fgetc(input_file)) != '\n' && a != EOF){}
+
+    footpath_t *record;
+    while((record = footpath_read(input_file)) != NULL){
+        point_t *start_point = get_start_point(record);
+        point_t *end_point = get_end_point(record);
+        for (int i = 0; i < index->num_shards; i++){
+            if (in_rectangle(index->shards[i].tile, start_point) ||
+                    in_rectangle(index->shards[i].tile, end_point)){
+                record_send(streams[i], record);
+            }
+        }
+        point_free(start_point);
+        point_free(end_point);
+        data_free(record);
+    }
+    fclose(input_file);
+
+    for (int i = 0; i < index->num_shards; i++){
+        fclose(streams[i]);
+    }
+    free(streams);
+}
+
+
+/* Write the record down the pipe: the struct as is, then each string with
+its length. Both ends are the same program, so the layout matches */
+static void record_send(FILE *f, footpath_t *record){
+    fwrite(record, sizeof(*record), 1, f);
+    char *texts[] = {record->address, record->clue_sa, record->asset_type,
+                     record->segside};
+    for (int i = 0; i < NUM_TEXTS; i++){
+        uint32_t len = strlen(texts[i]);
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(texts[i], 1, len, f);
+    }
+}
+
+
+/* Read a record sent by record_send, or NULL once the pipe is closed */
+static footpath_t *record_receive(FILE *f){
+    footpath_t *record = malloc(sizeof(*record));
+    assert(record != NULL);
+    if (fread(record, sizeof(*record), 1, f) != 1){
+        free(record);
+        return NULL;
+    }
+    char **texts[] = {&record->address, &record->clue_sa,
+                      &record->asset_type, &record->segside};
+    for (int i = 0; i < NUM_TEXTS; i++){
+        uint32_t len;
+        int got = fread(&len, sizeof(len), 1, f) == 1;
+        *texts[i] = malloc(len + 1);
+        assert(got && *texts[i] != NULL);
+        got = fread(*texts[i], 1, len, f) == len;
+        assert(got);
+        (*texts[i])[len] = '\0';
+    }
+    return record;
+}
+
+
+/* Body of a worker: build the tree over its tile from the records the 
+coordinator sends, then answer requests until told to quit */
+static void shard_worker_run(shard_t *shard){
+    FILE *record_stream = fdopen(shard->record_fd, "r");
+    assert(record_stream != NULL);
+    point_t *tile_bl = get_bottomleft(shard->tile);
+    point_t *tile_tr = get_topright(shard->tile);
+    record_table_t *records = record_table_create();
+    quadtree_t *quadtree = tree_create(records,
+        point_creator(get_lon(tile_bl), get_lat(tile_bl)),
+        point_creator(get_lon(tile_tr), get_lat(tile_tr)));
+
+    // Only the records this shard is responsible for are sent
+    footpath_t *record;
+    while((record = record_receive(record_stream)) != NULL){
+        add_record(quadtree, record_table_add(records, record));
+    }
+    fclose(record_stream);
+
+    int num_points = tree_count_points(get_root(quadtree), POINT_CAP);
+    write_full(shard->response_fd, &num_points, sizeof(num_points));
+
+    shard_request_t request;
+    while (read_full(shard->request_fd, &request, sizeof(request)) == TRUE){
+        if (request.op == OP_QUIT){
+            break;
+        }
+
+        // Directions printed by the tree are captured to send back
+        char *trace = NULL;
+        size_t trace_len = 0;
+        FILE *trace_stream = open_memstream(&trace, &trace_len);
+        assert(trace_stream != NULL);
+
+        int num_records = 0;
+        int *ids = NULL;
+        char **texts = NULL;
+        size_t *text_lens = NULL;
+        if (request.op == OP_POINT){
+
+            // The leaf's output is passed back as a single piece
+            point_t *query = point_creator(request.coords[0],
+                                           request.coords[1]);
+            num_records = 1;
+            ids = calloc(1, sizeof(int));
+            texts = calloc(1, sizeof(char*));
+            text_lens = calloc(1, sizeof(size_t));
+            assert(ids != NULL && texts != NULL && text_lens != NULL);
+            FILE *text = open_memstream(&texts[0], &text_lens[0]);
+            tree_query(quadtree, query, text, trace_stream);
+            fclose(text);
+            point_free(query);
+        }else{
+            rectangle_t *query = rectangle_create(
+                point_creator(request.coords[0], request.coords[1]),
+                point_creator(request.coords[2], request.coords[3]));
+            matched_records_t *matched = record_struct_create(records);
+            range_query(get_root(quadtree), query, matched, trace_stream);
+            num_records = matched_record_count(matched);
+            ids = malloc(sizeof(int) * (num_records + 1));
+            texts = malloc(sizeof(char*) * (num_records + 1));
+            text_lens = malloc(sizeof(size_t) * (num_records + 1));
+            assert(ids != NULL && texts != NULL && text_lens != NULL);
+            footpath_t *buffer = record_buffer_create();
+            for (int i = 0; i < num_records; i++){
+                footpath_t *found = matched_record_get(matched, i, buffer);
+                ids[i] = get_footpath_id(found);
+                FILE *text = open_memstream(&texts[i], &text_lens[i]);
+                data_print(found, text);
+                fclose(text);
+            }
+            record_buffer_free(buffer);
+            matched_record_struct_free(matched);
+            rectangle_free(query);
+        }
+        fclose(trace_stream);
+
+        // Response: trace, number of records, then each id & text
+        uint32_t len = trace_len;
+        write_full(shard->response_fd, &len, sizeof(len));
+        write_full(shard->response_fd, trace, trace_len);
+        write_full(shard->response_fd, &num_records, sizeof(num_records));
+        for (int i = 0; i < num_records; i++){
+            len = text_lens[i];
+            write_full(shard->response_fd, &ids[i], sizeof(int));
+            write_full(shard->response_fd, &len, sizeof(len));
+            write_full(shard->response_fd, texts[i], text_lens[i]);
+            free(texts[i]);
+        }
+        free(trace);
+        free(ids);
+        free(texts);
+        free(text_lens);
+    }
+
+    free_quad_tree(quadtree);
+    record_table_free(records);
+    close(shard->request_fd);
+    close(shard->response_fd);
+}
+
+
+/* Number of data points(capped) in the cell made of tiles first to 
+first + span - 1 */
+static int cell_points(sharded_index_t *index, int first, int span){
+    int points = 0;
+    for (int i = first; i < first + span && points < POINT_CAP; i++){
+        points += index->shards[i].num_points;
+    }
+    return points < POINT_CAP ? points : POINT_CAP;
+}
+
+
+/* Find the one tile of the cell which holds a data point */
+static int single_point_tile(sharded_index_t *index, int first, int span){
+    for (int i = first; i < first + span; i++){
+        if (index->shards[i].num_points > 0){
+            return i;
+        }
+    }
+    return UNDEFINED;
+}
+
+
+/* Walk the levels above the tiles like range_query would. Requests are sent
+to the shards reached in the send phase, the receive phase prints directions 
+to trace and reads the responses in the same order*/
+static void range_walk(sharded_index_t *index, rectangle_t *cell, int first,
+                       int span, rectangle_t *query, int phase, FILE *trace){
+    int points = cell_points(index, first, span);
+    if (points == 0){
+        return;
+    }
+
+    if (points == 1 || span == 1){
+        
+        // Leaf of the tree or a tile: the shard finishes the search
+        int target_idx = first;
+        if (points == 1){
+            target_idx = single_point_tile(index, first, span);
+        }
+        shard_t *target = &index->shards[target_idx];
+        if (phase == PHASE_SEND){
+            double coords[] = {get_lon(get_bottomleft(query)),
+                               get_lat(get_bottomleft(query)),
+                               get_lon(get_topright(query)),
+                               get_lat(get_topright(query))};
+            request_send(target, OP_RANGE, coords, 4);
+        }else{
+            result_receive(target);
+            fwrite(target->result.trace, 1, target->result.trace_len, trace);
+        }
+        return;
+    }
+
+    // Explore quadrants which hold points and overlap
+    span /= 4;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        int child_first = first + quad * span;
+        if (cell_points(index, child_first, span) == 0){
+            continue;
+        }
+        rectangle_t *quadrant = quadrant_assign(cell, quad);
+        if (rectangle_overlap(query, quadrant) == TRUE){
+            if (phase == PHASE_RECEIVE){
+                fprintf(trace, " %s", quadrant_names[quad]);
+            }
+            range_walk(index, quadrant, child_first, span, query, phase,
+                       trace);
+        }
+        rectangle_free(quadrant);
+    }
+}
+
+
+/* Send a request to the worker of a shard */
+static void request_send(shard_t *shard, int op, double *coords, int num){
+    shard_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    for (int i = 0; i < num; i++){
+        request.coords[i] = coords[i];
+    }
+    write_full(shard->request_fd, &request, sizeof(request));
+}
+
+
+/* Read the response of a worker into the shard's result */
+static void result_receive(shard_t *shard){
+    shard_result_t *result = &shard->result;
+    int got = read_full(shard->response_fd, &result->trace_len, 
+                        sizeof(uint32_t));
+    assert(got == TRUE);
+    result->trace = malloc(result->trace_len + 1);
+    assert(result->trace != NULL);
+    read_full(shard->response_fd, result->trace, result->trace_len);
+
+    read_full(shard->response_fd, &result->num_records, sizeof(int));
+    result->ids = malloc(sizeof(int) * (result->num_records + 1));
+    result->texts = malloc(sizeof(char*) * (result->num_records + 1));
+    assert(result->ids != NULL && result->texts != NULL);
+    for (int i = 0; i < result->num_records; i++){
+        uint32_t len;
+        read_full(shard->response_fd, &result->ids[i], sizeof(int));
+        read_full(shard->response_fd, &len, sizeof(len));
+        result->texts[i] = malloc(len + 1);
+        assert(result->texts[i] != NULL);
+        read_full(shard->response_fd, result->texts[i], len);
+        result->texts[i][len] = '\0';
+    }
+}
+
+
+/* Free the contents of a result so the shard can take the next query */
+static void result_clear(shard_result_t *result){
+    for (int i = 0; i < result->num_records; i++){
+        free(result->texts[i]);
+    }
+    free(result->trace);
+    free(result->ids);
+    free(result->texts);
+    result->trace = NULL;
+    result->ids = NULL;
+    result->texts = NULL;
+    result->trace_len = 0;
+    result->num_records = 0;
+}
+
+
+/* Write all len bytes to the pipe */
+static void write_full(int fd, const void *buf, size_t len){
+    const char *pos = buf;
+    while (len > 0){
+        ssize_t written = write(fd, pos, len);
+        assert(written > 0);
+        pos += written;
+        len -= written;
+    }
+}
+
+
+/* Read exactly len bytes from the pipe. Returns FALSE if the pipe closed */
+static int read_full(int fd, void *buf, size_t len){
+    char *pos = buf;
+    while (len > 0){
+        ssize_t got = read(fd, pos, len);
+        if (got <= 0){
+            return FALSE;
+        }
+        pos += got;
+        len -= got;
+    }
+    return TRUE;
+}
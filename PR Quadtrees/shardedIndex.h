@@ -0,0 +1,16 @@
+#ifndef _SHARDEDINDEX_H_
+#define _SHARDEDINDEX_H_
+#include <stdio.h>
+#include "point2D.h"
+#include "rectangle.h"
+
+typedef struct sharded_index sharded_index_t;
+
+sharded_index_t *sharded_index_create(char *input_path, point_t *bot_left,
+                                      point_t *top_right, int num_shards);
+void sharded_point_query(sharded_index_t *index, point_t *query, FILE *f,
+                         FILE *trace);
+void sharded_range_query(sharded_index_t *index, rectangle_t *query, FILE *f,
+                         FILE *trace);
+void sharded_index_free(sharded_index_t *index);
+#endif
@@ -0,0 +1,359 @@
+/* spatialIndex.c
+*
+* Created by Ke Liao
+*
+* This module puts the point, range & k nearest neighbour searches behind 
+* one interface, so the index the records are held in can be chosen when 
+* the program is run. Every backend gives the same results: the point 
+* search finds the records with a point exactly at the query, the range 
+* search those with a point in the rectangle(by the rule of in_rectangle) 
+* and the k nearest neighbour search the records at the k closest distinct
+* locations(by haversine distance, ties going to the smaller longitude then
+* latitude).
+*
+* It also holds what is shared by the backends: the distinct locations of 
+* the records & the list of nearest neighbours found so far.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "spatialIndex.h"
+#include "spatialIndexInternal.h"
+#include "quadTreeIndex.h"
+#include "rTree.h"
+#include "gridIndex.h"
+#include "kdTree.h"
+#include "usefulConsts.h"
+
+struct spatial_index{
+    const index_backend_t *backend;
+    void *index;
+    index_points_t *points;
+    rectangle_t *area;
+    long double max_abs_lat;   // furthest latitude of the area
+};
+
+// A record's point, while the distinct locations are worked out
+typedef struct point_entry{
+    long double lon;
+    long double lat;
+    int footpath_id;
+    record_id_t record;
+} point_entry_t;
+
+static const index_backend_t *backends[] = {&quadtree_backend, 
+    &rtree_backend, &grid_backend, &kdtree_backend};
+
+
+static index_points_t *index_points_create(record_table_t *table,
+                                           rectangle_t *area);
+static void index_points_free(index_points_t *points);
+static int point_entry_cmp(const void *entry1, const void *entry2);
+static int neighbour_cmp(const void *neighbour1, const void *neighbour2);
+static void heap_sift_down(knn_result_t *result, int idx);
+static void heap_sift_up(knn_result_t *result, int idx);
+
+
+/* Create the index named backend over the records of the table in the area. 
+Returns NULL if there's no backend with that name */
+spatial_index_t *spatial_index_create(const char *backend, 
+                                      record_table_t *table, 
+                                      point_t *bot_left, point_t *top_right){
+    const index_backend_t *chosen = NULL;
+    for (int i = 0; i < spatial_backend_count(); i++){
+        if (strcmp(backends[i]->name, backend) == 0){
+            chosen = backends[i];
+        }
+    }
+    if (chosen == NULL){
+        return NULL;
+    }
+
+    spatial_index_t *index = malloc(sizeof(*index));
+    assert(index != NULL);
+    index->backend = chosen;
+    index->area = rectangle_create(bot_left, top_right);
+    index->max_abs_lat = fabsl(get_lat(bot_left));
+    if (fabsl(get_lat(top_right)) > index->max_abs_lat){
+        index->max_abs_lat = fabsl(get_lat(top_right));
+    }
+    index->points = index_points_create(table, index->area);
+    index->index = chosen->create(table, index->points, index->area);
+    return index;
+}
+
+
+/* Add the records with a point exactly at the query to matches */
+void spatial_point_query(spatial_index_t *index, point_t *query,
+                         matched_records_t *matches){
+    index->backend->point_query(index->index, query, matches);
+}
+
+
+/* Add the records with a point in the query rectangle to matches */
+void spatial_range_query(spatial_index_t *index, rectangle_t *query,
+                         matched_records_t *matches){
+    index->backend->range_query(index->index, query, matches);
+}
+
+
+/* Find the k locations nearest to the query, sorted nearest first */
+knn_result_t *spatial_knn_query(spatial_index_t *index, point_t *query, 
+                                int k){
+    knn_result_t *result = malloc(sizeof(*result));
+    assert(result != NULL);
+    result->k = k;
+    result->num_found = 0;
+    result->heap = malloc(sizeof(knn_neighbour_t) * (k + 1));
+    assert(result->heap != NULL);
+    result->max_abs_lat = index->max_abs_lat;
+    if (fabsl(get_lat(query)) > result->max_abs_lat){
+        result->max_abs_lat = fabsl(get_lat(query));
+    }
+
+    if (k > 0){
+        index->backend->knn_query(index->index, query, result);
+    }
+    qsort(result->heap, result->num_found, sizeof(knn_neighbour_t),
+          neighbour_cmp);
+    return result;
+}
+
+
+/* Free the index, the record table isn't touched */
+void spatial_index_free(spatial_index_t *index){
+    index->backend->free(index->index);
+    index_points_free(index->points);
+    rectangle_free(index->area);
+    free(index);
+}
+
+
+/* Number of backends to choose from */
+int spatial_backend_count(void){
+    return sizeof(backends) / sizeof(backends[0]);
+}
+
+
+/* Name of the backend numbered backend */
+const char *spatial_backend_name(int backend){
+    return backends[backend]->name;
+}
+
+
+/* Number of locations found by the k nearest neighbour search */
+int knn_result_count(knn_result_t *result){
+    return result->num_found;
+}
+
+
+/* Distance in metres of the idx-th nearest location */
+long double knn_result_distance(knn_result_t *result, int idx){
+    return result->heap[idx].dist;
+}
+
+
+/* Output the records of each location found, nearest first */
+void knn_result_output(knn_result_t *result, record_table_t *table, FILE *f){
+    footpath_t *buffer = record_buffer_create();
+    for (int i = 0; i < result->num_found; i++){
+        for (int j = 0; j < result->heap[i].num_records; j++){
+            data_print(record_table_get(table, result->heap[i].records[j],
+                                        buffer), f);
+        }
+    }
+    record_buffer_free(buffer);
+}
+
+
+/* Free the result of a k nearest neighbour search */
+void knn_result_free(knn_result_t *result){
+    free(result->heap);
+    free(result);
+}
+
+
+/* Add a location to the nearest found if it's nearer than the furthest */
+void knn_offer(knn_result_t *result, long double dist, long double lon,
+               long double lat, record_id_t *records, int num_records){
+    knn_neighbour_t neighbour = {dist, lon, lat, records, num_records};
+    if (result->num_found < result->k){
+        result->heap[result->num_found] = neighbour;
+        heap_sift_up(result, result->num_found);
+        result->num_found++;
+    }else if (neighbour_cmp(&neighbour, &result->heap[0]) == SMALLER_THAN){
+        result->heap[0] = neighbour;
+        heap_sift_down(result, 0);
+    }
+}
+
+
+/* Distance a location must be within to be added, infinite until k are 
+found. Parts of an index further away than this can be skipped */
+long double knn_bound(knn_result_t *result){
+    if (result->num_found < result->k){
+        return INFINITY;
+    }
+    return result->heap[0].dist;
+}
+
+
+/* Add the records of the location to matches */
+void point_records_match(index_points_t *points, int point,
+                         matched_records_t *matches){
+    for (int i = points->first_record[point]; 
+            i < points->first_record[point + 1]; i++){
+        matched_record_insert(matches, points->records[i]);
+    }
+}
+
+
+/* Group the start & end points of the records in the area by location */
+static index_points_t *index_points_create(record_table_t *table,
+                                           rectangle_t *area){
+    int num_records = record_table_size(table);
+    point_entry_t *entries = malloc(sizeof(point_entry_t) * 
+                                    (2 * num_records + 1));
+    assert(entries != NULL);
+    int num_entries = 0;
+    footpath_t *buffer = record_buffer_create();
+    for (int record = 0; record < num_records; record++){
+        footpath_t *footpath = record_table_get(table, record, buffer);
+        point_t *ends[] = {get_start_point(footpath), 
+                           get_end_point(footpath)};
+        for (int i = 0; i < 2; i++){
+            if (in_rectangle(area, ends[i])){
+                point_entry_t *entry = &entries[num_entries++];
+                entry->lon = get_lon(ends[i]);
+                entry->lat = get_lat(ends[i]);
+                entry->footpath_id = get_footpath_id(footpath);
+                entry->record = record;
+            }
+            point_free(ends[i]);
+        }
+    }
+    record_buffer_free(buffer);
+    qsort(entries, num_entries, sizeof(point_entry_t), point_entry_cmp);
+
+    index_points_t *points = malloc(sizeof(*points));
+    assert(points != NULL);
+    points->lons = malloc(sizeof(long double) * (num_entries + 1));
+    points->lats = malloc(sizeof(long double) * (num_entries + 1));
+    points->first_record = malloc(sizeof(int) * (num_entries + 1));
+    points->records = malloc(sizeof(record_id_t) * (num_entries + 1));
+    assert(points->lons != NULL && points->lats != NULL);
+    assert(points->first_record != NULL && points->records != NULL);
+
+    int num_points = 0, num_stored = 0;
+    for (int i = 0; i < num_entries; i++){
+        int new_point = (i == 0 || entries[i].lon != entries[i - 1].lon ||
+                         entries[i].lat != entries[i - 1].lat);
+        if (new_point){
+            points->lons[num_points] = entries[i].lon;
+            points->lats[num_points] = entries[i].lat;
+            points->first_record[num_points] = num_stored;
+            num_points++;
+        }else if (entries[i].footpath_id == entries[i - 1].footpath_id){
+            continue;   // don't store duplicates
+        }
+        points->records[num_stored++] = entries[i].record;
+    }
+    points->first_record[num_points] = num_stored;
+    points->num_points = num_points;
+    free(entries);
+    return points;
+}
+
+
+/* Free the locations */
+static void index_points_free(index_points_t *points){
+    free(points->lons);
+    free(points->lats);
+    free(points->first_record);
+    free(points->records);
+    free(points);
+}
+
+
+/* Order record points by location then footpath id */
+static int point_entry_cmp(const void *entry1, const void *entry2){
+    const point_entry_t *point1 = entry1;
+    const point_entry_t *point2 = entry2;
+    if (point1->lon != point2->lon){
+        return point1->lon < point2->lon ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (point1->lat != point2->lat){
+        return point1->lat < point2->lat ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (point1->footpath_id != point2->footpath_id){
+        return point1->footpath_id < point2->footpath_id ? SMALLER_THAN : 
+               GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Order neighbours by distance, then longitude, then latitude */
+static int neighbour_cmp(const void *neighbour1, const void *neighbour2){
+    const knn_neighbour_t *near1 = neighbour1;
+    const knn_neighbour_t *near2 = neighbour2;
+    if (near1->dist != near2->dist){
+        return near1->dist < near2->dist ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (near1->lon != near2->lon){
+        return near1->lon < near2->lon ? SMALLER_THAN : GREATER_THAN;
+    }
+    if (near1->lat != near2->lat){
+        return near1->lat < near2->lat ? SMALLER_THAN : GREATER_THAN;
+    }
+    return EQUALS;
+}
+
+
+/* Move the neighbour at idx down the heap until it's further than both of 
+its children */
+static void heap_sift_down(knn_result_t *result, int idx){
+    knn_neighbour_t *heap = result->heap;
+    while (TRUE){
+        int furthest = idx;
+        for (int child = 2 * idx + 1; child <= 2 * idx + 2; child++){
+            if (child < result->num_found && 
+                    neighbour_cmp(&heap[child], &heap[furthest]) == 
+                    GREATER_THAN){
+                furthest = child;
+            }
+        }
+        if (furthest == idx){
+            return;
+        }
+        knn_neighbour_t temp = heap[idx];
+        heap[idx] = heap[furthest];
+        heap[furthest] = temp;
+        idx = furthest;
+    }
+}
+
+
+/* Move the neighbour at idx up the heap until it's nearer than its parent */
+static void heap_sift_up(knn_result_t *result, int idx){
+    knn_neighbour_t *heap = result->heap;
+    while (idx > 0){
+        int parent = (idx - 1) / 2;
+        if (neighbour_cmp(&heap[idx], &heap[parent]) != GREATER_THAN){
+            return;
+        }
+        knn_neighbour_t temp = heap[idx];
+        heap[idx] = heap[parent];
+        heap[parent] = temp;
+        idx = parent;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef _SPATIALINDEX_H_
+#define _SPATIALINDEX_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "recordTable.h"
+#include "rectangle.h"
+
+#define QUADTREE_INDEX "quadtree"
+
+typedef struct spatial_index spatial_index_t;
+typedef struct knn_result knn_result_t;
+
+spatial_index_t *spatial_index_create(const char *backend, 
+                                      record_table_t *table, 
+                                      point_t *bot_left, point_t *top_right);
+void spatial_point_query(spatial_index_t *index, point_t *query,
+                         matched_records_t *matches);
+void spatial_range_query(spatial_index_t *index, rectangle_t *query,
+                         matched_records_t *matches);
+knn_result_t *spatial_knn_query(spatial_index_t *index, point_t *query, 
+                                int k);
+void spatial_index_free(spatial_index_t *index);
+int spatial_backend_count(void);
+const char *spatial_backend_name(int backend);
+
+int knn_result_count(knn_result_t *result);
+long double knn_result_distance(knn_result_t *result, int idx);
+void knn_result_output(knn_result_t *result, record_table_t *table, FILE *f);
+void knn_result_free(knn_result_t *result);
+#endif
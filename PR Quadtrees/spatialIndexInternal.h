@@ -0,0 +1,55 @@
+#ifndef _SPATIALINDEXINTERNAL_H_
+#define _SPATIALINDEXINTERNAL_H_
+#include "quadTree.h"
+#include "recordTable.h"
+#include "rectangle.h"
+#include "spatialIndex.h"
+
+/* Layout shared by the index backends, which all work off the distinct 
+locations of the records */
+
+// Distinct locations in the area, with the records having a point at each
+typedef struct index_points{
+    int num_points;
+    long double *lons;
+    long double *lats;
+    int *first_record;   // records of point i: first_record[i] to [i + 1] - 1
+    record_id_t *records;   // sorted by footpath id within each point
+} index_points_t;
+
+// Operations every backend provides
+typedef struct index_backend{
+    const char *name;
+    void *(*create)(record_table_t *table, index_points_t *points,
+                    rectangle_t *area);
+    void (*point_query)(void *index, point_t *query, 
+                        matched_records_t *matches);
+    void (*range_query)(void *index, rectangle_t *query,
+                        matched_records_t *matches);
+    void (*knn_query)(void *index, point_t *query, knn_result_t *result);
+    void (*free)(void *index);
+} index_backend_t;
+
+// One of the nearest locations found so far
+typedef struct knn_neighbour{
+    long double dist;
+    long double lon;
+    long double lat;
+    record_id_t *records;
+    int num_records;
+} knn_neighbour_t;
+
+// The k nearest locations found so far, kept as a heap with the furthest first
+struct knn_result{
+    int k;
+    int num_found;
+    knn_neighbour_t *heap;
+    long double max_abs_lat;   // furthest latitude of the area & query
+};
+
+void knn_offer(knn_result_t *result, long double dist, long double lon,
+               long double lat, record_id_t *records, int num_records);
+long double knn_bound(knn_result_t *result);
+void point_records_match(index_points_t *points, int point,
+                         matched_records_t *matches);
+#endif
@@ -0,0 +1,27 @@
+#!/bin/sh
+# With a tolerance of 0 the approximate count must be exact: the number of
+# footpaths mode 4 outputs for the same region.
+
+cd "$(dirname "$0")/.." || exit 1
+DATA=example/dataset_1000.csv
+AREA="144.9375 -37.8750 145.0000 -37.6875"
+RANGES=example/example_region_input2.in
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+./pointSearcher 4 $DATA "$DIR/range.out" $AREA < $RANGES > /dev/null ||
+    exit 1
+awk '!/^-->/ { if (n != "") print n; n = 0; next } { n++ }
+     END { print n }' "$DIR/range.out" > "$DIR/expected"
+
+sed 's/$/ 0/' $RANGES | ./pointSearcher 13 $DATA "$DIR/approx.out" $AREA \
+    > /dev/null || exit 1
+awk '/^--> estimate:/ { printf "%d\n", $3 }' "$DIR/approx.out" \
+    > "$DIR/estimated"
+
+if [ ! -s "$DIR/expected" ] || ! cmp -s "$DIR/expected" "$DIR/estimated"
+then
+    echo "FAIL approx_count_exact: tolerance 0 counts differ from mode 4"
+    exit 1
+fi
+echo "ok approx_count_exact ($(wc -l < "$DIR/expected") queries)"
@@ -0,0 +1,28 @@
+#!/bin/sh
+# The index benchmark's range query counts must be the number of records
+# mode 4 outputs for the same queries.
+
+cd "$(dirname "$0")/.." || exit 1
+DATA=example/dataset_1000.csv
+AREA="144.9375 -37.8750 145.0000 -37.6875"
+POINTS=example/example_point_input2.in
+RANGES=example/example_region_input2.in
+OUT=$(mktemp)
+trap 'rm -f "$OUT"' EXIT
+
+./pointSearcher 4 $DATA "$OUT" $AREA < $RANGES > /dev/null || exit 1
+expected=$(grep -c '^-->' "$OUT")
+
+./indexBenchmark $DATA $AREA $POINTS $RANGES 10 > "$OUT" || exit 1
+status=0
+while read -r index build memory point_us point_found range_us range_found \
+        rest; do
+    [ "$index" = index ] && continue
+    if [ "$range_found" != "$expected" ]; then
+        echo "FAIL benchmark_counts: $index found $range_found," \
+             "mode 4 found $expected"
+        status=1
+    fi
+done < "$OUT"
+[ $status -eq 0 ] && echo "ok benchmark_counts ($expected records)"
+exit $status
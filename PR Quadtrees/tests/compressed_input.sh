@@ -0,0 +1,42 @@
+#!/bin/sh
+# A gzip file, whole or as several members one after another, must give the
+# same output as the plain file, and a gzip file cut short must end the
+# program with failure & say why.
+
+cd "$(dirname "$0")/.." || exit 1
+DATA=example/dataset_1000.csv
+QUERIES=example/example_region_input2.in
+AREA="144.9375 -37.8750 145.0000 -37.6875"
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+gzip -c $DATA > "$DIR/whole.csv.gz"
+LINES=$(wc -l < $DATA)
+head -n $((LINES / 2)) $DATA | gzip -c > "$DIR/multi.csv.gz"
+tail -n +$((LINES / 2 + 1)) $DATA | gzip -c >> "$DIR/multi.csv.gz"
+SIZE=$(wc -c < "$DIR/whole.csv.gz")
+head -c $((SIZE / 2)) "$DIR/whole.csv.gz" > "$DIR/cut.csv.gz"
+
+status=0
+./pointSearcher 4 $DATA "$DIR/plain.out" $AREA < $QUERIES \
+    > "$DIR/plain.txt" || exit 1
+for input in whole multi; do
+    ./pointSearcher 4 "$DIR/$input.csv.gz" "$DIR/$input.out" $AREA \
+        < $QUERIES > "$DIR/$input.txt"
+    if [ $? -ne 0 ] || ! cmp -s "$DIR/plain.out" "$DIR/$input.out" ||
+            ! cmp -s "$DIR/plain.txt" "$DIR/$input.txt"; then
+        echo "FAIL compressed_input: $input gzip output differs"
+        status=1
+    fi
+done
+
+if ./pointSearcher 4 "$DIR/cut.csv.gz" "$DIR/cut.out" $AREA < $QUERIES \
+        > /dev/null 2> "$DIR/cut.err"; then
+    echo "FAIL compressed_input: cut short gzip exited with success"
+    status=1
+elif ! grep -q "corrupt or cut short" "$DIR/cut.err"; then
+    echo "FAIL compressed_input: cut short gzip wasn't reported"
+    status=1
+fi
+[ $status -eq 0 ] && echo "ok compressed_input"
+exit $status
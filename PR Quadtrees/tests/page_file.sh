@@ -0,0 +1,35 @@
+#!/bin/sh
+# Searching the page file, both as it is written with --disk and reopened
+# with --open-disk, must give the same output as the tree in memory.
+
+cd "$(dirname "$0")/.." || exit 1
+DATA=example/dataset_1000.csv
+AREA="144.9375 -37.8750 145.0000 -37.6875"
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+status=0
+for stage in 3 4; do
+    if [ $stage -eq 3 ]; then
+        QUERIES=example/example_point_input2.in
+    else
+        QUERIES=example/example_region_input2.in
+    fi
+    ./pointSearcher $stage $DATA "$DIR/tree.out" $AREA < $QUERIES \
+        > "$DIR/tree.txt" || exit 1
+    ./pointSearcher $stage $DATA "$DIR/disk.out" $AREA \
+        --disk="$DIR/pages" < $QUERIES > "$DIR/disk.txt" 2> /dev/null ||
+        exit 1
+    ./pointSearcher $stage missing.csv "$DIR/open.out" $AREA \
+        --open-disk="$DIR/pages" --pool=4 < $QUERIES > "$DIR/open.txt" \
+        2> /dev/null || exit 1
+    for run in disk open; do
+        if ! cmp -s "$DIR/tree.out" "$DIR/$run.out" ||
+                ! cmp -s "$DIR/tree.txt" "$DIR/$run.txt"; then
+            echo "FAIL page_file: stage $stage output differs with $run"
+            status=1
+        fi
+    done
+done
+[ $status -eq 0 ] && echo "ok page_file"
+exit $status
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Range queries with --threads must give the same output as without, both
+# for large queries handed to the threads & for tiny ones(answered on the
+# calling thread), over the usual area & over the whole world, where the
+# data is in one corner of the tree.
+
+cd "$(dirname "$0")/.." || exit 1
+DATA=example/dataset_1000.csv
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/queries.in" << QUERIES
+144.9 -37.9 145.1 -37.6
+144.952 -37.81 144.978 -37.79
+144.96 -37.81 144.9600001 -37.8099999
+144.9704 -37.8006 144.9704001 -37.8005999
+QUERIES
+
+status=0
+for AREA in "144.9375 -37.8750 145.0000 -37.6875" "-180 -90 180 90"; do
+    ./pointSearcher 4 $DATA "$DIR/serial.out" $AREA < "$DIR/queries.in" \
+        > "$DIR/serial.txt" || exit 1
+    ./pointSearcher 4 $DATA "$DIR/threads.out" $AREA --threads=4 \
+        < "$DIR/queries.in" > "$DIR/threads.txt" || exit 1
+    if ! cmp -s "$DIR/serial.out" "$DIR/threads.out" ||
+            ! cmp -s "$DIR/serial.txt" "$DIR/threads.txt"; then
+        echo "FAIL parallel_range: output differs with --threads over $AREA"
+        status=1
+    fi
+done
+[ $status -eq 0 ] && echo "ok parallel_range"
+exit $status
@@ -0,0 +1,469 @@
+/* tilePyramid.c
+*
+* Created by Ke Liao
+*
+* This module works out for every web map tile(the usual Web Mercator
+* x/y tiles) over the tree's area, at a range of zoom levels, the number of
+* footpaths in it & the sum of their distances and deltaz, and writes them
+* to a file the map can read instead of making a range query per tile.
+*
+* The tree is walked once, adding each point to its tile at the finest
+* level. A point counts its records' share of a footpath(a half at each
+* end if both ends are in the area), so the tiles add up to the footpaths
+* in the area. Each coarser level is then added up from the 4 tiles under
+* each of its tiles, from the finest level up.
+*
+* Only tiles with footpaths are kept, in a hash table by tile id(its row
+* & column as y * 2^zoom + x), so the memory follows the footpaths rather
+* than the area. The walk is shared between threads by subtrees a few
+* levels down, each thread adding into its own table; the tables are then
+* merged. Sums are kept as whole numbers(half footpaths & half
+* centimetres), so they come out the same whichever thread adds what.
+*
+* Layout of the file(in the machine's byte order):
+*   header      magic, smallest & largest zoom
+*   each level  zoom, x & y of its first tile, width & height in tiles,
+*               number of tiles with footpaths, then each of those row by
+*               row: x & y, then count, distance sum & deltaz sum as
+*               doubles
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include <pthread.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "tilePyramid.h"
+#include "usefulConsts.h"
+
+#define TILE_MAGIC "FPTILES2"
+#define MAGIC_LEN 8
+#define INITIAL_TILES 64
+#define EMPTY_SLOT UINT32_MAX
+#define HASH_MULTIPLIER 11400714819323198485ull   // 2^64 / golden ratio
+#define TASK_DEPTH 3          // subtrees this many levels down are shared
+#define CM_PER_M 100
+#define COUNT 0
+#define DISTANCE 1
+#define DELTAZ 2
+#define NUM_SUMS 3
+
+typedef struct {
+    char magic[MAGIC_LEN];
+    uint32_t min_zoom, max_zoom;
+} tile_header_t;
+
+typedef struct {
+    uint32_t zoom, x0, y0, width, height, num_tiles;
+} level_header_t;
+
+typedef struct {
+    uint32_t x, y;
+    double sums[NUM_SUMS];
+} tile_record_t;
+
+// Tile with footpaths & its NUM_SUMS sums in halves
+typedef struct {
+    uint64_t id;
+    int64_t sums[NUM_SUMS];
+} tile_t;
+
+// Tiles of a zoom level by id: slots hold numbers of tiles, at most half full
+typedef struct {
+    int zoom;
+    tile_t *tiles;
+    uint32_t num_tiles, max_tiles;
+    uint32_t *slots;
+    uint32_t num_slots;
+} tile_map_t;
+
+// Tiles of a level with footpaths, sorted by id(row by row)
+typedef struct {
+    level_header_t header;
+    tile_t *tiles;
+} tile_level_t;
+
+struct tile_pyramid{
+    int min_zoom, max_zoom;
+    tile_level_t *levels;      // levels[zoom - min_zoom]
+};
+
+// Walk shared by the threads
+typedef struct {
+    quadtree_t *qtree;
+    uint8_t *ends_in_area;     // each record's ends in the tree's area
+    tile_level_t *finest;
+    quadtree_node_t **tasks;
+    int num_tasks;
+    int next_task;
+    tile_map_t *thread_maps;   // each thread's own tiles of the finest level
+    int num_threads;
+    int next_thread;
+} tile_walk_t;
+
+static void tile_of(long double lon, long double lat, int zoom, long *x,
+                    long *y);
+static void tasks_collect(tile_walk_t *walk, quadtree_node_t *node,
+                          int depth);
+static void *walk_run(void *arg);
+static void leaves_add(tile_walk_t *walk, quadtree_node_t *node,
+                       tile_map_t *map, footpath_t *buffer);
+static void tile_map_init(tile_map_t *map, int zoom);
+static int64_t *tile_map_get(tile_map_t *map, uint64_t id);
+static void slots_grow(tile_map_t *map);
+static void level_fill(tile_level_t *level, tile_map_t *map);
+static int tile_cmp(const void *a, const void *b);
+
+
+/* Add up the tiles from zoom min_zoom to max_zoom over the tree's area,
+walking the tree on num_threads threads */
+tile_pyramid_t *tile_pyramid_build(quadtree_t *qtree, int min_zoom,
+                                   int max_zoom, int num_threads){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+    tile_pyramid_t *pyramid = malloc(sizeof(*pyramid));
+    assert(pyramid);
+    pyramid->min_zoom = min_zoom;
+    pyramid->max_zoom = max_zoom;
+    pyramid->levels = malloc(sizeof(tile_level_t) * (max_zoom - min_zoom + 1));
+    assert(pyramid->levels);
+
+    // Tiles covering the area at each level
+    rectangle_t *area = qtree->root->rectangle;
+    for (int zoom = min_zoom; zoom <= max_zoom; zoom++){
+        long left, top, right, bot;
+        tile_of(get_lon(get_bottomleft(area)), get_lat(get_topright(area)),
+                zoom, &left, &top);
+        tile_of(get_lon(get_topright(area)), get_lat(get_bottomleft(area)),
+                zoom, &right, &bot);
+        tile_level_t *level = &pyramid->levels[zoom - min_zoom];
+        level->header.zoom = zoom;
+        level->header.x0 = left;
+        level->header.y0 = top;
+        level->header.width = right - left + 1;
+        level->header.height = bot - top + 1;
+    }
+
+    // Number of each record's ends in the area, for its share at each end
+    tile_walk_t walk;
+    walk.qtree = qtree;
+    int num_records = record_table_size(qtree->records);
+    walk.ends_in_area = calloc(num_records + 1, sizeof(uint8_t));
+    assert(walk.ends_in_area);
+    footpath_t *buffer = record_buffer_create();
+    for (record_id_t record = 0; record < num_records; record++){
+        footpath_t *footpath = record_table_get(qtree->records, record,
+                                                buffer);
+        point_t *ends[2] = {get_start_point(footpath),
+                            get_end_point(footpath)};
+        for (int i = 0; i < 2; i++){
+            walk.ends_in_area[record] += in_rectangle(area, ends[i]);
+            point_free(ends[i]);
+        }
+    }
+    record_buffer_free(buffer);
+
+    // Walk the subtrees on the threads, each into its own tiles
+    tile_level_t *finest = &pyramid->levels[max_zoom - min_zoom];
+    walk.finest = finest;
+    walk.tasks = NULL;
+    walk.num_tasks = 0;
+    tasks_collect(&walk, qtree->root, 0);
+    walk.next_task = 0;
+    walk.num_threads = num_threads > 1 ? num_threads : 1;
+    walk.next_thread = 0;
+    walk.thread_maps = malloc(sizeof(tile_map_t) * walk.num_threads);
+    assert(walk.thread_maps);
+    for (int i = 0; i < walk.num_threads; i++){
+        tile_map_init(&walk.thread_maps[i], max_zoom);
+    }
+    if (walk.num_threads == 1){
+        walk_run(&walk);
+    }else{
+        pthread_t *threads = malloc(sizeof(pthread_t) * walk.num_threads);
+        assert(threads != NULL);
+        for (int i = 0; i < walk.num_threads; i++){
+            int created = pthread_create(&threads[i], NULL, walk_run, &walk);
+            assert(created == 0);
+        }
+        for (int i = 0; i < walk.num_threads; i++){
+            pthread_join(threads[i], NULL);
+        }
+        free(threads);
+    }
+    // Merge the threads' tiles into the first's
+    tile_map_t *merged = &walk.thread_maps[0];
+    for (int i = 1; i < walk.num_threads; i++){
+        tile_map_t *map = &walk.thread_maps[i];
+        for (uint32_t j = 0; j < map->num_tiles; j++){
+            int64_t *to = tile_map_get(merged, map->tiles[j].id);
+            for (int k = 0; k < NUM_SUMS; k++){
+                to[k] += map->tiles[j].sums[k];
+            }
+        }
+        free(map->tiles);
+        free(map->slots);
+    }
+    level_fill(finest, merged);
+    free(walk.thread_maps);
+    free(walk.tasks);
+    free(walk.ends_in_area);
+
+    // Each coarser tile is the sum of the 4 under it
+    for (int zoom = max_zoom - 1; zoom >= min_zoom; zoom--){
+        tile_level_t *fine = &pyramid->levels[zoom + 1 - min_zoom];
+        tile_map_t coarse;
+        tile_map_init(&coarse, zoom);
+        for (uint32_t i = 0; i < fine->header.num_tiles; i++){
+            uint64_t id = fine->tiles[i].id;
+            uint64_t x = id & ((1ull << (zoom + 1)) - 1);
+            uint64_t y = id >> (zoom + 1);
+            int64_t *to = tile_map_get(&coarse, (y / 2 << zoom) + x / 2);
+            for (int k = 0; k < NUM_SUMS; k++){
+                to[k] += fine->tiles[i].sums[k];
+            }
+        }
+        level_fill(&pyramid->levels[zoom - min_zoom], &coarse);
+    }
+    return pyramid;
+}
+
+
+/* Start an empty table of the tiles of a zoom level */
+static void tile_map_init(tile_map_t *map, int zoom){
+    map->zoom = zoom;
+    map->num_tiles = 0;
+    map->max_tiles = INITIAL_TILES;
+    map->tiles = malloc(sizeof(tile_t) * map->max_tiles);
+    map->num_slots = 2 * INITIAL_TILES;
+    map->slots = malloc(sizeof(uint32_t) * map->num_slots);
+    assert(map->tiles && map->slots);
+    for (uint32_t i = 0; i < map->num_slots; i++){
+        map->slots[i] = EMPTY_SLOT;
+    }
+}
+
+
+/* Sums of the tile with the id, added at zero if new */
+static int64_t *tile_map_get(tile_map_t *map, uint64_t id){
+    uint32_t mask = map->num_slots - 1;
+    uint32_t slot = (id * HASH_MULTIPLIER) >> 32 & mask;
+    while (map->slots[slot] != EMPTY_SLOT){
+        tile_t *tile = &map->tiles[map->slots[slot]];
+        if (tile->id == id){
+            return tile->sums;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (map->num_tiles == map->max_tiles){
+        map->max_tiles *= 2;
+        map->tiles = realloc(map->tiles, sizeof(tile_t) * map->max_tiles);
+        assert(map->tiles);
+    }
+    uint32_t idx = map->num_tiles++;
+    tile_t *tile = &map->tiles[idx];
+    tile->id = id;
+    memset(tile->sums, 0, sizeof(tile->sums));
+    map->slots[slot] = idx;
+
+    // Keep the table at most half full
+    if (2 * map->num_tiles > map->num_slots){
+        slots_grow(map);
+        tile = &map->tiles[idx];
+    }
+    return tile->sums;
+}
+
+
+/* Double the slots of the table, placing the tiles again */
+static void slots_grow(tile_map_t *map){
+    free(map->slots);
+    map->num_slots *= 2;
+    map->slots = malloc(sizeof(uint32_t) * map->num_slots);
+    assert(map->slots);
+    for (uint32_t i = 0; i < map->num_slots; i++){
+        map->slots[i] = EMPTY_SLOT;
+    }
+    uint32_t mask = map->num_slots - 1;
+    for (uint32_t idx = 0; idx < map->num_tiles; idx++){
+        uint32_t slot = (map->tiles[idx].id * HASH_MULTIPLIER) >> 32 & mask;
+        while (map->slots[slot] != EMPTY_SLOT){
+            slot = (slot + 1) & mask;
+        }
+        map->slots[slot] = idx;
+    }
+}
+
+
+/* Take the table's tiles as the level's, sorted by id, & free the table */
+static void level_fill(tile_level_t *level, tile_map_t *map){
+    free(map->slots);
+    qsort(map->tiles, map->num_tiles, sizeof(tile_t), tile_cmp);
+    level->tiles = map->tiles;
+    level->header.num_tiles = map->num_tiles;
+}
+
+
+/* Compare tiles by id */
+static int tile_cmp(const void *a, const void *b){
+    const tile_t *tile1 = a, *tile2 = b;
+    return (tile1->id > tile2->id) - (tile1->id < tile2->id);
+}
+
+
+/* Web Mercator tile of a point at a zoom level */
+static void tile_of(long double lon, long double lat, int zoom, long *x,
+                    long *y){
+    long double num_tiles = (long double)(1L << zoom);
+    long double pi = 180 * DEG_TO_RAD;
+    *x = (long)floorl((lon + 180) / 360 * num_tiles);
+    *y = (long)floorl((1 - asinhl(tanl(lat * DEG_TO_RAD)) / pi) / 2 *
+                      num_tiles);
+}
+
+
+/* List the subtrees TASK_DEPTH levels down(or leaves above that) */
+static void tasks_collect(tile_walk_t *walk, quadtree_node_t *node,
+                          int depth){
+    if (depth == TASK_DEPTH || is_leaf_node(node)){
+        walk->tasks = realloc(walk->tasks, sizeof(quadtree_node_t*) *
+                              (walk->num_tasks + 1));
+        assert(walk->tasks);
+        walk->tasks[walk->num_tasks++] = node;
+        return;
+    }
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child != NULL){
+            tasks_collect(walk, child, depth + 1);
+        }
+    }
+}
+
+
+/* Thread body: take subtrees until none are left, adding their points */
+static void *walk_run(void *arg){
+    tile_walk_t *walk = arg;
+    int thread = __atomic_fetch_add(&walk->next_thread, 1, __ATOMIC_RELAXED);
+    tile_map_t *map = &walk->thread_maps[thread];
+    footpath_t *buffer = record_buffer_create();
+    int task;
+    while ((task = __atomic_fetch_add(&walk->next_task, 1,
+                                      __ATOMIC_RELAXED)) < walk->num_tasks){
+        leaves_add(walk, walk->tasks[task], map, buffer);
+    }
+    record_buffer_free(buffer);
+    return NULL;
+}
+
+
+/* Add the points of the node's leaves to their tiles of the finest level */
+static void leaves_add(tile_walk_t *walk, quadtree_node_t *node,
+                       tile_map_t *map, footpath_t *buffer){
+    if (!is_leaf_node(node)){
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child != NULL){
+                leaves_add(walk, child, map, buffer);
+            }
+        }
+        return;
+    }
+    if (node->dt_point == NULL){
+        return;
+    }
+
+    level_header_t *header = &walk->finest->header;
+    point_t *loc = get_dt_point_loc(node->dt_point);
+    long x, y;
+    tile_of(get_lon(loc), get_lat(loc), header->zoom, &x, &y);
+    long right = header->x0 + header->width - 1;
+    long bot = header->y0 + header->height - 1;
+    x = x < header->x0 ? header->x0 : (x > right ? right : x);
+    y = y < header->y0 ? header->y0 : (y > bot ? bot : y);
+    int64_t *tile = tile_map_get(map, ((uint64_t)y << header->zoom) + x);
+
+    record_id_t *records = get_record_list(node->dt_point);
+    int num_records = get_num_stored(node->dt_point);
+    for (int i = 0; i < num_records; i++){
+        footpath_t *footpath = record_table_get(walk->qtree->records,
+                                                records[i], buffer);
+        point_t *ends[2] = {get_start_point(footpath),
+                            get_end_point(footpath)};
+        int ends_here = 0;
+        for (int j = 0; j < 2; j++){
+            ends_here += point_cmp(ends[j], loc) == EQUALS;
+            point_free(ends[j]);
+        }
+
+        // Share of the footpath in halves: 2 * ends here / ends in area
+        int64_t halves = 2 * ends_here / walk->ends_in_area[records[i]];
+        tile[COUNT] += halves;
+        tile[DISTANCE] += halves * llround(get_distance(footpath) * CM_PER_M);
+        tile[DELTAZ] += halves * llround(get_deltaz(footpath) * CM_PER_M);
+    }
+}
+
+
+/* Write the pyramid to f */
+void tile_pyramid_write(tile_pyramid_t *pyramid, FILE *f){
+    tile_header_t header;
+    memcpy(header.magic, TILE_MAGIC, MAGIC_LEN);
+    header.min_zoom = pyramid->min_zoom;
+    header.max_zoom = pyramid->max_zoom;
+    fwrite(&header, sizeof(header), 1, f);
+
+    for (int zoom = pyramid->min_zoom; zoom <= pyramid->max_zoom; zoom++){
+        tile_level_t *level = &pyramid->levels[zoom - pyramid->min_zoom];
+        fwrite(&level->header, sizeof(level->header), 1, f);
+        for (uint32_t i = 0; i < level->header.num_tiles; i++){
+            tile_t *tile = &level->tiles[i];
+            tile_record_t record;
+            record.x = tile->id & ((1ull << zoom) - 1);
+            record.y = tile->id >> zoom;
+            record.sums[COUNT] = tile->sums[COUNT] / 2.0;
+            record.sums[DISTANCE] = tile->sums[DISTANCE] / (2.0 * CM_PER_M);
+            record.sums[DELTAZ] = tile->sums[DELTAZ] / (2.0 * CM_PER_M);
+            fwrite(&record, sizeof(record), 1, f);
+        }
+    }
+}
+
+
+/* Print to f the size of each level, the tiles with footpaths & the total
+number of footpaths */
+void tile_pyramid_stats_print(tile_pyramid_t *pyramid, FILE *f){
+    for (int zoom = pyramid->min_zoom; zoom <= pyramid->max_zoom; zoom++){
+        tile_level_t *level = &pyramid->levels[zoom - pyramid->min_zoom];
+        int64_t halves = 0;
+        for (uint32_t i = 0; i < level->header.num_tiles; i++){
+            halves += level->tiles[i].sums[COUNT];
+        }
+        fprintf(f, "zoom %d: %u x %u tiles, %u with footpaths, %.1f "
+                "footpaths\n", zoom, level->header.width,
+                level->header.height, level->header.num_tiles, halves / 2.0);
+    }
+}
+
+
+/* Free the pyramid */
+void tile_pyramid_free(tile_pyramid_t *pyramid){
+    for (int zoom = pyramid->min_zoom; zoom <= pyramid->max_zoom; zoom++){
+        free(pyramid->levels[zoom - pyramid->min_zoom].tiles);
+    }
+    free(pyramid->levels);
+    free(pyramid);
+}
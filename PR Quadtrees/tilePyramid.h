@@ -0,0 +1,13 @@
+#ifndef _TILEPYRAMID_H_
+#define _TILEPYRAMID_H_
+#include <stdio.h>
+#include "quadTree.h"
+
+typedef struct tile_pyramid tile_pyramid_t;
+
+tile_pyramid_t *tile_pyramid_build(quadtree_t *qtree, int min_zoom,
+                                   int max_zoom, int num_threads);
+void tile_pyramid_write(tile_pyramid_t *pyramid, FILE *f);
+void tile_pyramid_stats_print(tile_pyramid_t *pyramid, FILE *f);
+void tile_pyramid_free(tile_pyramid_t *pyramid);
+#endif
@@ -0,0 +1,347 @@
+/* topKQuery.c
+*
+* Created by Ke Liao
+*
+* This module finds the k footpaths in a rectangle with the largest or
+* smallest value of an attribute(e.g. the longest by distance) without
+* collecting every footpath in the rectangle. Each node keeps the smallest
+* & largest value of each attribute among the records under it(in a table
+* beside the tree). The nodes overlapping the rectangle are searched best
+* value first, keeping the best k records found in a heap, and a node is
+* skipped once its best value can't beat the k-th record kept. The work
+* then depends on k more than on the size of the rectangle.
+*
+* Ties go to the smaller footpath id, like the sorted output elsewhere.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "nodeTable.h"
+#include "topKQuery.h"
+#include "usefulConsts.h"
+
+#define NUM_ATTRIBUTES 3
+#define MIN_BOUND 0
+#define MAX_BOUND 1
+
+// Attributes that can be ranked
+typedef struct {
+    const char *name;
+    double (*get)(footpath_t *record);
+} attribute_t;
+
+static const attribute_t attributes[NUM_ATTRIBUTES] = {
+    {"grade1in", get_grade1in},
+    {"distance", get_distance},
+    {"deltaz", get_deltaz}
+};
+
+// Smallest & largest value of each attribute under a node
+typedef struct {
+    double bounds[NUM_ATTRIBUTES][2];
+} attribute_bounds_t;
+
+struct top_k_index{
+    quadtree_t *qtree;
+    record_table_t *table;
+    node_table_t *bounds;
+};
+
+typedef struct {
+    record_id_t record;
+    int footpath_id;
+    double value;
+} ranked_record_t;
+
+// Best k records found so far, the worst of them at the top of the heap
+typedef struct {
+    top_k_index_t *index;
+    rectangle_t *query;
+    int attribute;
+    int largest;          // TRUE to rank the largest values first
+    int k;
+    int num_found;
+    ranked_record_t *heap;
+    footpath_t *buffer;       // records are got into if the table is compact
+} top_k_search_t;
+
+static attribute_bounds_t *bounds_build(top_k_index_t *index,
+                                        quadtree_node_t *node,
+                                        footpath_t *buffer);
+static void node_top_k(top_k_search_t *search, quadtree_node_t *node);
+static void record_offer(top_k_search_t *search, data_point_t *dt_point,
+                         record_id_t record);
+static int ranks_before(top_k_search_t *search, ranked_record_t *record1,
+                        ranked_record_t *record2);
+static void heap_sift_down(top_k_search_t *search, int idx);
+static double node_best(top_k_search_t *search, quadtree_node_t *node);
+
+
+/* Collect the attribute bounds of every node of the tree */
+top_k_index_t *top_k_index_create(quadtree_t *qtree){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);
+    }
+    top_k_index_t *index = malloc(sizeof(*index));
+    assert(index);
+    index->qtree = qtree;
+    index->table = qtree->records;
+    index->bounds = node_table_create(qtree->root,
+                                      sizeof(attribute_bounds_t));
+    footpath_t *buffer = record_buffer_create();
+    bounds_build(index, qtree->root, buffer);
+    record_buffer_free(buffer);
+    return index;
+}
+
+
+/* Number of the attribute with the name, or UNDEFINED */
+int top_k_attribute(const char *name){
+    for (int i = 0; i < NUM_ATTRIBUTES; i++){
+        if (strcmp(attributes[i].name, name) == 0){
+            return i;
+        }
+    }
+    return UNDEFINED;
+}
+
+
+/* Work out the bounds of the node's subtree */
+static attribute_bounds_t *bounds_build(top_k_index_t *index,
+                                        quadtree_node_t *node,
+                                        footpath_t *buffer){
+    attribute_bounds_t bounds;
+    for (int i = 0; i < NUM_ATTRIBUTES; i++){
+        bounds.bounds[i][MIN_BOUND] = INFINITY;
+        bounds.bounds[i][MAX_BOUND] = -INFINITY;
+    }
+
+    if (is_leaf_node(node)){
+        if (node->dt_point != NULL){
+            record_id_t *records = get_record_list(node->dt_point);
+            int num_records = get_num_stored(node->dt_point);
+            for (int r = 0; r < num_records; r++){
+                footpath_t *footpath = record_table_get(index->table,
+                                                        records[r], buffer);
+                for (int i = 0; i < NUM_ATTRIBUTES; i++){
+                    double value = attributes[i].get(footpath);
+                    bounds.bounds[i][MIN_BOUND] =
+                        fmin(bounds.bounds[i][MIN_BOUND], value);
+                    bounds.bounds[i][MAX_BOUND] =
+                        fmax(bounds.bounds[i][MAX_BOUND], value);
+                }
+            }
+        }
+    }else{
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            attribute_bounds_t *child_bounds = bounds_build(index, child,
+                                                            buffer);
+            for (int i = 0; i < NUM_ATTRIBUTES; i++){
+                bounds.bounds[i][MIN_BOUND] = fmin(bounds.bounds[i][MIN_BOUND],
+                    child_bounds->bounds[i][MIN_BOUND]);
+                bounds.bounds[i][MAX_BOUND] = fmax(bounds.bounds[i][MAX_BOUND],
+                    child_bounds->bounds[i][MAX_BOUND]);
+            }
+        }
+    }
+
+    attribute_bounds_t *slot = node_table_get(index->bounds, node);
+    *slot = bounds;
+    return slot;
+}
+
+
+/* Output to f the k records with a point in the query ranked first by the
+attribute(largest or smallest first), best first, & their values to
+summary */
+void tree_top_k_query(top_k_index_t *index, rectangle_t *query,
+                      int attribute, int largest, int k, FILE *f,
+                      FILE *summary){
+    top_k_search_t search;
+    search.index = index;
+    search.query = query;
+    search.attribute = attribute;
+    search.largest = largest;
+    search.k = k;
+    search.num_found = 0;
+    search.heap = malloc(sizeof(ranked_record_t) * (k + 1));
+    search.buffer = record_buffer_create();
+    assert(search.heap);
+
+    quadtree_node_t *root = index->qtree->root;
+    if (k > 0 && rectangle_overlap(query, root->rectangle)){
+        node_top_k(&search, root);
+    }
+
+    /* Take the worst off the heap until it's empty, filling from the back */
+    int num_found = search.num_found;
+    while (search.num_found > 1){
+        ranked_record_t worst = search.heap[0];
+        search.heap[0] = search.heap[--search.num_found];
+        search.heap[search.num_found] = worst;
+        heap_sift_down(&search, 0);
+    }
+    for (int i = 0; i < num_found; i++){
+        data_print(record_table_get(index->table, search.heap[i].record,
+                                    search.buffer), f);
+        fprintf(summary, " %.2f", search.heap[i].value);
+    }
+    free(search.heap);
+    record_buffer_free(search.buffer);
+}
+
+
+/* Search the node's subtree for records ranked before the k-th kept */
+static void node_top_k(top_k_search_t *search, quadtree_node_t *node){
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL ||
+                !in_rectangle(search->query, get_dt_point_loc(node->dt_point))){
+            return;
+        }
+        record_id_t *records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+        for (int i = 0; i < num_records; i++){
+            record_offer(search, node->dt_point, records[i]);
+        }
+        return;
+    }
+
+    // Overlapping children, best value first
+    quadtree_node_t *children[4];
+    double bests[4];
+    int num_children = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL || !rectangle_overlap(search->query,
+                                                child->rectangle)){
+            continue;
+        }
+        double best = node_best(search, child);
+        int pos = num_children++;
+        while (pos > 0 && (search->largest ? bests[pos - 1] < best :
+                                             bests[pos - 1] > best)){
+            children[pos] = children[pos - 1];
+            bests[pos] = bests[pos - 1];
+            pos--;
+        }
+        children[pos] = child;
+        bests[pos] = best;
+    }
+
+    for (int i = 0; i < num_children; i++){
+        if (isinf(bests[i])){
+            break;   // nothing under the rest
+        }
+
+        // Later children can't beat the k-th either
+        if (search->num_found == search->k){
+            double kth = search->heap[0].value;
+            if (search->largest ? bests[i] < kth : bests[i] > kth){
+                break;
+            }
+        }
+        node_top_k(search, children[i]);
+    }
+}
+
+
+/* Best value of the attribute under the node(infinitely bad if empty)*/
+static double node_best(top_k_search_t *search, quadtree_node_t *node){
+    attribute_bounds_t *bounds = node_table_get(search->index->bounds, node);
+    return bounds->bounds[search->attribute][search->largest ? MAX_BOUND :
+                                                              MIN_BOUND];
+}
+
+
+/* Keep the record found at the data point if it's ranked before the k-th
+kept so far */
+static void record_offer(top_k_search_t *search, data_point_t *dt_point,
+                         record_id_t record){
+    footpath_t *footpath = record_table_get(search->index->table, record,
+                                           search->buffer);
+
+    /* Records are found at both their points, so one is only offered at its
+    start point, or at its end point if the start point isn't matched. A
+    start point in a pruned subtree can't be ranked first either */
+    point_t *start_point = get_start_point(footpath);
+    int owned = point_cmp(start_point, get_dt_point_loc(dt_point)) == EQUALS ||
+        !(in_rectangle(search->index->qtree->root->rectangle, start_point) &&
+          in_rectangle(search->query, start_point));
+    point_free(start_point);
+    if (!owned){
+        return;
+    }
+    ranked_record_t candidate = {record, get_footpath_id(footpath),
+                                 attributes[search->attribute].get(footpath)};
+
+    if (search->num_found < search->k){
+
+        // Sift up from the end
+        int idx = search->num_found++;
+        while (idx > 0 && ranks_before(search, &search->heap[(idx - 1) / 2],
+                                       &candidate)){
+            search->heap[idx] = search->heap[(idx - 1) / 2];
+            idx = (idx - 1) / 2;
+        }
+        search->heap[idx] = candidate;
+    }else if (ranks_before(search, &candidate, &search->heap[0])){
+        search->heap[0] = candidate;
+        heap_sift_down(search, 0);
+    }
+}
+
+
+/* Check if record1 is ranked before record2 */
+static int ranks_before(top_k_search_t *search, ranked_record_t *record1,
+                        ranked_record_t *record2){
+    if (record1->value != record2->value){
+        return search->largest ? record1->value > record2->value :
+                                 record1->value < record2->value;
+    }
+    return record1->footpath_id < record2->footpath_id;
+}
+
+
+/* Move the heap entry down until the worst is on top again */
+static void heap_sift_down(top_k_search_t *search, int idx){
+    ranked_record_t *heap = search->heap;
+    while (TRUE){
+        int worst = idx;
+        for (int child = 2 * idx + 1; child <= 2 * idx + 2; child++){
+            if (child < search->num_found &&
+                    ranks_before(search, &heap[worst], &heap[child])){
+                worst = child;
+            }
+        }
+        if (worst == idx){
+            return;
+        }
+        ranked_record_t moved = heap[idx];
+        heap[idx] = heap[worst];
+        heap[worst] = moved;
+        idx = worst;
+    }
+}
+
+
+/* Free the bounds(the tree is left alone)*/
+void top_k_index_free(top_k_index_t *index){
+    node_table_free(index->bounds);
+    free(index);
+}
@@ -0,0 +1,15 @@
+#ifndef _TOPKQUERY_H_
+#define _TOPKQUERY_H_
+#include <stdio.h>
+#include "quadTree.h"
+#include "rectangle.h"
+
+typedef struct top_k_index top_k_index_t;
+
+top_k_index_t *top_k_index_create(quadtree_t *qtree);
+int top_k_attribute(const char *name);
+void tree_top_k_query(top_k_index_t *index, rectangle_t *query, 
+                      int attribute, int largest, int k, FILE *f,
+                      FILE *summary);
+void top_k_index_free(top_k_index_t *index);
+#endif
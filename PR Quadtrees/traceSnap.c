@@ -0,0 +1,483 @@
+/* traceSnap.c
+*
+* Created by Ke Liao
+*
+* This module snaps the points of GPS traces to the nearest footpath. A
+* footpath is the segment between its start & end points, so the nearest
+* one can be closer than any point in the tree. Distances are measured on
+* a flat map around each GPS point(longitude scaled by the cosine of its
+* latitude), which is accurate over the few hundred metres involved.
+*
+* A segment can reach outside the leaves of its ends, so each node is
+* given the bounding box of the segments of the records under it(kept in
+* a table beside the tree). Once a segment at distance d is found, nodes
+* whose box is further than d are skipped. Footpaths with neither end in
+* the tree's area aren't in the tree & can't be snapped to.
+*
+* Nodes are searched nearest box first. The points of a trace are snapped in
+* order, each starting from the leaf the previous point was snapped from:
+* consecutive points are close together, so that leaf usually gives a
+* small d straight away.
+*
+* The traces are shared between threads; each point's result is written
+* in input order.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <pthread.h>
+#include "point2D.h"
+#include "rectangle.h"
+#include "dataPoint.h"
+#include "footpathData.h"
+#include "recordTable.h"
+#include "quadTree.h"
+#include "quadTreeInternal.h"
+#include "lazyQuadTree.h"
+#include "nodeTable.h"
+#include "traceSnap.h"
+#include "usefulConsts.h"
+
+#define INITIAL_SIZE 64
+#define METRES_PER_DEGREE (EARTH_RADIUS * DEG_TO_RAD)
+
+// Bounding box of the segments of the records under a node
+typedef struct {
+    double left, bot, right, top;
+} segment_box_t;
+
+struct snap_index{
+    quadtree_t *qtree;
+    record_table_t *table;
+
+    // Ends of each record's segment & its id
+    double *start_lons, *start_lats, *end_lons, *end_lats;
+    int *footpath_ids;
+
+    node_table_t *boxes;     // box of each node
+};
+
+// Nearest segment found so far for a GPS point
+typedef struct {
+    double lon, lat;       // GPS point
+    double lon_scale;      // metres per degree of longitude here
+    record_id_t record;
+    int found;
+    double dist;
+    double offset;         // metres along the segment from its start
+    double snapped_lon, snapped_lat;
+    quadtree_node_t *leaf; // leaf the segment was found from
+    long nodes_visited;
+} snap_search_t;
+
+typedef struct {
+    char *line;
+    double lon, lat;
+} trace_point_t;
+
+typedef struct {
+    int first_point;
+    int num_points;
+} trace_t;
+
+// Work shared by the threads
+typedef struct {
+    snap_index_t *index;
+    trace_point_t *points;
+    trace_t *traces;
+    int num_traces;
+    int next_trace;
+
+    // Output of finished traces waiting for the ones before them
+    pthread_mutex_t output_lock;
+    char **outputs;
+    char **summaries;
+    int next_output;
+    FILE *output;
+    FILE *summary;
+} snap_work_t;
+
+static void segment_snap(snap_index_t *index, snap_search_t *search,
+                         record_id_t record);
+static void node_snap(snap_index_t *index, snap_search_t *search,
+                      quadtree_node_t *node);
+static double box_flat_distance(snap_search_t *search, segment_box_t *box);
+static segment_box_t *box_build(snap_index_t *index, quadtree_node_t *node);
+static void *snap_work(void *arg);
+static void trace_snap(snap_work_t *work, int trace);
+
+
+/* Collect the segments of the tree's records */
+snap_index_t *snap_index_create(quadtree_t *qtree){
+    if (qtree->lazy){
+        tree_expand_all(qtree->root);   // threads search the tree at once
+    }
+
+    snap_index_t *index = malloc(sizeof(*index));
+    assert(index);
+    index->qtree = qtree;
+    index->table = qtree->records;
+    int num_records = record_table_size(index->table);
+    index->start_lons = malloc(sizeof(double) * (num_records + 1));
+    index->start_lats = malloc(sizeof(double) * (num_records + 1));
+    index->end_lons = malloc(sizeof(double) * (num_records + 1));
+    index->end_lats = malloc(sizeof(double) * (num_records + 1));
+    index->footpath_ids = malloc(sizeof(int) * (num_records + 1));
+    assert(index->start_lons && index->start_lats && index->end_lons &&
+           index->end_lats && index->footpath_ids);
+
+    footpath_t *buffer = record_buffer_create();
+    for (record_id_t record = 0; record < num_records; record++){
+        footpath_t *footpath = record_table_get(index->table, record, buffer);
+        point_t *start = get_start_point(footpath);
+        point_t *end = get_end_point(footpath);
+        index->start_lons[record] = get_lon(start);
+        index->start_lats[record] = get_lat(start);
+        index->end_lons[record] = get_lon(end);
+        index->end_lats[record] = get_lat(end);
+        index->footpath_ids[record] = get_footpath_id(footpath);
+        point_free(start);
+        point_free(end);
+    }
+    record_buffer_free(buffer);
+    index->boxes = node_table_create(qtree->root, sizeof(segment_box_t));
+    box_build(index, qtree->root);
+    return index;
+}
+
+
+/* Work out the boxes of the node's subtree. A box with nothing in it has
+left > right */
+static segment_box_t *box_build(snap_index_t *index, quadtree_node_t *node){
+    segment_box_t box = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    if (is_leaf_node(node)){
+        int num_records = 0;
+        record_id_t *records = NULL;
+        if (node->dt_point != NULL){
+            num_records = get_num_stored(node->dt_point);
+            records = get_record_list(node->dt_point);
+        }
+        for (int i = 0; i < num_records; i++){
+            record_id_t record = records[i];
+            box.left = fmin(box.left, fmin(index->start_lons[record], 
+                                           index->end_lons[record]));
+            box.right = fmax(box.right, fmax(index->start_lons[record], 
+                                             index->end_lons[record]));
+            box.bot = fmin(box.bot, fmin(index->start_lats[record], 
+                                         index->end_lats[record]));
+            box.top = fmax(box.top, fmax(index->start_lats[record], 
+                                         index->end_lats[record]));
+        }
+    }else{
+        for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+            quadtree_node_t *child = get_child(node, quad);
+            if (child == NULL){
+                continue;
+            }
+            segment_box_t *child_box = box_build(index, child);
+            box.left = fmin(box.left, child_box->left);
+            box.right = fmax(box.right, child_box->right);
+            box.bot = fmin(box.bot, child_box->bot);
+            box.top = fmax(box.top, child_box->top);
+        }
+    }
+    segment_box_t *slot = node_table_get(index->boxes, node);
+    *slot = box;
+    return slot;
+}
+
+
+/* Check if the record's segment is closer than the nearest found so far(on
+a tie, the smaller footpath id is kept)*/
+static void segment_snap(snap_index_t *index, snap_search_t *search,
+                         record_id_t record){
+
+    // Ends relative to the GPS point, in metres
+    double start_x = (index->start_lons[record] - search->lon) *
+                     search->lon_scale;
+    double start_y = (index->start_lats[record] - search->lat) *
+                     METRES_PER_DEGREE;
+    double dir_x = (index->end_lons[record] - search->lon) *
+                   search->lon_scale - start_x;
+    double dir_y = (index->end_lats[record] - search->lat) *
+                   METRES_PER_DEGREE - start_y;
+
+    // Closest point of the segment to the GPS point(at the origin)
+    double length_sq = dir_x * dir_x + dir_y * dir_y;
+    double along = 0;
+    if (length_sq > 0){
+        along = -(start_x * dir_x + start_y * dir_y) / length_sq;
+        along = along < 0 ? 0 : (along > 1 ? 1 : along);
+    }
+    double snapped_x = start_x + along * dir_x;
+    double snapped_y = start_y + along * dir_y;
+    double dist = hypot(snapped_x, snapped_y);
+
+    if (search->found && (dist > search->dist || (dist == search->dist &&
+            index->footpath_ids[record] >=
+            index->footpath_ids[search->record]))){
+        return;
+    }
+    search->found = TRUE;
+    search->record = record;
+    search->dist = dist;
+    search->offset = along * sqrt(length_sq);
+    search->snapped_lon = search->lon + snapped_x / search->lon_scale;
+    search->snapped_lat = search->lat + snapped_y / METRES_PER_DEGREE;
+}
+
+
+/* Search the node's subtree, skipping nodes too far to hold a segment
+closer than the nearest found */
+static void node_snap(snap_index_t *index, snap_search_t *search,
+                      quadtree_node_t *node){
+    search->nodes_visited++;
+    if (is_leaf_node(node)){
+        if (node->dt_point == NULL){
+            return;
+        }
+        record_id_t *records = get_record_list(node->dt_point);
+        int num_records = get_num_stored(node->dt_point);
+        int had_best = search->found ? search->record : UNDEFINED;
+        for (int i = 0; i < num_records; i++){
+            segment_snap(index, search, records[i]);
+        }
+        if (search->found && (int)search->record != had_best){
+            search->leaf = node;
+        }
+        return;
+    }
+
+    // Nearest children first
+    quadtree_node_t *children[4];
+    double dists[4];
+    int num_children = 0;
+    for (int quad = SW_QUADRANT; quad <= SE_QUADRANT; quad++){
+        quadtree_node_t *child = get_child(node, quad);
+        if (child == NULL){
+            continue;
+        }
+        double dist = box_flat_distance(search, 
+            node_table_get(index->boxes, child));
+        int pos = num_children++;
+        while (pos > 0 && dists[pos - 1] > dist){
+            children[pos] = children[pos - 1];
+            dists[pos] = dists[pos - 1];
+            pos--;
+        }
+        children[pos] = child;
+        dists[pos] = dist;
+    }
+    for (int i = 0; i < num_children; i++){
+        if (dists[i] == INFINITY || (search->found && 
+                dists[i] > search->dist)){
+            break;
+        }
+        node_snap(index, search, children[i]);
+    }
+}
+
+
+/* Distance in metres from the GPS point to the nearest point of the box, or
+INFINITY if it's empty */
+static double box_flat_distance(snap_search_t *search, segment_box_t *box){
+    if (box->left > box->right){
+        return INFINITY;
+    }
+    double left = box->left, right = box->right;
+    double bot = box->bot, top = box->top;
+    double lon_gap = search->lon < left ? left - search->lon :
+                     (search->lon > right ? search->lon - right : 0);
+    double lat_gap = search->lat < bot ? bot - search->lat :
+                     (search->lat > top ? search->lat - top : 0);
+    return hypot(lon_gap * search->lon_scale, lat_gap * METRES_PER_DEGREE);
+}
+
+
+/* Read the GPS points("trace_id longitude latitude" a line, each trace's
+points together & in order) & output the nearest footpath of each, with the
+snapped point, the distance along the footpath & the distance to it. A line
+per trace is written to summary */
+void snap_traces(snap_index_t *index, FILE *input, FILE *output,
+                 FILE *summary, int num_threads){
+    snap_work_t work;
+    work.index = index;
+    work.num_traces = 0;
+    int num_points = 0, point_size = INITIAL_SIZE;
+    int trace_size = INITIAL_SIZE;
+    work.points = malloc(sizeof(trace_point_t) * point_size);
+    work.traces = malloc(sizeof(trace_t) * trace_size);
+    assert(work.points && work.traces);
+
+    /* Read every point, starting a new trace when the id changes */
+    char *line = NULL;
+    size_t line_len = 0;
+    char *trace_id = NULL;
+    while (getline(&line, &line_len, input) != EOF){
+        char id[line_len + 1];
+        trace_point_t point;
+        sscanf(line, "%[^\n]", line);
+        if (sscanf(line, "%s %lf %lf", id, &point.lon, &point.lat) != 3){
+            continue;
+        }
+        point.line = strdup(line);
+        assert(point.line);
+        if (num_points == point_size){
+            point_size *= 2;
+            work.points = realloc(work.points,
+                                  sizeof(trace_point_t) * point_size);
+            assert(work.points);
+        }
+        if (trace_id == NULL || strcmp(trace_id, id) != 0){
+            if (work.num_traces == trace_size){
+                trace_size *= 2;
+                work.traces = realloc(work.traces,
+                                      sizeof(trace_t) * trace_size);
+                assert(work.traces);
+            }
+            work.traces[work.num_traces].first_point = num_points;
+            work.traces[work.num_traces].num_points = 0;
+            work.num_traces++;
+            free(trace_id);
+            trace_id = strdup(id);
+            assert(trace_id);
+        }
+        work.points[num_points++] = point;
+        work.traces[work.num_traces - 1].num_points++;
+    }
+    free(line);
+    free(trace_id);
+
+    /* Snap the traces on the threads */
+    work.next_trace = 0;
+    work.next_output = 0;
+    work.outputs = calloc(work.num_traces + 1, sizeof(char*));
+    work.summaries = calloc(work.num_traces + 1, sizeof(char*));
+    assert(work.outputs && work.summaries);
+    work.output = output;
+    work.summary = summary;
+    pthread_mutex_init(&work.output_lock, NULL);
+    if (num_threads < 1){
+        num_threads = 1;
+    }
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    assert(threads);
+    for (int i = 0; i < num_threads; i++){
+        int created = pthread_create(&threads[i], NULL, snap_work, &work);
+        assert(created == 0);
+    }
+    for (int i = 0; i < num_threads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&work.output_lock);
+
+    for (int i = 0; i < num_points; i++){
+        free(work.points[i].line);
+    }
+    free(threads);
+    free(work.outputs);
+    free(work.summaries);
+    free(work.points);
+    free(work.traces);
+}
+
+
+/* Take the next trace until none are left */
+static void *snap_work(void *arg){
+    snap_work_t *work = arg;
+    while (TRUE){
+        int trace = __atomic_fetch_add(&work->next_trace, 1,
+                                       __ATOMIC_RELAXED);
+        if (trace >= work->num_traces){
+            return NULL;
+        }
+        trace_snap(work, trace);
+    }
+}
+
+
+/* Snap the points of the trace in order, then write out the results of the
+traces finished so far that follow on from those already written */
+static void trace_snap(snap_work_t *work, int trace){
+    snap_index_t *index = work->index;
+    char *text = NULL, *summary_text = NULL;
+    size_t text_len = 0, summary_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    FILE *summary = open_memstream(&summary_text, &summary_len);
+    assert(out && summary);
+
+    trace_point_t *points = work->points + work->traces[trace].first_point;
+    int num_points = work->traces[trace].num_points;
+    quadtree_node_t *hint = NULL;
+    long nodes_visited = 0;
+    int num_snapped = 0;
+    double total_dist = 0;
+    for (int i = 0; i < num_points; i++){
+        snap_search_t search;
+        search.lon = points[i].lon;
+        search.lat = points[i].lat;
+        search.lon_scale = METRES_PER_DEGREE * cos(search.lat * DEG_TO_RAD);
+        search.found = FALSE;
+        search.leaf = NULL;
+        search.nodes_visited = 0;
+
+        // The previous point's leaf first, to start with a close segment
+        if (hint != NULL){
+            node_snap(index, &search, hint);
+        }
+        node_snap(index, &search, index->qtree->root);
+        nodes_visited += search.nodes_visited;
+
+        fprintf(out, "%s --> ", points[i].line);
+        if (!search.found){
+            fprintf(out, "no footpath\n");
+            continue;
+        }
+        fprintf(out, "footpath_id: %d || snapped_lon: %.6f || snapped_lat: "
+                "%.6f || offset: %.2f || distance: %.2f\n",
+                index->footpath_ids[search.record], search.snapped_lon,
+                search.snapped_lat, search.offset, search.dist);
+        num_snapped++;
+        total_dist += search.dist;
+        hint = search.leaf;
+    }
+
+    char trace_id[strlen(points[0].line) + 1];
+    sscanf(points[0].line, "%s", trace_id);
+    fprintf(summary, "%s --> %d points, %d snapped, mean distance %.2f m, "
+            "%.1f nodes searched per point\n", trace_id, num_points,
+            num_snapped, num_snapped ? total_dist / num_snapped : 0.0,
+            (double)nodes_visited / num_points);
+    fclose(out);
+    fclose(summary);
+
+    /* Write this & any later finished traces if the ones before are done */
+    pthread_mutex_lock(&work->output_lock);
+    work->outputs[trace] = text;
+    work->summaries[trace] = summary_text;
+    while (work->next_output < work->num_traces &&
+            work->outputs[work->next_output] != NULL){
+        fputs(work->outputs[work->next_output], work->output);
+        fputs(work->summaries[work->next_output], work->summary);
+        free(work->outputs[work->next_output]);
+        free(work->summaries[work->next_output]);
+        work->next_output++;
+    }
+    pthread_mutex_unlock(&work->output_lock);
+}
+
+
+/* Free the segments(the tree is left alone)*/
+void snap_index_free(snap_index_t *index){
+    free(index->start_lons);
+    free(index->start_lats);
+    free(index->end_lons);
+    free(index->end_lats);
+    free(index->footpath_ids);
+    node_table_free(index->boxes);
+    free(index);
+}
@@ -0,0 +1,12 @@
+#ifndef _TRACESNAP_H_
+#define _TRACESNAP_H_
+#include <stdio.h>
+#include "quadTree.h"
+
+typedef struct snap_index snap_index_t;
+
+snap_index_t *snap_index_create(quadtree_t *qtree);
+void snap_traces(snap_index_t *index, FILE *input, FILE *output,
+                 FILE *summary, int num_threads);
+void snap_index_free(snap_index_t *index);
+#endif